@@ -0,0 +1,42 @@
+#ifndef CIRCUIT_BREAKER_H
+#define CIRCUIT_BREAKER_H
+
+#include <stdint.h>
+
+// Consecutive failed or slow requests that open the circuit
+#define CIRCUIT_BREAKER_DEFAULT_FAILURES 3
+
+// Responses slower than this count as failures
+#define CIRCUIT_BREAKER_DEFAULT_SLOW_MS 1000
+
+// Time the circuit stays open before one trial request is let through
+#define CIRCUIT_BREAKER_DEFAULT_COOLDOWN_MS 10000
+
+typedef enum {
+    CircuitClosed = 0,      // Requests go through
+    CircuitOpen = 1,        // Requests are refused until the cool-down ends
+    CircuitHalfOpen = 2     // One trial request is out; its outcome decides
+} CircuitState;
+
+// Stops calling a backend that keeps failing or stalling, so callers fail
+// fast instead of waiting out a timeout on every request. Times are passed
+// in, in milliseconds on a monotonic clock. Not locked: a breaker belongs to
+// one client, and a client to one thread.
+typedef struct {
+    CircuitState state;
+    int failure_threshold;
+    int slow_threshold_ms;
+    int cooldown_ms;
+    int consecutive_failures;
+    uint64_t opened_at_ms;
+    uint64_t trips;         // Times the circuit opened
+} CircuitBreaker;
+
+// Function prototypes
+void circuit_breaker_init(CircuitBreaker* breaker, int failure_threshold,
+                          int slow_threshold_ms, int cooldown_ms);
+int circuit_breaker_allow(CircuitBreaker* breaker, uint64_t now_ms);
+void circuit_breaker_record(CircuitBreaker* breaker, int success, int elapsed_ms, uint64_t now_ms);
+void circuit_breaker_release(CircuitBreaker* breaker);
+
+#endif // CIRCUIT_BREAKER_H
@@ -0,0 +1,21 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "search.h"
+
+// Settings read from resources/config.json; keys missing from the file
+// keep their defaults
+typedef struct NovaKeyConfig NovaKeyConfig;
+
+// Function prototypes
+NovaKeyConfig* load_config(const char* config_path);
+NovaKeyConfig* create_default_config(void);
+void free_config(NovaKeyConfig* config);
+
+NovaKeyConfig* get_global_config(void);
+void cleanup_global_config(void);
+
+SearchConfig* create_configured_search_config(const NovaKeyConfig* config);
+EmbeddingBackend* create_configured_embedding_backend(const NovaKeyConfig* config);
+
+#endif // CONFIG_H
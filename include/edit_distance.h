@@ -0,0 +1,30 @@
+#ifndef EDIT_DISTANCE_H
+#define EDIT_DISTANCE_H
+
+#include <stdint.h>
+
+// Longest pattern (in code points) handled by the bit-parallel algorithm;
+// longer patterns fall back to the dynamic-programming table
+#define EDIT_PATTERN_MAX_BITS 64
+#define EDIT_PATTERN_SLOTS 128
+
+// A string prepared for repeated Levenshtein comparisons over Unicode code
+// points, e.g. the query against every candidate reading. Holds the match
+// bitmask of each distinct symbol for Myers' bit-parallel algorithm.
+typedef struct {
+    uint32_t* code_points;
+    int length;                                // In code points
+    uint32_t symbols[EDIT_PATTERN_SLOTS];      // Open-addressed, 0 marks an empty slot
+    uint64_t masks[EDIT_PATTERN_SLOTS];        // Bit i set where code_points[i] == symbol
+} EditPattern;
+
+// Function prototypes
+int edit_pattern_init(EditPattern* pattern, const char* text);
+void edit_pattern_free(EditPattern* pattern);
+int edit_pattern_distance(const EditPattern* pattern, const char* text, int* text_length);
+int edit_pattern_distance_bounded(const EditPattern* pattern, const char* text,
+                                  int text_length, int max_distance);
+
+int edit_distance(const char* a, const char* b);
+
+#endif // EDIT_DISTANCE_H
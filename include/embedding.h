@@ -2,23 +2,63 @@
 #define EMBEDDING_H
 
 #include <curl/curl.h>
-#include <cjson/cJSON.h>
+#include "embedding_cache.h"
+#include "circuit_breaker.h"
 
 // HTTP response structure
 typedef struct {
     char* data;
     size_t size;
+    size_t capacity;
 } HttpResponse;
 
+// Request body written in place and reused from one request to the next
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} RequestBuffer;
+
 // Embedding vector structure
 typedef struct {
     float* values;
     int dimensions;
 } EmbeddingVector;
 
-// Ollama API client structure
+// Embeddings of several texts as one row-major matrix: row i, the
+// embedding of text i, starts at values + i * dimensions
+typedef struct {
+    float* values;
+    int count;
+    int dimensions;
+} EmbeddingMatrix;
+
+// Texts sent per /api/embed request unless the client says otherwise
+#define OLLAMA_DEFAULT_BATCH_SIZE 64
+
+// Time a request may take when the caller gives no deadline
+#define OLLAMA_DEFAULT_TIMEOUT_MS 30000
+
+// Deadlines are absolute times in milliseconds on the clock of
+// embedding_clock_ms(); this one means the client's default timeout
+#define EMBEDDING_NO_DEADLINE 0
+
+// Ollama API client structure. Requests go through one easy handle, so the
+// connection to Ollama stays open between calls; a client must not be used
+// from two threads at once.
 typedef struct {
     CURL* curl;
+    struct curl_slist* headers;     // Sent with every request
+    HttpResponse response;          // Reused body buffer of the last response
+    RequestBuffer request;          // Reused body buffer of the next request
+    char* embeddings_url;           // Single text: /api/embeddings
+    char* embed_url;                // Batches: /api/embed
+    int batch_size;                 // Texts per batch request
+    int timeout_ms;                 // Per request, for calls without a deadline
+    CircuitBreaker breaker;         // Skips Ollama for a while after repeated failures
+    EmbeddingCache* cache;          // Checked before each request; not owned, may be NULL
+    struct EmbeddingLru* memory_cache;  // Checked before the cache; not owned, may be NULL
+    struct EmbeddingFlightGroup* flights;   // Joined before requesting; not owned, may be NULL
     char* base_url;
     char* model_name;
 } OllamaClient;
@@ -28,13 +68,38 @@ OllamaClient* ollama_client_create(const char* base_url, const char* model_name)
 void ollama_client_destroy(OllamaClient* client);
 
 EmbeddingVector* generate_embedding(OllamaClient* client, const char* text);
+EmbeddingVector* generate_embedding_until(OllamaClient* client, const char* text, uint64_t deadline_ms);
+const EmbeddingVector* acquire_embedding(OllamaClient* client, const char* text);
+void release_embedding(OllamaClient* client, const EmbeddingVector* vector);
 void free_embedding_vector(EmbeddingVector* vector);
 
+EmbeddingMatrix* generate_embeddings_batch(OllamaClient* client, const char* const* texts, int count);
+EmbeddingMatrix* generate_embeddings_batch_until(OllamaClient* client, const char* const* texts, int count,
+                                                 uint64_t deadline_ms);
+void free_embedding_matrix(EmbeddingMatrix* matrix);
+
+uint64_t embedding_clock_ms(void);
+uint64_t embedding_deadline_in(int timeout_ms);
+
+void normalize_embedding_vector(EmbeddingVector* vector);
 float calculate_cosine_similarity(const EmbeddingVector* a, const EmbeddingVector* b);
+float calculate_normalized_similarity(const EmbeddingVector* a, const EmbeddingVector* b);
 
 // HTTP utility functions
 size_t write_callback(void* contents, size_t size, size_t nmemb, HttpResponse* response);
 HttpResponse* http_post_json(const char* url, const char* json_data);
+const HttpResponse* ollama_client_post(OllamaClient* client, const char* url, const char* json_data,
+                                       uint64_t deadline_ms);
 void free_http_response(HttpResponse* response);
+struct curl_slist* create_json_headers(void);
+void set_post_options(CURL* curl, struct curl_slist* headers, HttpResponse* response);
+char* build_url(const char* base_url, const char* path);
+
+// Ollama request and response bodies
+int write_embedding_request(RequestBuffer* buffer, const char* model_name, const char* text);
+int write_batch_request(RequestBuffer* buffer, const char* model_name,
+                        const char* const* texts, int count);
+void free_request_buffer(RequestBuffer* buffer);
+EmbeddingVector* parse_embedding_response(const HttpResponse* response);
 
 #endif // EMBEDDING_H
\ No newline at end of file
@@ -0,0 +1,57 @@
+#ifndef EMBEDDING_ASYNC_H
+#define EMBEDDING_ASYNC_H
+
+#include <curl/curl.h>
+#include "embedding.h"
+
+// Requests in flight at once unless the client says otherwise
+#define ASYNC_EMBEDDING_DEFAULT_IN_FLIGHT 4
+
+// Called once per submitted text with its embedding, or NULL if the request
+// failed or was cancelled. The callback owns the vector.
+typedef void (*EmbeddingCallback)(const char* text, EmbeddingVector* vector, void* user_data);
+
+// One submitted text. Finished requests keep their easy handle and request
+// and response buffers for the next submission.
+typedef struct EmbeddingRequest {
+    CURL* curl;
+    HttpResponse response;
+    char* text;
+    RequestBuffer body;             // JSON request, must outlive the transfer
+    EmbeddingCallback callback;
+    void* user_data;
+    struct EmbeddingRequest* next;
+} EmbeddingRequest;
+
+// Non-blocking Ollama embedding client over one curl multi handle. Submitting
+// only queues a request; transfers advance in async_embedding_poll(), which
+// never waits on the network, or async_embedding_wait(), which waits at most
+// its timeout. Like OllamaClient, a client belongs to one thread.
+typedef struct {
+    CURLM* multi;
+    struct curl_slist* headers;     // Shared by every request
+    char* embeddings_url;
+    char* base_url;
+    char* model_name;
+    int max_in_flight;
+    int in_flight;
+    int queued;
+    int closing;                    // Set while destroy cancels requests
+    EmbeddingRequest* queue_head;   // Submitted, waiting for a free slot
+    EmbeddingRequest* queue_tail;
+    EmbeddingRequest* active;       // Added to the multi handle
+    EmbeddingRequest* idle;         // Finished, kept for reuse
+} AsyncEmbeddingClient;
+
+// Function prototypes
+AsyncEmbeddingClient* async_embedding_client_create(const char* base_url, const char* model_name,
+                                                    int max_in_flight);
+void async_embedding_client_destroy(AsyncEmbeddingClient* client);
+
+int async_embedding_submit(AsyncEmbeddingClient* client, const char* text,
+                           EmbeddingCallback callback, void* user_data);
+int async_embedding_poll(AsyncEmbeddingClient* client);
+int async_embedding_wait(AsyncEmbeddingClient* client, int timeout_ms);
+int async_embedding_pending(const AsyncEmbeddingClient* client);
+
+#endif // EMBEDDING_ASYNC_H
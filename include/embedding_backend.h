@@ -0,0 +1,64 @@
+#ifndef EMBEDDING_BACKEND_H
+#define EMBEDDING_BACKEND_H
+
+#include "embedding.h"
+
+// Dimensions of the built-in n-gram embedder unless asked otherwise
+#define NGRAM_DEFAULT_DIMENSIONS 256
+
+typedef struct EmbeddingBackend EmbeddingBackend;
+
+// Operations every embedding backend provides. Calls give up and return NULL
+// at deadline_ms (EMBEDDING_NO_DEADLINE: the backend's default timeout).
+// Results are owned by the caller, who frees them with
+// free_embedding_vector() and free_embedding_matrix().
+typedef struct {
+    const char* name;
+    EmbeddingVector* (*embed)(EmbeddingBackend* backend, const char* text, uint64_t deadline_ms);
+    EmbeddingMatrix* (*embed_batch)(EmbeddingBackend* backend, const char* const* texts, int count,
+                                    uint64_t deadline_ms);
+    int (*dimensions)(const EmbeddingBackend* backend);   // 0 until known
+    void (*destroy)(EmbeddingBackend* backend);
+} EmbeddingBackendOps;
+
+// Source of embeddings for search: a model server, or an embedder that runs
+// in-process. Stores built from one backend are keyed by its model name, so
+// vectors from different backends are never compared.
+struct EmbeddingBackend {
+    const EmbeddingBackendOps* ops;
+    char* model_name;
+    int batch_size;             // Texts per embed_batch call when building stores
+    int embeds_readings;        // Entries are embedded with their readings, not just the kanji
+    int dimensions;             // Of the last embedding, for backends that learn it late
+    EmbeddingCache* cache;      // Disk cache of the Ollama client (owned), may be NULL
+    struct EmbeddingLru* memory_cache;  // Memory cache of the Ollama client (owned), may be NULL
+    void* state;
+};
+
+// How embedding_backend_create() sets up an Ollama backend; fields left 0
+// take the defaults named beside them
+typedef struct {
+    const char* cache_dir;          // Disk cache directory, NULL for none
+    size_t cache_max_bytes;         // EMBEDDING_CACHE_DEFAULT_MAX_BYTES
+    size_t memory_cache_bytes;      // No memory cache
+    int batch_size;                 // Texts per request: OLLAMA_DEFAULT_BATCH_SIZE
+    int breaker_cooldown_ms;        // CIRCUIT_BREAKER_DEFAULT_COOLDOWN_MS
+    struct EmbeddingFlightGroup* flights;   // Shared with other backends (not owned), NULL for none
+} EmbeddingBackendSettings;
+
+// Function prototypes
+EmbeddingBackend* embedding_backend_create(const char* kind, const char* base_url,
+                                           const char* model_name,
+                                           const EmbeddingBackendSettings* settings);
+EmbeddingBackend* embedding_backend_create_ollama(OllamaClient* client);
+EmbeddingBackend* embedding_backend_create_ngram(int dimensions);
+void embedding_backend_destroy(EmbeddingBackend* backend);
+
+EmbeddingVector* embedding_backend_embed(EmbeddingBackend* backend, const char* text,
+                                         uint64_t deadline_ms);
+EmbeddingMatrix* embedding_backend_embed_batch(EmbeddingBackend* backend, const char* const* texts,
+                                               int count, uint64_t deadline_ms);
+int embedding_backend_dimensions(const EmbeddingBackend* backend);
+OllamaClient* embedding_backend_ollama_client(EmbeddingBackend* backend);
+
+#endif // EMBEDDING_BACKEND_H
@@ -0,0 +1,47 @@
+#ifndef EMBEDDING_CACHE_H
+#define EMBEDDING_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Default directory and size cap of the cache file
+#define EMBEDDING_CACHE_DEFAULT_DIRECTORY "resources/cache"
+#define EMBEDDING_CACHE_DEFAULT_MAX_BYTES (64u << 20)
+
+// Slot of the in-memory index: key hash and offset of the newest record
+typedef struct {
+    uint64_t hash;
+    uint64_t offset;        // 0 for an empty slot (offset 0 is the header)
+} EmbeddingCacheSlot;
+
+// Persistent embeddings keyed by (model name, text). The file is an
+// append-only log of checksummed records, mapped for reads and indexed in
+// memory when opened; a torn record left by a crash is cut off on the next
+// open. Past max_bytes the log is compacted down to the newest records.
+// A directory holds one open cache at a time, across processes; a second
+// open fails until the first is closed. There is no locking between threads:
+// a cache, like the OllamaClient it serves, is used by one thread at a time.
+typedef struct {
+    char* path;
+    int fd;
+    int lock_fd;            // Directory, locked while the cache is open
+    char* image;            // Mapping of max_bytes, valid up to size
+    size_t image_size;
+    size_t size;            // Bytes of valid records in the file
+    size_t max_bytes;
+    EmbeddingCacheSlot* slots;
+    size_t slot_count;      // Power of two
+    size_t entry_count;
+} EmbeddingCache;
+
+// Function prototypes
+EmbeddingCache* embedding_cache_open(const char* directory, size_t max_bytes);
+void embedding_cache_close(EmbeddingCache* cache);
+
+const float* embedding_cache_get(const EmbeddingCache* cache, const char* model_name,
+                                 const char* text, int* dimensions);
+int embedding_cache_put(EmbeddingCache* cache, const char* model_name, const char* text,
+                        const float* values, int dimensions);
+int embedding_cache_compact(EmbeddingCache* cache, size_t target_bytes);
+
+#endif // EMBEDDING_CACHE_H
@@ -0,0 +1,44 @@
+#ifndef EMBEDDING_FLIGHT_H
+#define EMBEDDING_FLIGHT_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "embedding.h"
+
+// Request for the embedding of one (model, text) key, shared by every
+// caller that asks for the same key while it is out. Key strings belong to
+// the caller that issued it and are only compared while it is in the group.
+typedef struct EmbeddingFlight {
+    const char* model_name;
+    const char* text;
+    uint64_t hash;
+    int done;
+    int followers;                  // Callers waiting on the issuer's result
+    EmbeddingVector* result;        // Copy for the followers; the last one frees it
+    struct EmbeddingFlight* next;
+} EmbeddingFlight;
+
+// Single-flight coalescing of embedding requests across threads: the first
+// caller for a key fetches it, later callers for the same key wait for that
+// fetch instead of sending their own. Requests out at once are few, about
+// one per thread, so the flights are a plain list.
+typedef struct EmbeddingFlightGroup {
+    pthread_mutex_t lock;
+    pthread_cond_t landed;          // Broadcast whenever a flight finishes
+    EmbeddingFlight* flights;
+    uint64_t fetches;               // Fetches issued
+    uint64_t coalesced;             // Callers served by another caller's fetch
+} EmbeddingFlightGroup;
+
+// Fetches the embedding of text, as generate_embedding_until() would
+typedef EmbeddingVector* (*EmbeddingFetch)(void* context, const char* text);
+
+// Function prototypes
+EmbeddingFlightGroup* embedding_flight_group_create(void);
+void embedding_flight_group_destroy(EmbeddingFlightGroup* group);
+
+EmbeddingVector* embedding_flight_do(EmbeddingFlightGroup* group, const char* model_name,
+                                     const char* text, uint64_t deadline_ms,
+                                     EmbeddingFetch fetch, void* context);
+
+#endif // EMBEDDING_FLIGHT_H
@@ -0,0 +1,68 @@
+#ifndef EMBEDDING_LRU_H
+#define EMBEDDING_LRU_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "embedding.h"
+
+// Independent shards, each with its own lock and share of the budget
+#define EMBEDDING_LRU_SHARDS 16
+
+// Default byte budget of the whole cache
+#define EMBEDDING_LRU_DEFAULT_BUDGET (8u << 20)
+
+// One cached vector, its key and its floats in a single allocation. The
+// vector comes first, so a borrowed vector leads back to its entry.
+typedef struct EmbeddingLruEntry {
+    EmbeddingVector vector;
+    uint64_t hash;
+    const char* text;
+    size_t bytes;                       // Charged against the shard budget
+    int references;                     // The shard's while resident, plus one per borrower
+    struct EmbeddingLruEntry* newer;
+    struct EmbeddingLruEntry* older;
+    struct EmbeddingLruEntry* chain;    // Next entry in the same bucket
+} EmbeddingLruEntry;
+
+typedef struct {
+    pthread_mutex_t lock;
+    EmbeddingLruEntry** buckets;
+    size_t bucket_count;                // Power of two
+    size_t entry_count;
+    EmbeddingLruEntry* newest;
+    EmbeddingLruEntry* oldest;
+    size_t bytes;
+    size_t budget;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+} EmbeddingLruShard;
+
+// In-process embeddings keyed by text, least recently used first out. Safe
+// to share between threads. Lookups hand out borrowed read-only vectors that
+// stay valid, even once evicted, until released, so a hit never allocates.
+typedef struct EmbeddingLru {
+    EmbeddingLruShard shards[EMBEDDING_LRU_SHARDS];
+    size_t budget;
+} EmbeddingLru;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    size_t entries;
+    size_t bytes;
+} EmbeddingLruStats;
+
+// Function prototypes
+EmbeddingLru* embedding_lru_create(size_t budget);
+void embedding_lru_destroy(EmbeddingLru* lru);
+
+const EmbeddingVector* embedding_lru_get(EmbeddingLru* lru, const char* text);
+const EmbeddingVector* embedding_lru_put(EmbeddingLru* lru, const char* text,
+                                         const float* values, int dimensions);
+void embedding_lru_release(const EmbeddingVector* vector);
+void embedding_lru_stats(EmbeddingLru* lru, EmbeddingLruStats* stats);
+
+#endif // EMBEDDING_LRU_H
@@ -0,0 +1,67 @@
+#ifndef EMBEDDING_STORE_H
+#define EMBEDDING_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Element type of the rows of a store
+typedef enum {
+    EmbeddingPrecisionF32 = 0,
+    EmbeddingPrecisionF16 = 1,     // IEEE half precision
+    EmbeddingPrecisionBF16 = 2     // bfloat16: float range, 8-bit mantissa
+} EmbeddingPrecision;
+
+// Precomputed embeddings for every dictionary entry, indexed by entry id.
+// A store is only valid for the (model, dictionary) pair it was built from.
+// Rows form one contiguous, 64-byte aligned matrix; each row is padded with
+// zeros to a whole number of cache lines so every row starts aligned. Rows
+// are floats, or fp16/bf16 at half the memory, widened while scoring. An
+// optional int8 copy (one scale per row) is scanned for approximate scores,
+// with the full rows kept for exact re-ranking. Optional sign-bit signatures
+// (one bit per dimension) shortlist entries by Hamming distance even more
+// cheaply.
+typedef struct {
+    char* model_name;          // Embedding model used to build the rows
+    uint64_t dictionary_hash;  // Fingerprint of the source dictionary
+    int entry_count;           // Number of rows (one per dictionary entry)
+    int dimensions;            // Length of each row
+    EmbeddingPrecision precision;
+    size_t stride;             // Elements between row starts (dimensions, padded)
+    float* values;             // entry_count x stride, row-major, unit length; NULL unless F32
+    uint16_t* half_values;     // The same rows in fp16 or bf16; NULL for F32
+    int8_t* quantized;         // entry_count x quantized_stride int8 rows, or NULL
+    size_t quantized_stride;   // Bytes between int8 row starts
+    float* scales;             // Per-row dequantization scale of the int8 rows
+    uint64_t* signatures;      // entry_count x signature_words sign bits, or NULL
+    int signature_words;       // 64-bit words per signature
+    void* image;               // File mapping of a loaded store, NULL if on the heap
+    size_t image_size;
+    int complete;              // 0 if some rows could not be generated
+} EmbeddingStore;
+
+// Function prototypes
+EmbeddingStore* embedding_store_create(const char* model_name, uint64_t dictionary_hash,
+                                       int entry_count, int dimensions);
+void embedding_store_destroy(EmbeddingStore* store);
+int embedding_store_quantize(EmbeddingStore* store);
+int embedding_store_set_precision(EmbeddingStore* store, EmbeddingPrecision precision);
+int embedding_store_build_signatures(EmbeddingStore* store);
+
+int embedding_store_save(const EmbeddingStore* store, const char* path);
+EmbeddingStore* embedding_store_load(const char* path, const char* model_name,
+                                     uint64_t dictionary_hash, int entry_count);
+
+const float* embedding_store_row(const EmbeddingStore* store, int entry_id);
+float* embedding_store_mutable_row(EmbeddingStore* store, int entry_id);
+const float* embedding_store_read_row(const EmbeddingStore* store, int entry_id, float* buffer);
+float embedding_store_dot(const EmbeddingStore* store, int entry_id, const float* query);
+size_t embedding_store_row_bytes(const EmbeddingStore* store);
+int embedding_store_score(const EmbeddingStore* store, const float* query, float* scores);
+int embedding_store_score_quantized(const EmbeddingStore* store, const float* query, float* scores);
+int embedding_store_signature_shortlist(const EmbeddingStore* store, const float* query,
+                                        int limit, int* ids);
+
+const char* embedding_precision_name(EmbeddingPrecision precision);
+int embedding_precision_from_name(const char* name, EmbeddingPrecision* precision);
+
+#endif // EMBEDDING_STORE_H
@@ -0,0 +1,42 @@
+#ifndef HNSW_H
+#define HNSW_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "embedding_store.h"
+#include "topk.h"
+
+typedef struct HnswSearchCache HnswSearchCache;
+
+// Hierarchical navigable small world graph over the rows of an
+// EmbeddingStore, for approximate nearest-neighbour search by cosine
+// similarity. The links live in a serialized image so a saved index is used
+// directly from a memory-mapped file; the vectors stay in the store.
+typedef struct {
+    int node_count;
+    int m;                          // Links per node on upper layers, 2 * m on layer 0
+    int max_level;
+    int entry_point;
+    const uint32_t* level0;         // node_count slots of [count, 2 * m ids]
+    const uint32_t* upper_offsets;  // node_count + 1 slot indices into upper
+    const uint32_t* upper;          // Slots of [count, m ids], one per node and upper layer
+    const EmbeddingStore* store;    // Vectors being indexed (not owned)
+    HnswSearchCache* search_cache;  // Search memory reused across queries (owned)
+    void* image;
+    size_t image_size;
+    int image_mapped;
+} HnswIndex;
+
+#define HNSW_DEFAULT_M 16
+#define HNSW_DEFAULT_EF_CONSTRUCTION 200
+
+// Function prototypes
+HnswIndex* hnsw_build(const EmbeddingStore* store, int m, int ef_construction);
+void hnsw_destroy(HnswIndex* index);
+
+int hnsw_save(const HnswIndex* index, const char* path);
+HnswIndex* hnsw_load(const char* path, const EmbeddingStore* store);
+
+int hnsw_search(const HnswIndex* index, const float* query, int ef, TopKSelector* results);
+
+#endif // HNSW_H
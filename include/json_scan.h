@@ -0,0 +1,17 @@
+#ifndef JSON_SCAN_H
+#define JSON_SCAN_H
+
+// In-place scanning of JSON text held in memory, for responses where only a
+// few members matter. Nothing is allocated: every function takes a position
+// in the text and its end, and returns another position, or NULL if the
+// text there is not what was expected.
+
+// Function prototypes
+const char* json_find_member(const char* json, const char* end, const char* key);
+const char* json_array_first(const char* array, const char* end);
+const char* json_array_next(const char* element_end, const char* end);
+
+int json_count_floats(const char* array, const char* end);
+const char* json_read_floats(const char* array, const char* end, float* values, int count);
+
+#endif // JSON_SCAN_H
@@ -1,8 +1,15 @@
 #ifndef SEARCH_H
 #define SEARCH_H
 
+#include <stdint.h>
 #include "morphology.h"
 #include "embedding.h"
+#include "embedding_backend.h"
+#include "embedding_store.h"
+#include "hnsw.h"
+#include "trie.h"
+#include "edit_distance.h"
+#include "topk.h"
 #include "novakey_core.h"
 
 // Search configuration
@@ -11,24 +18,64 @@ typedef struct {
     float phonetic_weight;     // Weight for phonetic similarity (0.0 - 1.0)
     int max_candidates;        // Maximum number of candidates to return
     char* dictionary_path;     // Path to candidate dictionary
+    char* embedding_store_path; // Path to precomputed dictionary embeddings
+    char* semantic_index_path;  // Path to the HNSW index over those embeddings
+    int quantized_embeddings;   // Scan int8 embeddings, re-rank with full rows
+    EmbeddingPrecision embedding_precision; // Element type of stored dictionary rows
+    int binary_prefilter;       // Shortlist on sign-bit signatures instead of int8 or HNSW
+    int embedding_timeout_ms;   // Budget of the query embedding, per search
 } SearchConfig;
 
-// Dictionary entry structure
+// Waiting longer for the query embedding than this would be felt as typing lag
+#define SEARCH_DEFAULT_EMBEDDING_TIMEOUT_MS 200
+
+// Dictionary entry view; strings point into the dictionary's string pool
 typedef struct {
-    char* kanji;              // Kanji representation
-    char* hiragana;           // Hiragana reading
-    char* katakana;           // Katakana reading
-    char* romaji;             // Romaji reading
+    const char* kanji;        // Kanji representation
+    const char* hiragana;     // Hiragana reading
+    const char* katakana;     // Katakana reading
+    const char* romaji;       // Romaji reading
     float frequency;          // Usage frequency score
 } DictionaryEntry;
 
-// Dictionary container
+// String fields stored per entry in the offset table
+typedef enum {
+    DictionaryFieldKanji = 0,
+    DictionaryFieldHiragana = 1,
+    DictionaryFieldKatakana = 2,
+    DictionaryFieldRomaji = 3,
+    DICTIONARY_FIELD_COUNT = 4
+} DictionaryField;
+
+// Dictionary container. The data is a single read-only image: either a
+// compiled file mapped with mmap, or a heap copy built from the text format.
 typedef struct {
-    DictionaryEntry* entries;
     int entry_count;
-    int capacity;
+    uint64_t fingerprint;            // Content hash recorded at compile time
+    const char* string_pool;         // NUL-terminated strings
+    size_t string_pool_size;
+    const uint32_t* string_offsets;  // DICTIONARY_FIELD_COUNT pool offsets per entry
+    const float* frequencies;        // One frequency per entry
+    float max_frequency;             // Highest of them, bounding any frequency boost
+    DoubleArrayTrie hiragana_index;  // Reading trie for exact/prefix/predictive lookup
+    DoubleArrayTrie romaji_index;    // Same lookups keyed on romaji
+    const void* image;               // Backing image
+    size_t image_size;
+    int image_mapped;                // 1 if image is mmap'd, 0 if heap-allocated
+    EmbeddingStore* embeddings;      // Precomputed entry embeddings (optional, owned)
+    HnswIndex* semantic_index;       // Neighbour graph over embeddings (optional, owned)
 } Dictionary;
 
+// Combined scores are multiplied by 1 + frequency * SEARCH_FREQUENCY_BOOST
+#define SEARCH_FREQUENCY_BOOST 0.1f
+
+// Candidates at or below this combined score are never returned
+#define SEARCH_MIN_COMBINED_SCORE 0.1f
+
+// When nothing shares a prefix with the input, readings at most this many
+// edits away are looked up as typos; further off they share too little
+#define SEARCH_MAX_TYPO_DISTANCE 3
+
 // Candidate scoring result
 typedef struct {
     NovaKeyCandidate* candidates;
@@ -41,13 +88,23 @@ SearchConfig* create_search_config(void);
 void free_search_config(SearchConfig* config);
 
 Dictionary* load_dictionary(const char* path);
+Dictionary* load_compiled_dictionary(const char* path);
+Dictionary* create_fallback_dictionary(void);
 void free_dictionary(Dictionary* dict);
 
+int compile_dictionary(const char* text_path, const char* output_path);
+const char* dictionary_field(const Dictionary* dict, int index, DictionaryField field);
+DictionaryEntry dictionary_get_entry(const Dictionary* dict, int index);
+
+uint64_t dictionary_fingerprint(const Dictionary* dict);
+int attach_dictionary_embeddings(Dictionary* dict, EmbeddingBackend* backend,
+                                 const SearchConfig* config);
+
 CandidateList* search_candidates(const char* input_text, 
                                 const MorphResult* morph_result,
                                 const Dictionary* dict,
                                 const SearchConfig* config,
-                                OllamaClient* ollama_client);
+                                EmbeddingBackend* backend);
 
 void free_candidate_list(CandidateList* candidates);
 
@@ -56,6 +113,8 @@ float calculate_phonetic_similarity(const char* input_reading, const char* candi
 float calculate_edit_distance_score(const char* a, const char* b);
 float calculate_combined_score(float embedding_score, float phonetic_score, 
                               float frequency_score, const SearchConfig* config);
+int search_typo_distance(const Dictionary* dict, const SearchConfig* config, int query_length,
+                         float embedding_score, float threshold);
 
 // Utility functions
 void sort_candidates_by_score(CandidateList* candidates);
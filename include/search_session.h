@@ -0,0 +1,61 @@
+#ifndef SEARCH_SESSION_H
+#define SEARCH_SESSION_H
+
+#include <stddef.h>
+#include "search.h"
+
+// A trie node whose path is within typo distance of the text
+typedef struct {
+    int node;
+    int depth;              // Code points on the node's path
+    int distance;           // Edit distance from the path to the text
+} SearchSessionNode;
+
+// One frame per code point typed, frames[0] being the empty text. While
+// the text is on the trie a frame is just the node it reached. Once nothing
+// shares a prefix with it, a frame keeps the frontier of nodes within typo
+// distance, so appending a code point steps the previous frame's frontier
+// and deleting one pops frames.
+typedef struct {
+    size_t text_length;     // Bytes of text covered by this frame
+    int node;               // Trie node reached by the query, -1 once off the trie
+    int prefix_entries;     // Entries whose readings are shorter prefixes of the query
+    int max_distance;       // Distance the frontier covers, -1 if none is kept
+    size_t frontier_start;  // First of this frame's nodes in SearchSession.frontier
+    int frontier_count;
+} SearchSessionFrame;
+
+// Incremental phonetic search over a composition that changes one keystroke
+// at a time. Returns what search_candidates() returns for the same text
+// without embeddings. A keystroke costs one trie step, or one distance step
+// per frontier node once off the trie.
+typedef struct {
+    const Dictionary* dict;         // Not owned
+    const SearchConfig* config;     // Not owned
+    int romaji;                     // Text is romaji keystrokes (romaji index)
+    char* text;                     // Composition as typed
+    char* query;                    // Text as matched: lowercased when romaji
+    size_t text_capacity;
+    SearchSessionFrame* frames;
+    int frame_count;
+    int frame_capacity;
+    SearchSessionNode* frontier;    // Frontiers of all frames, in frame order
+    size_t frontier_count;
+    size_t frontier_capacity;
+    SearchSessionNode* pending;     // Scratch for the frontier being built
+    size_t pending_count;
+    size_t pending_capacity;
+} SearchSession;
+
+// Function prototypes
+SearchSession* search_session_create(const Dictionary* dict, const SearchConfig* config);
+void search_session_destroy(SearchSession* session);
+int search_session_reset(SearchSession* session);
+
+int search_session_append(SearchSession* session, const char* text);
+int search_session_delete(SearchSession* session, int count);
+const char* search_session_text(const SearchSession* session);
+
+CandidateList* search_session_candidates(const SearchSession* session);
+
+#endif // SEARCH_SESSION_H
@@ -0,0 +1,30 @@
+#ifndef TOPK_H
+#define TOPK_H
+
+// Scored item kept by the selector
+typedef struct {
+    int id;
+    float score;
+} TopKItem;
+
+// Streaming top-K selection with a bounded min-heap: the root is the weakest
+// item kept so far, so each push costs O(1) to reject or O(log K) to keep.
+// Any scoring path can feed it, one item at a time or a whole score array.
+typedef struct {
+    TopKItem* items;
+    int k;
+    int count;
+} TopKSelector;
+
+// Function prototypes
+TopKSelector* topk_create(int k);
+void topk_destroy(TopKSelector* selector);
+void topk_reset(TopKSelector* selector);
+
+int topk_push(TopKSelector* selector, int id, float score);
+void topk_push_scores(TopKSelector* selector, const float* scores, int count, float min_score);
+float topk_threshold(const TopKSelector* selector);
+
+int topk_finish(TopKSelector* selector);
+
+#endif // TOPK_H
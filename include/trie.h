@@ -0,0 +1,58 @@
+#ifndef TRIE_H
+#define TRIE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Double-array trie over byte strings (UTF-8 readings). Keys map to the
+// dictionary entry ids that share them. The arrays live in a serialized
+// image so the trie can be used directly from a memory-mapped dictionary.
+typedef struct {
+    int node_count;
+    const int32_t* base;         // Child offset, or -(key index + 1) for key terminals
+    const int32_t* check;        // Parent node of each slot, -1 if unused
+    int key_count;               // Number of distinct keys
+    const uint32_t* key_starts;  // key_count + 1 offsets into entry_ids
+    const uint32_t* entry_ids;   // Entry ids grouped by key, keys in byte order
+    int max_key_length;          // In bytes
+} DoubleArrayTrie;
+
+// Called for every matching entry; return non-zero to stop the search
+typedef int (*TrieVisitor)(int entry_id, void* user_data);
+
+// Called for a node one code point below another; return non-zero to stop
+typedef int (*TrieChildVisitor)(int child, uint32_t code_point, void* user_data);
+
+// Called for a node within reach of a fuzzy query, with the code points on
+// its path and their edit distance to the query; return non-zero to stop
+typedef int (*TrieNodeVisitor)(int node, int depth, int distance, void* user_data);
+
+#define TRIE_ROOT 0
+
+// Function prototypes
+void* trie_build_image(const char* const* keys, int count, size_t* image_size);
+int trie_open(DoubleArrayTrie* trie, const void* image, size_t image_size);
+int trie_entry_count(const DoubleArrayTrie* trie);
+
+int trie_child(const DoubleArrayTrie* trie, int node, unsigned char byte);
+int trie_walk(const DoubleArrayTrie* trie, int node, const char* text, size_t length);
+
+int trie_exact_match(const DoubleArrayTrie* trie, const char* key,
+                     TrieVisitor visitor, void* user_data);
+int trie_common_prefix_search(const DoubleArrayTrie* trie, const char* text, size_t length,
+                              TrieVisitor visitor, void* user_data);
+int trie_predictive_search(const DoubleArrayTrie* trie, const char* prefix,
+                           TrieVisitor visitor, void* user_data);
+int trie_enumerate_subtree(const DoubleArrayTrie* trie, int node,
+                           TrieVisitor visitor, void* user_data);
+int trie_fuzzy_search(const DoubleArrayTrie* trie, const char* query, int max_distance,
+                      TrieVisitor visitor, void* user_data);
+
+int trie_node_entries(const DoubleArrayTrie* trie, int node,
+                      TrieVisitor visitor, void* user_data);
+int trie_enumerate_children(const DoubleArrayTrie* trie, int node,
+                            TrieChildVisitor visitor, void* user_data);
+int trie_fuzzy_nodes(const DoubleArrayTrie* trie, const char* query, int max_distance,
+                     TrieNodeVisitor visitor, void* user_data);
+
+#endif // TRIE_H
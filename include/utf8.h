@@ -0,0 +1,10 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stdint.h>
+
+// Function prototypes
+int utf8_decode(const char* text, uint32_t* code_point);
+int utf8_length(const char* text);
+
+#endif // UTF8_H
@@ -0,0 +1,52 @@
+#ifndef VECTOR_OPS_H
+#define VECTOR_OPS_H
+
+// Vector kernels used for embedding scoring. The implementation (AVX-512,
+// AVX2/FMA, SSE, NEON or scalar) is picked once at runtime from the CPU's
+// features; every kernel computes the same result up to rounding, and the
+// int8 kernels compute exactly the same result. Half-precision rows (IEEE
+// fp16 or bfloat16, stored as uint16_t) are widened to float on the fly.
+// Sign-bit signatures are compared by Hamming distance with hardware
+// popcount where the kernel has it.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Alignment (bytes) and row padding (floats) used for scoring matrices
+#define VECTOR_ALIGNMENT 64
+#define VECTOR_ROW_PAD 16
+
+// Function prototypes
+float vector_dot(const float* a, const float* b, int n);
+void vector_gemv(const float* matrix, int rows, int cols, size_t stride,
+                 const float* x, float* out);
+float vector_norm(const float* v, int n);
+
+float vector_quantize_i8(const float* v, int n, int8_t* out);
+int32_t vector_dot_i8(const int8_t* a, const int8_t* b, int n);
+void vector_gemv_i8(const int8_t* matrix, const float* row_scales, int rows, int cols,
+                    size_t stride, const int8_t* x, float x_scale, float* out);
+void vector_normalize(float* v, int n);
+
+void vector_to_f16(const float* v, int n, uint16_t* out);
+void vector_from_f16(const uint16_t* v, int n, float* out);
+void vector_to_bf16(const float* v, int n, uint16_t* out);
+void vector_from_bf16(const uint16_t* v, int n, float* out);
+float vector_dot_f16(const uint16_t* a, const float* b, int n);
+float vector_dot_bf16(const uint16_t* a, const float* b, int n);
+void vector_gemv_f16(const uint16_t* matrix, int rows, int cols, size_t stride,
+                     const float* x, float* out);
+void vector_gemv_bf16(const uint16_t* matrix, int rows, int cols, size_t stride,
+                      const float* x, float* out);
+
+void vector_sign_bits(const float* v, int n, uint64_t* out);
+int vector_hamming(const uint64_t* a, const uint64_t* b, int words);
+void vector_hamming_scan(const uint64_t* signatures, int rows, int words,
+                         const uint64_t* x, uint16_t* out);
+
+const char* vector_kernel_name(void);
+int vector_kernel_count(void);
+const char* vector_kernel_name_at(int index);
+int vector_use_kernel(const char* name);
+
+#endif // VECTOR_OPS_H
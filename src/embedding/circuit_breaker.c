@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <string.h>
+#include "../../include/circuit_breaker.h"
+
+// Non-positive settings take the defaults
+void circuit_breaker_init(CircuitBreaker* breaker, int failure_threshold,
+                          int slow_threshold_ms, int cooldown_ms) {
+    if (!breaker) return;
+    
+    memset(breaker, 0, sizeof(*breaker));
+    breaker->state = CircuitClosed;
+    breaker->failure_threshold = failure_threshold > 0 ? failure_threshold : CIRCUIT_BREAKER_DEFAULT_FAILURES;
+    breaker->slow_threshold_ms = slow_threshold_ms > 0 ? slow_threshold_ms : CIRCUIT_BREAKER_DEFAULT_SLOW_MS;
+    breaker->cooldown_ms = cooldown_ms > 0 ? cooldown_ms : CIRCUIT_BREAKER_DEFAULT_COOLDOWN_MS;
+}
+
+// Whether a request may be sent now. Once the cool-down has passed, the
+// next caller is let through as the trial and the rest are refused until
+// it is recorded.
+int circuit_breaker_allow(CircuitBreaker* breaker, uint64_t now_ms) {
+    if (!breaker) {
+        return 1;
+    }
+    
+    switch (breaker->state) {
+        case CircuitClosed:
+            return 1;
+        case CircuitOpen:
+            if (now_ms - breaker->opened_at_ms < (uint64_t)breaker->cooldown_ms) {
+                return 0;
+            }
+            breaker->state = CircuitHalfOpen;
+            return 1;
+        case CircuitHalfOpen:
+            return 0;
+    }
+    return 1;
+}
+
+static void open_circuit(CircuitBreaker* breaker, uint64_t now_ms) {
+    if (breaker->state != CircuitHalfOpen) {
+        printf("Warning: Embedding backend failing, skipping it for %d ms\n", breaker->cooldown_ms);
+    }
+    breaker->state = CircuitOpen;
+    breaker->opened_at_ms = now_ms;
+    breaker->trips++;
+}
+
+// Outcome of a request that allow() let through. A success slower than the
+// slow threshold counts as a failure: the caller has already paid for it.
+void circuit_breaker_record(CircuitBreaker* breaker, int success, int elapsed_ms, uint64_t now_ms) {
+    if (!breaker) return;
+    
+    if (success && elapsed_ms <= breaker->slow_threshold_ms) {
+        breaker->consecutive_failures = 0;
+        breaker->state = CircuitClosed;
+        return;
+    }
+    
+    breaker->consecutive_failures++;
+    if (breaker->state == CircuitHalfOpen ||
+        breaker->consecutive_failures >= breaker->failure_threshold) {
+        open_circuit(breaker, now_ms);
+    }
+}
+
+// A request allow() let through that ended without a verdict, such as one
+// the caller gave up on early. A half-open trial is handed back, so the
+// next caller probes instead of the circuit staying half-open.
+void circuit_breaker_release(CircuitBreaker* breaker) {
+    if (!breaker) return;
+    
+    if (breaker->state == CircuitHalfOpen) {
+        breaker->state = CircuitOpen;
+    }
+}
@@ -0,0 +1,269 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <curl/curl.h>
+#include "../../include/embedding_async.h"
+
+AsyncEmbeddingClient* async_embedding_client_create(const char* base_url, const char* model_name,
+                                                    int max_in_flight) {
+    AsyncEmbeddingClient* client = calloc(1, sizeof(AsyncEmbeddingClient));
+    if (!client) {
+        return NULL;
+    }
+    
+    curl_global_init(CURL_GLOBAL_DEFAULT);
+    
+    client->base_url = strdup(base_url ? base_url : "http://localhost:11434");
+    client->model_name = strdup(model_name ? model_name : "nomic-embed-text");
+    client->max_in_flight = max_in_flight > 0 ? max_in_flight : ASYNC_EMBEDDING_DEFAULT_IN_FLIGHT;
+    client->multi = curl_multi_init();
+    client->headers = create_json_headers();
+    client->embeddings_url = build_url(client->base_url, "/api/embeddings");
+    
+    if (!client->multi || !client->headers || !client->embeddings_url || !client->model_name) {
+        async_embedding_client_destroy(client);
+        return NULL;
+    }
+    
+    // Keep one open connection per slot between requests
+    curl_multi_setopt(client->multi, CURLMOPT_MAXCONNECTS, (long)client->max_in_flight);
+    
+    printf("Async embedding client created (URL: %s, Model: %s, %d in flight)\n",
+           client->base_url, client->model_name, client->max_in_flight);
+    
+    return client;
+}
+
+static EmbeddingRequest* take_request(AsyncEmbeddingClient* client) {
+    EmbeddingRequest* request = client->idle;
+    if (request) {
+        client->idle = request->next;
+        request->next = NULL;
+        return request;
+    }
+    
+    request = calloc(1, sizeof(EmbeddingRequest));
+    if (!request) {
+        return NULL;
+    }
+    
+    request->curl = curl_easy_init();
+    if (!request->curl) {
+        free(request);
+        return NULL;
+    }
+    
+    set_post_options(request->curl, client->headers, &request->response);
+    curl_easy_setopt(request->curl, CURLOPT_URL, client->embeddings_url);
+    curl_easy_setopt(request->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(request->curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(request->curl, CURLOPT_PRIVATE, request);
+    return request;
+}
+
+static void free_request(EmbeddingRequest* request) {
+    curl_easy_cleanup(request->curl);
+    free(request->response.data);
+    free(request->text);
+    free_request_buffer(&request->body);
+    free(request);
+}
+
+static void recycle_request(AsyncEmbeddingClient* client, EmbeddingRequest* request) {
+    free(request->text);
+    request->text = NULL;
+    request->body.size = 0;
+    request->callback = NULL;
+    request->user_data = NULL;
+    request->next = client->idle;
+    client->idle = request;
+}
+
+// The request is recycled before its callback runs, so the callback may
+// submit again; the text stays valid until the callback returns
+static void finish_request(AsyncEmbeddingClient* client, EmbeddingRequest* request,
+                           EmbeddingVector* vector) {
+    EmbeddingCallback callback = request->callback;
+    void* user_data = request->user_data;
+    char* text = request->text;
+    
+    request->text = NULL;
+    recycle_request(client, request);
+    
+    if (callback) {
+        callback(text, vector, user_data);
+    } else {
+        free_embedding_vector(vector);
+    }
+    free(text);
+}
+
+static void unlink_active(AsyncEmbeddingClient* client, EmbeddingRequest* request) {
+    EmbeddingRequest** link = &client->active;
+    while (*link != request) {
+        link = &(*link)->next;
+    }
+    *link = request->next;
+    request->next = NULL;
+    client->in_flight--;
+}
+
+// Hand queued requests to the multi handle while slots are free. Adding a
+// handle does no I/O: the transfer starts on the next poll.
+static void start_queued(AsyncEmbeddingClient* client) {
+    while (client->queue_head && client->in_flight < client->max_in_flight) {
+        EmbeddingRequest* request = client->queue_head;
+        client->queue_head = request->next;
+        if (!client->queue_head) {
+            client->queue_tail = NULL;
+        }
+        client->queued--;
+        
+        request->response.size = 0;
+        curl_easy_setopt(request->curl, CURLOPT_POSTFIELDS, request->body.data);
+        curl_easy_setopt(request->curl, CURLOPT_POSTFIELDSIZE, (long)request->body.size);
+        
+        if (curl_multi_add_handle(client->multi, request->curl) != CURLM_OK) {
+            printf("Failed to start embedding request\n");
+            finish_request(client, request, NULL);
+            continue;
+        }
+        
+        request->next = client->active;
+        client->active = request;
+        client->in_flight++;
+    }
+}
+
+// Outstanding requests are cancelled: their callbacks run with NULL
+void async_embedding_client_destroy(AsyncEmbeddingClient* client) {
+    if (!client) return;
+    
+    client->closing = 1;
+    while (client->active) {
+        EmbeddingRequest* request = client->active;
+        curl_multi_remove_handle(client->multi, request->curl);
+        unlink_active(client, request);
+        finish_request(client, request, NULL);
+    }
+    while (client->queue_head) {
+        EmbeddingRequest* request = client->queue_head;
+        client->queue_head = request->next;
+        client->queued--;
+        finish_request(client, request, NULL);
+    }
+    while (client->idle) {
+        EmbeddingRequest* request = client->idle;
+        client->idle = request->next;
+        free_request(request);
+    }
+    
+    if (client->multi) {
+        curl_multi_cleanup(client->multi);
+    }
+    curl_slist_free_all(client->headers);
+    free(client->embeddings_url);
+    free(client->base_url);
+    free(client->model_name);
+    free(client);
+    
+    // Pairs with the curl_global_init() in create, as the blocking client does
+    curl_global_cleanup();
+    printf("Async embedding client destroyed\n");
+}
+
+// Queue text for embedding; callback runs from a later poll or wait.
+// Returns 0, or -1 if the request could not be queued.
+int async_embedding_submit(AsyncEmbeddingClient* client, const char* text,
+                           EmbeddingCallback callback, void* user_data) {
+    if (!client || !text || client->closing) {
+        return -1;
+    }
+    
+    EmbeddingRequest* request = take_request(client);
+    if (!request) {
+        return -1;
+    }
+    
+    request->text = strdup(text);
+    if (!request->text || write_embedding_request(&request->body, client->model_name, text) != 0) {
+        recycle_request(client, request);
+        return -1;
+    }
+    request->callback = callback;
+    request->user_data = user_data;
+    
+    if (client->queue_tail) {
+        client->queue_tail->next = request;
+    } else {
+        client->queue_head = request;
+    }
+    client->queue_tail = request;
+    client->queued++;
+    
+    start_queued(client);
+    return 0;
+}
+
+// Advance every transfer as far as it goes without blocking and run the
+// callbacks of those that finished. Returns the requests still outstanding,
+// or -1 on error.
+int async_embedding_poll(AsyncEmbeddingClient* client) {
+    if (!client) {
+        return -1;
+    }
+    
+    int running = 0;
+    if (curl_multi_perform(client->multi, &running) != CURLM_OK) {
+        return -1;
+    }
+    
+    CURLMsg* message;
+    int remaining;
+    while ((message = curl_multi_info_read(client->multi, &remaining))) {
+        if (message->msg != CURLMSG_DONE) {
+            continue;
+        }
+        
+        // The message is invalid once its handle is removed
+        CURL* curl = message->easy_handle;
+        CURLcode result = message->data.result;
+        EmbeddingRequest* request = NULL;
+        curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char**)&request);
+        curl_multi_remove_handle(client->multi, curl);
+        unlink_active(client, request);
+        
+        EmbeddingVector* vector = NULL;
+        if (result == CURLE_OK) {
+            vector = parse_embedding_response(&request->response);
+        } else {
+            fprintf(stderr, "Embedding request failed: %s\n", curl_easy_strerror(result));
+        }
+        finish_request(client, request, vector);
+    }
+    
+    start_queued(client);
+    return async_embedding_pending(client);
+}
+
+// Block for at most timeout_ms until a transfer has something to do, then
+// poll. Returns as async_embedding_poll().
+int async_embedding_wait(AsyncEmbeddingClient* client, int timeout_ms) {
+    int pending = async_embedding_poll(client);
+    if (pending <= 0 || client->in_flight == 0) {
+        return pending;
+    }
+    
+    if (curl_multi_wait(client->multi, NULL, 0, timeout_ms, NULL) != CURLM_OK) {
+        return -1;
+    }
+    return async_embedding_poll(client);
+}
+
+// Requests submitted whose callbacks have not run yet
+int async_embedding_pending(const AsyncEmbeddingClient* client) {
+    if (!client) {
+        return 0;
+    }
+    return client->in_flight + client->queued;
+}
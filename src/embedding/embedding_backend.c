@@ -0,0 +1,334 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "../../include/embedding_backend.h"
+#include "../../include/embedding_lru.h"
+#include "../../include/utf8.h"
+#include "../../include/vector_ops.h"
+
+// Longest character n-gram hashed by the n-gram embedder
+#define NGRAM_MAX_ORDER 3
+
+// Marks the start and end of each word, so prefixes and suffixes hash
+// differently from the same characters mid-word
+#define NGRAM_BOUNDARY 0x2
+
+static EmbeddingBackend* create_backend(const EmbeddingBackendOps* ops, const char* model_name,
+                                        void* state) {
+    EmbeddingBackend* backend = calloc(1, sizeof(EmbeddingBackend));
+    if (!backend) {
+        return NULL;
+    }
+    
+    backend->model_name = strdup(model_name);
+    if (!backend->model_name) {
+        free(backend);
+        return NULL;
+    }
+    backend->ops = ops;
+    backend->batch_size = OLLAMA_DEFAULT_BATCH_SIZE;
+    backend->state = state;
+    return backend;
+}
+
+// Ollama backend: requests go through the client, with its caches and
+// circuit breaker
+
+static EmbeddingVector* ollama_embed(EmbeddingBackend* backend, const char* text, uint64_t deadline_ms) {
+    return generate_embedding_until(backend->state, text, deadline_ms);
+}
+
+static EmbeddingMatrix* ollama_embed_batch(EmbeddingBackend* backend, const char* const* texts, int count,
+                                           uint64_t deadline_ms) {
+    return generate_embeddings_batch_until(backend->state, texts, count, deadline_ms);
+}
+
+static int ollama_dimensions(const EmbeddingBackend* backend) {
+    return backend->dimensions;
+}
+
+static void ollama_destroy(EmbeddingBackend* backend) {
+    ollama_client_destroy(backend->state);
+}
+
+static const EmbeddingBackendOps ollama_ops = {
+    .name = "ollama",
+    .embed = ollama_embed,
+    .embed_batch = ollama_embed_batch,
+    .dimensions = ollama_dimensions,
+    .destroy = ollama_destroy,
+};
+
+// Backend over client, which it takes ownership of
+EmbeddingBackend* embedding_backend_create_ollama(OllamaClient* client) {
+    if (!client) {
+        return NULL;
+    }
+    
+    EmbeddingBackend* backend = create_backend(&ollama_ops, client->model_name, client);
+    if (!backend) {
+        return NULL;
+    }
+    if (client->batch_size > 0) {
+        backend->batch_size = client->batch_size;
+    }
+    return backend;
+}
+
+// N-gram backend: character uni-, bi- and trigrams of each word are hashed
+// into a fixed number of dimensions with a hash-chosen sign, and the sum is
+// scaled to unit length. Texts sharing readings share n-grams, so this gives
+// a surface-form similarity in microseconds, with no model or service.
+
+// Katakana to hiragana, full-width ASCII to ASCII, ASCII letters to lower
+// case, so the spellings of one reading hash alike
+static uint32_t fold_code_point(uint32_t code_point) {
+    if (code_point >= 0x30A1 && code_point <= 0x30F6) {
+        return code_point - 0x60;
+    }
+    if (code_point >= 0xFF01 && code_point <= 0xFF5E) {
+        code_point -= 0xFEE0;
+    }
+    if (code_point >= 'A' && code_point <= 'Z') {
+        return code_point + ('a' - 'A');
+    }
+    return code_point;
+}
+
+static int is_separator(uint32_t code_point) {
+    return code_point == ' ' || code_point == '\t' || code_point == '\n' ||
+           code_point == 0x3000;
+}
+
+static void add_gram(float* values, int dimensions, const uint32_t* gram, int order) {
+    uint64_t hash = 0xcbf29ce484222325ULL ^ (uint64_t)order;
+    for (int i = 0; i < order; i++) {
+        hash ^= gram[i];
+        hash *= 0x100000001b3ULL;
+    }
+    hash *= 0x9e3779b97f4a7c15ULL;
+    
+    int dimension = (int)((hash >> 32) % (uint64_t)dimensions);
+    values[dimension] += (hash >> 63) ? -1.0f : 1.0f;
+}
+
+static void add_word(float* values, int dimensions, const uint32_t* word, int length) {
+    // word[-1] and word[length] are boundary marks
+    for (int i = 0; i < length; i++) {
+        add_gram(values, dimensions, &word[i], 1);
+    }
+    for (int order = 2; order <= NGRAM_MAX_ORDER; order++) {
+        for (int i = -1; i + order <= length + 1; i++) {
+            add_gram(values, dimensions, &word[i], order);
+        }
+    }
+}
+
+static int ngram_embed_into(const char* text, float* values, int dimensions) {
+    memset(values, 0, sizeof(float) * dimensions);
+    
+    // One code point per byte at most, plus the two boundaries of a word
+    uint32_t* code_points = malloc(sizeof(uint32_t) * (strlen(text) + 2));
+    if (!code_points) {
+        return -1;
+    }
+    
+    int length = 0;
+    code_points[0] = NGRAM_BOUNDARY;
+    for (const char* p = text; ; ) {
+        uint32_t code_point = 0;
+        if (*p) {
+            p += utf8_decode(p, &code_point);
+        }
+        
+        if (code_point == 0 || is_separator(code_point)) {
+            if (length > 0) {
+                code_points[length + 1] = NGRAM_BOUNDARY;
+                add_word(values, dimensions, code_points + 1, length);
+            }
+            if (code_point == 0) {
+                break;
+            }
+            length = 0;
+            continue;
+        }
+        code_points[++length] = fold_code_point(code_point);
+    }
+    
+    free(code_points);
+    vector_normalize(values, dimensions);
+    return 0;
+}
+
+// Deadlines are ignored: an embedding takes well under a millisecond
+static EmbeddingVector* ngram_embed(EmbeddingBackend* backend, const char* text, uint64_t deadline_ms) {
+    (void)deadline_ms;
+    EmbeddingVector* vector = malloc(sizeof(EmbeddingVector));
+    if (!vector) {
+        return NULL;
+    }
+    
+    vector->dimensions = backend->dimensions;
+    vector->values = malloc(sizeof(float) * vector->dimensions);
+    if (!vector->values || ngram_embed_into(text, vector->values, vector->dimensions) != 0) {
+        free_embedding_vector(vector);
+        return NULL;
+    }
+    return vector;
+}
+
+static EmbeddingMatrix* ngram_embed_batch(EmbeddingBackend* backend, const char* const* texts, int count,
+                                          uint64_t deadline_ms) {
+    (void)deadline_ms;
+    EmbeddingMatrix* matrix = calloc(1, sizeof(EmbeddingMatrix));
+    if (!matrix) {
+        return NULL;
+    }
+    
+    matrix->count = count;
+    matrix->dimensions = backend->dimensions;
+    matrix->values = malloc(sizeof(float) * (size_t)count * matrix->dimensions);
+    if (!matrix->values) {
+        free_embedding_matrix(matrix);
+        return NULL;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        if (!texts[i] || ngram_embed_into(texts[i], matrix->values + (size_t)i * matrix->dimensions,
+                                          matrix->dimensions) != 0) {
+            free_embedding_matrix(matrix);
+            return NULL;
+        }
+    }
+    return matrix;
+}
+
+static int ngram_dimensions(const EmbeddingBackend* backend) {
+    return backend->dimensions;
+}
+
+static void ngram_destroy(EmbeddingBackend* backend) {
+    (void)backend;
+}
+
+static const EmbeddingBackendOps ngram_ops = {
+    .name = "ngram",
+    .embed = ngram_embed,
+    .embed_batch = ngram_embed_batch,
+    .dimensions = ngram_dimensions,
+    .destroy = ngram_destroy,
+};
+
+EmbeddingBackend* embedding_backend_create_ngram(int dimensions) {
+    if (dimensions <= 0) {
+        dimensions = NGRAM_DEFAULT_DIMENSIONS;
+    }
+    
+    // The dimensions are part of the model name, so a store built with
+    // other dimensions is rebuilt rather than loaded
+    char model_name[32];
+    snprintf(model_name, sizeof(model_name), "ngram-%d", dimensions);
+    
+    EmbeddingBackend* backend = create_backend(&ngram_ops, model_name, NULL);
+    if (!backend) {
+        return NULL;
+    }
+    backend->dimensions = dimensions;
+    backend->embeds_readings = 1;
+    backend->batch_size = 1024;
+    return backend;
+}
+
+// Backend named by kind: "ollama" (the default when kind is NULL), which
+// needs base_url and model_name, or "ngram". Ollama embeddings are kept in a
+// disk cache under settings->cache_dir; without one, or if the cache cannot
+// be opened, every text is fetched. Text used recently is also served from
+// memory if settings->memory_cache_bytes allows, and a text another backend
+// on settings->flights is already fetching is not requested twice. NULL
+// settings: defaults, without caches.
+EmbeddingBackend* embedding_backend_create(const char* kind, const char* base_url,
+                                           const char* model_name,
+                                           const EmbeddingBackendSettings* settings) {
+    if (kind && strcmp(kind, "ngram") == 0) {
+        return embedding_backend_create_ngram(NGRAM_DEFAULT_DIMENSIONS);
+    }
+    if (kind && strcmp(kind, "ollama") != 0) {
+        printf("Warning: Unknown embedding backend '%s'\n", kind);
+        return NULL;
+    }
+    
+    OllamaClient* client = ollama_client_create(base_url, model_name);
+    EmbeddingBackend* backend = embedding_backend_create_ollama(client);
+    if (!backend) {
+        ollama_client_destroy(client);
+        return NULL;
+    }
+    
+    if (!settings) {
+        return backend;
+    }
+    
+    if (settings->batch_size > 0) {
+        client->batch_size = settings->batch_size;
+        backend->batch_size = settings->batch_size;
+    }
+    circuit_breaker_init(&client->breaker, CIRCUIT_BREAKER_DEFAULT_FAILURES,
+                         CIRCUIT_BREAKER_DEFAULT_SLOW_MS, settings->breaker_cooldown_ms);
+    client->flights = settings->flights;
+    if (settings->cache_dir) {
+        backend->cache = embedding_cache_open(settings->cache_dir, settings->cache_max_bytes);
+        client->cache = backend->cache;
+    }
+    if (settings->memory_cache_bytes > 0) {
+        backend->memory_cache = embedding_lru_create(settings->memory_cache_bytes);
+        client->memory_cache = backend->memory_cache;
+    }
+    return backend;
+}
+
+void embedding_backend_destroy(EmbeddingBackend* backend) {
+    if (!backend) return;
+    
+    backend->ops->destroy(backend);
+    embedding_cache_close(backend->cache);
+    embedding_lru_destroy(backend->memory_cache);
+    free(backend->model_name);
+    free(backend);
+}
+
+EmbeddingVector* embedding_backend_embed(EmbeddingBackend* backend, const char* text,
+                                         uint64_t deadline_ms) {
+    if (!backend || !text) {
+        return NULL;
+    }
+    
+    EmbeddingVector* vector = backend->ops->embed(backend, text, deadline_ms);
+    if (vector) {
+        backend->dimensions = vector->dimensions;
+    }
+    return vector;
+}
+
+EmbeddingMatrix* embedding_backend_embed_batch(EmbeddingBackend* backend, const char* const* texts,
+                                               int count, uint64_t deadline_ms) {
+    if (!backend || !texts || count <= 0) {
+        return NULL;
+    }
+    
+    EmbeddingMatrix* matrix = backend->ops->embed_batch(backend, texts, count, deadline_ms);
+    if (matrix) {
+        backend->dimensions = matrix->dimensions;
+    }
+    return matrix;
+}
+
+int embedding_backend_dimensions(const EmbeddingBackend* backend) {
+    return backend ? backend->ops->dimensions(backend) : 0;
+}
+
+// Client behind an Ollama backend, for settings such as caches; NULL for
+// other backends
+OllamaClient* embedding_backend_ollama_client(EmbeddingBackend* backend) {
+    return backend && backend->ops == &ollama_ops ? backend->state : NULL;
+}
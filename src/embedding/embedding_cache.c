@@ -0,0 +1,415 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../../include/embedding_cache.h"
+
+#define EMBEDDING_CACHE_MAGIC "NKEC"
+#define EMBEDDING_CACHE_VERSION 1
+#define EMBEDDING_CACHE_FILE "embeddings.cache"
+#define EMBEDDING_CACHE_RECORD_MARKER 0x4345524eu
+#define EMBEDDING_CACHE_INITIAL_SLOTS 1024
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t reserved;
+} EmbeddingCacheHeader;
+
+// Record header, followed by the key (model name, '\0', text) padded to four
+// bytes and the float values; whole records are padded to eight bytes
+typedef struct {
+    uint32_t marker;
+    uint32_t checksum;      // FNV-1a of the record from hash to its end
+    uint64_t hash;
+    uint32_t key_length;
+    uint32_t dimensions;
+} EmbeddingCacheRecord;
+
+static size_t record_size(size_t key_length, size_t dimensions) {
+    size_t size = sizeof(EmbeddingCacheRecord) + ((key_length + 3) & ~(size_t)3) +
+                  sizeof(float) * dimensions;
+    return (size + 7) & ~(size_t)7;
+}
+
+static const float* record_values(const EmbeddingCacheRecord* record) {
+    return (const float*)((const char*)(record + 1) + ((record->key_length + 3) & ~3u));
+}
+
+static uint64_t hash_key(const char* model_name, const char* text) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char* p = (const unsigned char*)model_name; ; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+        if (!*p) break;
+    }
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static uint32_t record_checksum(const EmbeddingCacheRecord* record, size_t size) {
+    uint32_t checksum = 0x811c9dc5u;
+    const unsigned char* bytes = (const unsigned char*)&record->hash;
+    const unsigned char* end = (const unsigned char*)record + size;
+    for (; bytes < end; bytes++) {
+        checksum ^= *bytes;
+        checksum *= 0x01000193u;
+    }
+    return checksum;
+}
+
+static int key_matches(const EmbeddingCacheRecord* record, const char* model_name, const char* text) {
+    const char* key = (const char*)(record + 1);
+    size_t model_length = strlen(model_name);
+    return record->key_length == model_length + 1 + strlen(text) &&
+           memcmp(key, model_name, model_length + 1) == 0 &&
+           memcmp(key + model_length + 1, text, record->key_length - model_length - 1) == 0;
+}
+
+static EmbeddingCacheSlot* find_slot(const EmbeddingCache* cache, uint64_t hash) {
+    size_t mask = cache->slot_count - 1;
+    size_t slot = (size_t)hash & mask;
+    while (cache->slots[slot].offset != 0 && cache->slots[slot].hash != hash) {
+        slot = (slot + 1) & mask;
+    }
+    return &cache->slots[slot];
+}
+
+// Point hash at the record at offset; a newer record replaces an older one
+static int index_insert(EmbeddingCache* cache, uint64_t hash, uint64_t offset) {
+    if ((cache->entry_count + 1) * 2 > cache->slot_count) {
+        EmbeddingCacheSlot* old_slots = cache->slots;
+        size_t old_count = cache->slot_count;
+        size_t slot_count = old_count ? old_count * 2 : EMBEDDING_CACHE_INITIAL_SLOTS;
+        
+        cache->slots = calloc(slot_count, sizeof(EmbeddingCacheSlot));
+        if (!cache->slots) {
+            cache->slots = old_slots;
+            return -1;
+        }
+        cache->slot_count = slot_count;
+        for (size_t i = 0; i < old_count; i++) {
+            if (old_slots[i].offset != 0) {
+                *find_slot(cache, old_slots[i].hash) = old_slots[i];
+            }
+        }
+        free(old_slots);
+    }
+    
+    EmbeddingCacheSlot* slot = find_slot(cache, hash);
+    if (slot->offset == 0) {
+        cache->entry_count++;
+    }
+    slot->hash = hash;
+    slot->offset = offset;
+    return 0;
+}
+
+// Size of the valid record at offset, or 0 if it is torn or corrupt
+static size_t check_record(const char* image, size_t file_size, size_t offset) {
+    if (file_size - offset < sizeof(EmbeddingCacheRecord)) {
+        return 0;
+    }
+    
+    const EmbeddingCacheRecord* record = (const EmbeddingCacheRecord*)(image + offset);
+    if (record->marker != EMBEDDING_CACHE_RECORD_MARKER || record->dimensions == 0 ||
+        record->key_length > file_size || record->dimensions > file_size / sizeof(float)) {
+        return 0;
+    }
+    
+    size_t size = record_size(record->key_length, record->dimensions);
+    if (size > file_size - offset || record_checksum(record, size) != record->checksum) {
+        return 0;
+    }
+    return size;
+}
+
+static void unmap_log(EmbeddingCache* cache) {
+    if (cache->image) {
+        munmap(cache->image, cache->image_size);
+        cache->image = NULL;
+    }
+    if (cache->fd >= 0) {
+        close(cache->fd);
+        cache->fd = -1;
+    }
+    free(cache->slots);
+    cache->slots = NULL;
+    cache->slot_count = 0;
+    cache->entry_count = 0;
+    cache->size = 0;
+}
+
+static int write_header(int fd) {
+    EmbeddingCacheHeader header = {0};
+    memcpy(header.magic, EMBEDDING_CACHE_MAGIC, 4);
+    header.version = EMBEDDING_CACHE_VERSION;
+    return pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) ? 0 : -1;
+}
+
+// Map the log and index it, cutting off whatever follows the last valid
+// record. The mapping spans max_bytes so appends never remap.
+static int map_log(EmbeddingCache* cache) {
+    cache->fd = open(cache->path, O_RDWR | O_CREAT, 0644);
+    if (cache->fd < 0) {
+        printf("Warning: Could not open embedding cache %s\n", cache->path);
+        return -1;
+    }
+    
+    struct stat st;
+    if (fstat(cache->fd, &st) != 0) {
+        return -1;
+    }
+    size_t file_size = (size_t)st.st_size;
+    
+    EmbeddingCacheHeader header;
+    int valid = file_size >= sizeof(header) &&
+                pread(cache->fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+                memcmp(header.magic, EMBEDDING_CACHE_MAGIC, 4) == 0 &&
+                header.version == EMBEDDING_CACHE_VERSION;
+    if (!valid) {
+        if (file_size > 0) {
+            printf("Warning: Resetting invalid embedding cache %s\n", cache->path);
+        }
+        if (ftruncate(cache->fd, 0) != 0 || write_header(cache->fd) != 0) {
+            return -1;
+        }
+        file_size = sizeof(header);
+    }
+    
+    cache->image_size = file_size > cache->max_bytes ? file_size : cache->max_bytes;
+    cache->image = mmap(NULL, cache->image_size, PROT_READ, MAP_SHARED, cache->fd, 0);
+    if (cache->image == MAP_FAILED) {
+        cache->image = NULL;
+        printf("Warning: Could not map embedding cache %s\n", cache->path);
+        return -1;
+    }
+    
+    size_t offset = sizeof(header);
+    size_t size;
+    while ((size = check_record(cache->image, file_size, offset)) != 0) {
+        const EmbeddingCacheRecord* record = (const EmbeddingCacheRecord*)(cache->image + offset);
+        if (index_insert(cache, record->hash, offset) != 0) {
+            return -1;
+        }
+        offset += size;
+    }
+    
+    if (offset < file_size) {
+        printf("Warning: Discarding %zu bytes after the last valid record of %s\n",
+               file_size - offset, cache->path);
+        if (ftruncate(cache->fd, (off_t)offset) != 0) {
+            return -1;
+        }
+    }
+    cache->size = offset;
+    return 0;
+}
+
+EmbeddingCache* embedding_cache_open(const char* directory, size_t max_bytes) {
+    if (!directory) {
+        return NULL;
+    }
+    
+    if (mkdir(directory, 0755) != 0 && errno != EEXIST) {
+        printf("Warning: Could not create embedding cache directory %s\n", directory);
+        return NULL;
+    }
+    
+    EmbeddingCache* cache = calloc(1, sizeof(EmbeddingCache));
+    if (!cache) {
+        return NULL;
+    }
+    
+    // The lock on the directory is held until close, so a second cache over
+    // the same file, in this process or another, fails to open instead of
+    // appending over this one's records
+    cache->fd = -1;
+    cache->lock_fd = open(directory, O_RDONLY);
+    if (cache->lock_fd < 0 || flock(cache->lock_fd, LOCK_EX | LOCK_NB) != 0) {
+        printf("Warning: Embedding cache directory %s is in use\n", directory);
+        embedding_cache_close(cache);
+        return NULL;
+    }
+    
+    cache->max_bytes = max_bytes > sizeof(EmbeddingCacheHeader) ? max_bytes : EMBEDDING_CACHE_DEFAULT_MAX_BYTES;
+    size_t length = strlen(directory) + sizeof("/" EMBEDDING_CACHE_FILE);
+    cache->path = malloc(length);
+    if (!cache->path) {
+        embedding_cache_close(cache);
+        return NULL;
+    }
+    snprintf(cache->path, length, "%s/%s", directory, EMBEDDING_CACHE_FILE);
+    
+    if (map_log(cache) != 0) {
+        embedding_cache_close(cache);
+        return NULL;
+    }
+    
+    printf("Opened embedding cache with %zu entries from %s\n", cache->entry_count, cache->path);
+    return cache;
+}
+
+void embedding_cache_close(EmbeddingCache* cache) {
+    if (!cache) return;
+    
+    unmap_log(cache);
+    if (cache->lock_fd >= 0) {
+        close(cache->lock_fd);
+    }
+    free(cache->path);
+    free(cache);
+}
+
+// Cached embedding of text under model_name, or NULL. The values point into
+// the mapping and stay valid until the next put or compaction.
+const float* embedding_cache_get(const EmbeddingCache* cache, const char* model_name,
+                                 const char* text, int* dimensions) {
+    if (!cache || !cache->slots || !model_name || !text) {
+        return NULL;
+    }
+    
+    const EmbeddingCacheSlot* slot = find_slot(cache, hash_key(model_name, text));
+    if (slot->offset == 0) {
+        return NULL;
+    }
+    
+    const EmbeddingCacheRecord* record = (const EmbeddingCacheRecord*)(cache->image + slot->offset);
+    if (!key_matches(record, model_name, text)) {
+        return NULL;
+    }
+    
+    if (dimensions) {
+        *dimensions = (int)record->dimensions;
+    }
+    return record_values(record);
+}
+
+// Append one record, compacting first if it would take the file past the
+// cap. Records are not synced: a crash loses at most the unsynced tail.
+int embedding_cache_put(EmbeddingCache* cache, const char* model_name, const char* text,
+                        const float* values, int dimensions) {
+    if (!cache || cache->fd < 0 || !model_name || !text || !values || dimensions <= 0) {
+        return -1;
+    }
+    
+    size_t model_length = strlen(model_name);
+    size_t key_length = model_length + 1 + strlen(text);
+    size_t size = record_size(key_length, (size_t)dimensions);
+    if (size > cache->max_bytes - sizeof(EmbeddingCacheHeader)) {
+        return -1;
+    }
+    
+    // Compact to three quarters of the cap, so puts do not compact every time
+    if (cache->size + size > cache->max_bytes) {
+        size_t target = cache->max_bytes / 4 * 3;
+        target = target > size ? target - size : cache->max_bytes - size;
+        if (embedding_cache_compact(cache, target) != 0) {
+            return -1;
+        }
+    }
+    
+    EmbeddingCacheRecord* record = calloc(1, size);
+    if (!record) {
+        return -1;
+    }
+    
+    record->marker = EMBEDDING_CACHE_RECORD_MARKER;
+    record->hash = hash_key(model_name, text);
+    record->key_length = (uint32_t)key_length;
+    record->dimensions = (uint32_t)dimensions;
+    char* key = (char*)(record + 1);
+    memcpy(key, model_name, model_length + 1);
+    memcpy(key + model_length + 1, text, key_length - model_length - 1);
+    memcpy((float*)record_values(record), values, sizeof(float) * dimensions);
+    record->checksum = record_checksum(record, size);
+    
+    int ok = pwrite(cache->fd, record, size, (off_t)cache->size) == (ssize_t)size &&
+             index_insert(cache, record->hash, cache->size) == 0;
+    free(record);
+    if (!ok) {
+        // Never leave a partial record for the next open to discard
+        if (ftruncate(cache->fd, (off_t)cache->size) != 0) {
+            printf("Warning: Could not truncate embedding cache %s\n", cache->path);
+        }
+        return -1;
+    }
+    
+    cache->size += size;
+    return 0;
+}
+
+// Rewrite the log with only the newest record of each key, dropping the
+// oldest records until it fits in target_bytes. The new log replaces the old
+// one by rename, so a crash leaves one or the other.
+int embedding_cache_compact(EmbeddingCache* cache, size_t target_bytes) {
+    if (!cache || cache->fd < 0) {
+        return -1;
+    }
+    
+    // Live records, oldest first
+    size_t* live = malloc(sizeof(size_t) * (cache->entry_count + 1));
+    if (!live) {
+        return -1;
+    }
+    size_t live_count = 0;
+    for (size_t offset = sizeof(EmbeddingCacheHeader); offset < cache->size; ) {
+        const EmbeddingCacheRecord* record = (const EmbeddingCacheRecord*)(cache->image + offset);
+        if (find_slot(cache, record->hash)->offset == offset) {
+            live[live_count++] = offset;
+        }
+        offset += record_size(record->key_length, record->dimensions);
+    }
+    
+    // Keep the newest records that fit
+    size_t first = live_count;
+    size_t total = sizeof(EmbeddingCacheHeader);
+    while (first > 0) {
+        const EmbeddingCacheRecord* record = (const EmbeddingCacheRecord*)(cache->image + live[first - 1]);
+        size_t size = record_size(record->key_length, record->dimensions);
+        if (total + size > target_bytes) {
+            break;
+        }
+        total += size;
+        first--;
+    }
+    
+    char temp_path[4096];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", cache->path);
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int ok = fd >= 0 && write_header(fd) == 0;
+    
+    size_t position = sizeof(EmbeddingCacheHeader);
+    for (size_t i = first; ok && i < live_count; i++) {
+        const EmbeddingCacheRecord* record = (const EmbeddingCacheRecord*)(cache->image + live[i]);
+        size_t size = record_size(record->key_length, record->dimensions);
+        ok = pwrite(fd, record, size, (off_t)position) == (ssize_t)size;
+        position += size;
+    }
+    free(live);
+    
+    if (fd >= 0 && (fsync(fd) != 0 || close(fd) != 0)) {
+        ok = 0;
+    }
+    if (!ok || rename(temp_path, cache->path) != 0) {
+        printf("Warning: Failed to compact embedding cache %s\n", cache->path);
+        remove(temp_path);
+        return -1;
+    }
+    
+    unmap_log(cache);
+    if (map_log(cache) != 0) {
+        return -1;
+    }
+    
+    printf("Compacted embedding cache to %zu entries (%zu bytes)\n", cache->entry_count, cache->size);
+    return 0;
+}
@@ -0,0 +1,170 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../../include/embedding_flight.h"
+
+static uint64_t hash_key(const char* model_name, const char* text) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char* p = (const unsigned char*)model_name; *p; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    hash *= 0x100000001b3ULL;
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+EmbeddingFlightGroup* embedding_flight_group_create(void) {
+    EmbeddingFlightGroup* group = calloc(1, sizeof(EmbeddingFlightGroup));
+    if (!group) {
+        return NULL;
+    }
+    
+    if (pthread_mutex_init(&group->lock, NULL) != 0) {
+        free(group);
+        return NULL;
+    }
+    if (pthread_cond_init(&group->landed, NULL) != 0) {
+        pthread_mutex_destroy(&group->lock);
+        free(group);
+        return NULL;
+    }
+    return group;
+}
+
+// No flight may be out: every embedding_flight_do() call must have returned
+void embedding_flight_group_destroy(EmbeddingFlightGroup* group) {
+    if (!group) return;
+    
+    pthread_cond_destroy(&group->landed);
+    pthread_mutex_destroy(&group->lock);
+    free(group);
+}
+
+static EmbeddingVector* copy_vector(const EmbeddingVector* vector) {
+    if (!vector) {
+        return NULL;
+    }
+    
+    EmbeddingVector* copy = malloc(sizeof(EmbeddingVector));
+    if (!copy) {
+        return NULL;
+    }
+    copy->dimensions = vector->dimensions;
+    copy->values = malloc(sizeof(float) * vector->dimensions);
+    if (!copy->values) {
+        free(copy);
+        return NULL;
+    }
+    memcpy(copy->values, vector->values, sizeof(float) * vector->dimensions);
+    return copy;
+}
+
+// Condition variables wait on the wall clock, which macOS cannot change
+static void wall_clock_deadline(uint64_t deadline_ms, struct timespec* ts) {
+    uint64_t now = embedding_clock_ms();
+    uint64_t left = deadline_ms > now ? deadline_ms - now : 0;
+    
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec += (time_t)(left / 1000);
+    ts->tv_nsec += (long)(left % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+// Called with the lock held by a follower leaving flight
+static void leave_flight(EmbeddingFlight* flight) {
+    if (--flight->followers == 0 && flight->done) {
+        free_embedding_vector(flight->result);
+        free(flight);
+    }
+}
+
+// Wait for the fetch of flight; a copy of its result, or NULL if it failed
+// or deadline_ms passed first
+static EmbeddingVector* follow_flight(EmbeddingFlightGroup* group, EmbeddingFlight* flight,
+                                      uint64_t deadline_ms) {
+    flight->followers++;
+    group->coalesced++;
+    
+    struct timespec until;
+    if (deadline_ms != EMBEDDING_NO_DEADLINE) {
+        wall_clock_deadline(deadline_ms, &until);
+    }
+    while (!flight->done) {
+        if (deadline_ms == EMBEDDING_NO_DEADLINE) {
+            pthread_cond_wait(&group->landed, &group->lock);
+        } else if (pthread_cond_timedwait(&group->landed, &group->lock, &until) != 0 &&
+                   !flight->done) {
+            leave_flight(flight);
+            return NULL;
+        }
+    }
+    
+    EmbeddingVector* vector = copy_vector(flight->result);
+    leave_flight(flight);
+    return vector;
+}
+
+// Embedding of text under model_name. If the same key is already being
+// fetched, waits for that fetch, at most until deadline_ms, and returns a
+// copy of its result; otherwise runs fetch(context, text) itself. The result
+// is owned by the caller.
+EmbeddingVector* embedding_flight_do(EmbeddingFlightGroup* group, const char* model_name,
+                                     const char* text, uint64_t deadline_ms,
+                                     EmbeddingFetch fetch, void* context) {
+    if (!group || !model_name || !text || !fetch) {
+        return fetch && text ? fetch(context, text) : NULL;
+    }
+    
+    uint64_t hash = hash_key(model_name, text);
+    pthread_mutex_lock(&group->lock);
+    for (EmbeddingFlight* flight = group->flights; flight; flight = flight->next) {
+        if (flight->hash == hash && strcmp(flight->text, text) == 0 &&
+            strcmp(flight->model_name, model_name) == 0) {
+            EmbeddingVector* vector = follow_flight(group, flight, deadline_ms);
+            pthread_mutex_unlock(&group->lock);
+            return vector;
+        }
+    }
+    
+    // Without memory for a flight, fetch alone rather than fail
+    EmbeddingFlight* flight = calloc(1, sizeof(EmbeddingFlight));
+    if (flight) {
+        flight->model_name = model_name;
+        flight->text = text;
+        flight->hash = hash;
+        flight->next = group->flights;
+        group->flights = flight;
+    }
+    group->fetches++;
+    pthread_mutex_unlock(&group->lock);
+    
+    EmbeddingVector* vector = fetch(context, text);
+    if (!flight) {
+        return vector;
+    }
+    
+    pthread_mutex_lock(&group->lock);
+    EmbeddingFlight** link = &group->flights;
+    while (*link != flight) {
+        link = &(*link)->next;
+    }
+    *link = flight->next;
+    
+    // Later callers start a new flight; the followers so far take the result
+    flight->done = 1;
+    if (flight->followers > 0) {
+        flight->result = copy_vector(vector);
+        pthread_cond_broadcast(&group->landed);
+    } else {
+        free(flight);
+    }
+    pthread_mutex_unlock(&group->lock);
+    return vector;
+}
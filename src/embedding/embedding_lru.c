@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/embedding_lru.h"
+
+#define EMBEDDING_LRU_INITIAL_BUCKETS 64
+
+static uint64_t hash_text(const char* text) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+// The low bits pick the bucket within a shard. FNV-1a leaves the top bits
+// of short keys poorly mixed, so the shard comes from a multiplicative hash.
+static EmbeddingLruShard* shard_for(EmbeddingLru* lru, uint64_t hash) {
+    return &lru->shards[((hash * 0x9e3779b97f4a7c15ULL) >> 60) % EMBEDDING_LRU_SHARDS];
+}
+
+static void drop_reference(EmbeddingLruEntry* entry) {
+    if (__atomic_sub_fetch(&entry->references, 1, __ATOMIC_ACQ_REL) == 0) {
+        free(entry);
+    }
+}
+
+EmbeddingLru* embedding_lru_create(size_t budget) {
+    EmbeddingLru* lru = calloc(1, sizeof(EmbeddingLru));
+    if (!lru) {
+        return NULL;
+    }
+    
+    lru->budget = budget > 0 ? budget : EMBEDDING_LRU_DEFAULT_BUDGET;
+    for (int i = 0; i < EMBEDDING_LRU_SHARDS; i++) {
+        EmbeddingLruShard* shard = &lru->shards[i];
+        shard->budget = lru->budget / EMBEDDING_LRU_SHARDS;
+        shard->bucket_count = EMBEDDING_LRU_INITIAL_BUCKETS;
+        shard->buckets = calloc(shard->bucket_count, sizeof(EmbeddingLruEntry*));
+        if (!shard->buckets) {
+            while (--i >= 0) {
+                free(lru->shards[i].buckets);
+                pthread_mutex_destroy(&lru->shards[i].lock);
+            }
+            free(lru);
+            return NULL;
+        }
+        pthread_mutex_init(&shard->lock, NULL);
+    }
+    
+    return lru;
+}
+
+// Vectors still borrowed stay valid until they are released
+void embedding_lru_destroy(EmbeddingLru* lru) {
+    if (!lru) return;
+    
+    for (int i = 0; i < EMBEDDING_LRU_SHARDS; i++) {
+        EmbeddingLruShard* shard = &lru->shards[i];
+        EmbeddingLruEntry* entry = shard->newest;
+        while (entry) {
+            EmbeddingLruEntry* older = entry->older;
+            drop_reference(entry);
+            entry = older;
+        }
+        free(shard->buckets);
+        pthread_mutex_destroy(&shard->lock);
+    }
+    free(lru);
+}
+
+static EmbeddingLruEntry** find_link(EmbeddingLruShard* shard, uint64_t hash, const char* text) {
+    EmbeddingLruEntry** link = &shard->buckets[hash & (shard->bucket_count - 1)];
+    while (*link && ((*link)->hash != hash || strcmp((*link)->text, text) != 0)) {
+        link = &(*link)->chain;
+    }
+    return link;
+}
+
+static void unlink_recency(EmbeddingLruShard* shard, EmbeddingLruEntry* entry) {
+    if (entry->newer) {
+        entry->newer->older = entry->older;
+    } else {
+        shard->newest = entry->older;
+    }
+    if (entry->older) {
+        entry->older->newer = entry->newer;
+    } else {
+        shard->oldest = entry->newer;
+    }
+    entry->newer = NULL;
+    entry->older = NULL;
+}
+
+static void push_newest(EmbeddingLruShard* shard, EmbeddingLruEntry* entry) {
+    entry->older = shard->newest;
+    entry->newer = NULL;
+    if (shard->newest) {
+        shard->newest->newer = entry;
+    } else {
+        shard->oldest = entry;
+    }
+    shard->newest = entry;
+}
+
+static void evict_oldest(EmbeddingLruShard* shard) {
+    EmbeddingLruEntry* entry = shard->oldest;
+    *find_link(shard, entry->hash, entry->text) = entry->chain;
+    unlink_recency(shard, entry);
+    shard->entry_count--;
+    shard->bytes -= entry->bytes;
+    shard->evictions++;
+    drop_reference(entry);
+}
+
+// Double the buckets once they average one entry; a failed resize only
+// leaves the chains longer
+static void grow_buckets(EmbeddingLruShard* shard) {
+    size_t bucket_count = shard->bucket_count * 2;
+    EmbeddingLruEntry** buckets = calloc(bucket_count, sizeof(EmbeddingLruEntry*));
+    if (!buckets) {
+        return;
+    }
+    
+    for (size_t i = 0; i < shard->bucket_count; i++) {
+        EmbeddingLruEntry* entry = shard->buckets[i];
+        while (entry) {
+            EmbeddingLruEntry* next = entry->chain;
+            size_t bucket = entry->hash & (bucket_count - 1);
+            entry->chain = buckets[bucket];
+            buckets[bucket] = entry;
+            entry = next;
+        }
+    }
+    free(shard->buckets);
+    shard->buckets = buckets;
+    shard->bucket_count = bucket_count;
+}
+
+// Borrowed vector cached for text, or NULL. Release it with
+// embedding_lru_release().
+const EmbeddingVector* embedding_lru_get(EmbeddingLru* lru, const char* text) {
+    if (!lru || !text) {
+        return NULL;
+    }
+    
+    uint64_t hash = hash_text(text);
+    EmbeddingLruShard* shard = shard_for(lru, hash);
+    
+    pthread_mutex_lock(&shard->lock);
+    EmbeddingLruEntry* entry = *find_link(shard, hash, text);
+    if (entry) {
+        unlink_recency(shard, entry);
+        push_newest(shard, entry);
+        __atomic_add_fetch(&entry->references, 1, __ATOMIC_RELAXED);
+        shard->hits++;
+    } else {
+        shard->misses++;
+    }
+    pthread_mutex_unlock(&shard->lock);
+    
+    return entry ? &entry->vector : NULL;
+}
+
+// Cache a copy of values under text, evicting the least recently used
+// entries to stay within budget, and return it borrowed. If text is already
+// cached the existing vector is returned instead. An entry larger than a
+// shard's budget is returned without being kept.
+const EmbeddingVector* embedding_lru_put(EmbeddingLru* lru, const char* text,
+                                         const float* values, int dimensions) {
+    if (!lru || !text || !values || dimensions <= 0) {
+        return NULL;
+    }
+    
+    size_t text_size = strlen(text) + 1;
+    size_t bytes = sizeof(EmbeddingLruEntry) + sizeof(float) * dimensions + text_size;
+    EmbeddingLruEntry* entry = malloc(bytes);
+    if (!entry) {
+        return NULL;
+    }
+    
+    float* entry_values = (float*)(entry + 1);
+    char* entry_text = (char*)(entry_values + dimensions);
+    memcpy(entry_values, values, sizeof(float) * dimensions);
+    memcpy(entry_text, text, text_size);
+    entry->vector.values = entry_values;
+    entry->vector.dimensions = dimensions;
+    entry->hash = hash_text(text);
+    entry->text = entry_text;
+    entry->bytes = bytes;
+    entry->references = 1;
+    entry->newer = NULL;
+    entry->older = NULL;
+    entry->chain = NULL;
+    
+    EmbeddingLruShard* shard = shard_for(lru, entry->hash);
+    pthread_mutex_lock(&shard->lock);
+    
+    // Another thread cached the same text first
+    EmbeddingLruEntry** link = find_link(shard, entry->hash, text);
+    if (*link) {
+        EmbeddingLruEntry* existing = *link;
+        __atomic_add_fetch(&existing->references, 1, __ATOMIC_RELAXED);
+        pthread_mutex_unlock(&shard->lock);
+        free(entry);
+        return &existing->vector;
+    }
+    
+    if (bytes <= shard->budget) {
+        while (shard->bytes + bytes > shard->budget) {
+            evict_oldest(shard);
+        }
+        if (shard->entry_count >= shard->bucket_count) {
+            grow_buckets(shard);
+        }
+        
+        // Evictions and growth may both have moved the end of the chain
+        link = find_link(shard, entry->hash, text);
+        *link = entry;
+        push_newest(shard, entry);
+        shard->entry_count++;
+        shard->bytes += bytes;
+        entry->references++;
+    }
+    
+    pthread_mutex_unlock(&shard->lock);
+    return &entry->vector;
+}
+
+// Give back a vector from embedding_lru_get() or embedding_lru_put()
+void embedding_lru_release(const EmbeddingVector* vector) {
+    if (vector) {
+        drop_reference((EmbeddingLruEntry*)vector);
+    }
+}
+
+void embedding_lru_stats(EmbeddingLru* lru, EmbeddingLruStats* stats) {
+    if (!stats) return;
+    
+    memset(stats, 0, sizeof(*stats));
+    if (!lru) return;
+    
+    for (int i = 0; i < EMBEDDING_LRU_SHARDS; i++) {
+        EmbeddingLruShard* shard = &lru->shards[i];
+        pthread_mutex_lock(&shard->lock);
+        stats->hits += shard->hits;
+        stats->misses += shard->misses;
+        stats->evictions += shard->evictions;
+        stats->entries += shard->entry_count;
+        stats->bytes += shard->bytes;
+        pthread_mutex_unlock(&shard->lock);
+    }
+}
@@ -0,0 +1,579 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../../include/embedding_store.h"
+#include "../../include/vector_ops.h"
+
+#define EMBEDDING_STORE_MAGIC "NKES"
+#define EMBEDDING_STORE_VERSION 6
+
+// On-disk header, followed by the model name and four sections, each
+// starting at a multiple of VECTOR_ALIGNMENT: the padded row-major values
+// (floats or halves, per precision), the per-row int8 scales, the int8 rows
+// (quantized_offset 0 if absent) and the signatures (signatures_offset 0 if
+// absent)
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t dictionary_hash;
+    uint32_t entry_count;
+    uint32_t dimensions;
+    uint32_t model_name_length;
+    uint32_t stride;
+    uint64_t values_offset;
+    uint64_t scales_offset;
+    uint64_t quantized_offset;
+    uint32_t quantized_stride;
+    uint32_t precision;
+    uint64_t signatures_offset;
+    uint32_t signature_words;
+    uint32_t reserved;
+} EmbeddingStoreHeader;
+
+static size_t element_size(EmbeddingPrecision precision) {
+    return precision == EmbeddingPrecisionF32 ? sizeof(float) : sizeof(uint16_t);
+}
+
+// Rows take whole cache lines: VECTOR_ROW_PAD floats, or twice as many halves
+static size_t padded_stride(int dimensions, EmbeddingPrecision precision) {
+    size_t pad = VECTOR_ROW_PAD * sizeof(float) / element_size(precision);
+    return ((size_t)dimensions + pad - 1) / pad * pad;
+}
+
+static size_t align_up(size_t offset) {
+    return (offset + VECTOR_ALIGNMENT - 1) / VECTOR_ALIGNMENT * VECTOR_ALIGNMENT;
+}
+
+static void* aligned_zero_alloc(size_t bytes) {
+    void* memory = NULL;
+    if (posix_memalign(&memory, VECTOR_ALIGNMENT, bytes) != 0) {
+        return NULL;
+    }
+    memset(memory, 0, bytes);
+    return memory;
+}
+
+// Fill in the section offsets; returns the total file size
+static size_t layout_sections(EmbeddingStoreHeader* header, int quantized, int signed_rows) {
+    size_t rows = header->entry_count;
+    size_t end = sizeof(EmbeddingStoreHeader) + header->model_name_length;
+    
+    header->values_offset = align_up(end);
+    end = header->values_offset + element_size(header->precision) * rows * header->stride;
+    
+    header->scales_offset = 0;
+    header->quantized_offset = 0;
+    if (quantized) {
+        header->scales_offset = align_up(end);
+        end = header->scales_offset + sizeof(float) * rows;
+        header->quantized_offset = align_up(end);
+        end = header->quantized_offset + rows * header->quantized_stride;
+    }
+    
+    header->signatures_offset = 0;
+    if (signed_rows) {
+        header->signatures_offset = align_up(end);
+        end = header->signatures_offset + sizeof(uint64_t) * rows * header->signature_words;
+    }
+    return end;
+}
+
+EmbeddingStore* embedding_store_create(const char* model_name, uint64_t dictionary_hash,
+                                       int entry_count, int dimensions) {
+    if (!model_name || entry_count < 0 || dimensions <= 0) {
+        return NULL;
+    }
+    
+    EmbeddingStore* store = calloc(1, sizeof(EmbeddingStore));
+    if (!store) {
+        return NULL;
+    }
+    
+    store->model_name = strdup(model_name);
+    store->dictionary_hash = dictionary_hash;
+    store->entry_count = entry_count;
+    store->dimensions = dimensions;
+    store->precision = EmbeddingPrecisionF32;
+    store->stride = padded_stride(dimensions, EmbeddingPrecisionF32);
+    store->quantized_stride = align_up((size_t)dimensions);
+    store->signature_words = (dimensions + 63) / 64;
+    store->complete = 1;
+    
+    // At least one row so an empty store still owns a valid buffer
+    size_t rows = (size_t)(entry_count > 0 ? entry_count : 1);
+    store->values = aligned_zero_alloc(sizeof(float) * store->stride * rows);
+    if (!store->model_name || !store->values) {
+        embedding_store_destroy(store);
+        return NULL;
+    }
+    
+    return store;
+}
+
+void embedding_store_destroy(EmbeddingStore* store) {
+    if (!store) return;
+    
+    if (store->image) {
+        munmap(store->image, store->image_size);
+    } else {
+        free(store->values);
+        free(store->half_values);
+        free(store->scales);
+        free(store->quantized);
+        free(store->signatures);
+    }
+    free(store->model_name);
+    free(store);
+}
+
+// Build the int8 copy of every row used for approximate scoring
+int embedding_store_quantize(EmbeddingStore* store) {
+    if (!store || store->image) {
+        return -1;
+    }
+    
+    size_t rows = (size_t)(store->entry_count > 0 ? store->entry_count : 1);
+    float* scales = aligned_zero_alloc(sizeof(float) * rows);
+    int8_t* quantized = aligned_zero_alloc(store->quantized_stride * rows);
+    float* buffer = malloc(sizeof(float) * store->dimensions);
+    if (!scales || !quantized || !buffer) {
+        free(scales);
+        free(quantized);
+        free(buffer);
+        return -1;
+    }
+    
+    for (int i = 0; i < store->entry_count; i++) {
+        scales[i] = vector_quantize_i8(embedding_store_read_row(store, i, buffer), store->dimensions,
+                                       quantized + (size_t)i * store->quantized_stride);
+    }
+    
+    free(buffer);
+    free(store->scales);
+    free(store->quantized);
+    store->scales = scales;
+    store->quantized = quantized;
+    return 0;
+}
+
+// Build the sign-bit signature of every row used for Hamming shortlists
+int embedding_store_build_signatures(EmbeddingStore* store) {
+    if (!store || store->image) {
+        return -1;
+    }
+    
+    size_t rows = (size_t)(store->entry_count > 0 ? store->entry_count : 1);
+    uint64_t* signatures = aligned_zero_alloc(sizeof(uint64_t) * store->signature_words * rows);
+    float* buffer = malloc(sizeof(float) * store->dimensions);
+    if (!signatures || !buffer) {
+        free(signatures);
+        free(buffer);
+        return -1;
+    }
+    
+    for (int i = 0; i < store->entry_count; i++) {
+        vector_sign_bits(embedding_store_read_row(store, i, buffer), store->dimensions,
+                         signatures + (size_t)i * store->signature_words);
+    }
+    
+    free(buffer);
+    free(store->signatures);
+    store->signatures = signatures;
+    return 0;
+}
+
+// Convert the float rows to fp16 or bf16, halving their memory. Converted
+// rows cannot be made floats again, and mapped stores cannot be converted.
+int embedding_store_set_precision(EmbeddingStore* store, EmbeddingPrecision precision) {
+    if (!store || store->image || precision < EmbeddingPrecisionF32 ||
+        precision > EmbeddingPrecisionBF16) {
+        return -1;
+    }
+    if (precision == store->precision) {
+        return 0;
+    }
+    if (store->precision != EmbeddingPrecisionF32) {
+        return -1;
+    }
+    
+    size_t stride = padded_stride(store->dimensions, precision);
+    size_t rows = (size_t)(store->entry_count > 0 ? store->entry_count : 1);
+    uint16_t* half_values = aligned_zero_alloc(sizeof(uint16_t) * stride * rows);
+    if (!half_values) {
+        return -1;
+    }
+    
+    for (int i = 0; i < store->entry_count; i++) {
+        const float* row = embedding_store_row(store, i);
+        uint16_t* half_row = half_values + (size_t)i * stride;
+        if (precision == EmbeddingPrecisionF16) {
+            vector_to_f16(row, store->dimensions, half_row);
+        } else {
+            vector_to_bf16(row, store->dimensions, half_row);
+        }
+    }
+    
+    free(store->values);
+    store->values = NULL;
+    store->half_values = half_values;
+    store->stride = stride;
+    store->precision = precision;
+    return 0;
+}
+
+static int write_section(FILE* file, size_t* position, size_t offset, const void* data, size_t size) {
+    static const char padding[VECTOR_ALIGNMENT] = {0};
+    size_t padding_length = offset - *position;
+    
+    if (padding_length > sizeof(padding) ||
+        fwrite(padding, 1, padding_length, file) != padding_length ||
+        fwrite(data, 1, size, file) != size) {
+        return -1;
+    }
+    *position = offset + size;
+    return 0;
+}
+
+int embedding_store_save(const EmbeddingStore* store, const char* path) {
+    if (!store || !path) {
+        return -1;
+    }
+    
+    // Write to a temporary file and rename, so processes that still have the
+    // old store mapped keep a consistent image
+    char temp_path[4096];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    
+    FILE* file = fopen(temp_path, "wb");
+    if (!file) {
+        printf("Warning: Could not write embedding store to %s\n", path);
+        return -1;
+    }
+    
+    EmbeddingStoreHeader header = {0};
+    memcpy(header.magic, EMBEDDING_STORE_MAGIC, 4);
+    header.version = EMBEDDING_STORE_VERSION;
+    header.dictionary_hash = store->dictionary_hash;
+    header.entry_count = (uint32_t)store->entry_count;
+    header.dimensions = (uint32_t)store->dimensions;
+    header.model_name_length = (uint32_t)strlen(store->model_name);
+    header.stride = (uint32_t)store->stride;
+    header.quantized_stride = (uint32_t)store->quantized_stride;
+    header.precision = (uint32_t)store->precision;
+    header.signature_words = (uint32_t)store->signature_words;
+    layout_sections(&header, store->quantized != NULL, store->signatures != NULL);
+    
+    size_t rows = (size_t)store->entry_count;
+    size_t position = 0;
+    int ok = write_section(file, &position, 0, &header, sizeof(header)) == 0 &&
+             write_section(file, &position, position, store->model_name, header.model_name_length) == 0 &&
+             write_section(file, &position, header.values_offset,
+                           store->values ? (const void*)store->values : (const void*)store->half_values,
+                           embedding_store_row_bytes(store) * rows) == 0;
+    if (ok && store->quantized) {
+        ok = write_section(file, &position, header.scales_offset, store->scales,
+                           sizeof(float) * rows) == 0 &&
+             write_section(file, &position, header.quantized_offset, store->quantized,
+                           rows * store->quantized_stride) == 0;
+    }
+    if (ok && store->signatures) {
+        ok = write_section(file, &position, header.signatures_offset, store->signatures,
+                           sizeof(uint64_t) * rows * store->signature_words) == 0;
+    }
+    
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    
+    if (!ok || rename(temp_path, path) != 0) {
+        printf("Warning: Failed to write embedding store to %s\n", path);
+        remove(temp_path);
+        return -1;
+    }
+    
+    printf("Saved embedding store with %d entries to %s\n", store->entry_count, path);
+    return 0;
+}
+
+// The store is mapped, not read: only the pages a query touches become
+// resident, so scanning the int8 rows never pulls in the full rows. The
+// rows keep the precision they were saved with.
+EmbeddingStore* embedding_store_load(const char* path, const char* model_name,
+                                     uint64_t dictionary_hash, int entry_count) {
+    if (!path || !model_name) {
+        return NULL;
+    }
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(EmbeddingStoreHeader)) {
+        printf("Warning: Ignoring invalid embedding store %s\n", path);
+        close(fd);
+        return NULL;
+    }
+    
+    size_t image_size = (size_t)st.st_size;
+    char* image = mmap(NULL, image_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        printf("Warning: Could not map embedding store %s\n", path);
+        return NULL;
+    }
+    
+    EmbeddingStoreHeader header;
+    memcpy(&header, image, sizeof(header));
+    
+    EmbeddingStoreHeader expected = header;
+    size_t expected_size = 0;
+    int valid = memcmp(header.magic, EMBEDDING_STORE_MAGIC, 4) == 0 &&
+                header.version == EMBEDDING_STORE_VERSION &&
+                header.dimensions > 0 &&
+                header.precision <= EmbeddingPrecisionBF16 &&
+                header.stride == padded_stride((int)header.dimensions, header.precision) &&
+                header.quantized_stride == align_up(header.dimensions) &&
+                header.signature_words == (header.dimensions + 63) / 64;
+    if (valid) {
+        expected_size = layout_sections(&expected, header.quantized_offset != 0,
+                                        header.signatures_offset != 0);
+        valid = expected_size == image_size &&
+                expected.values_offset == header.values_offset &&
+                expected.scales_offset == header.scales_offset &&
+                expected.quantized_offset == header.quantized_offset &&
+                expected.signatures_offset == header.signatures_offset;
+    }
+    if (!valid) {
+        printf("Warning: Ignoring invalid embedding store %s\n", path);
+        munmap(image, image_size);
+        return NULL;
+    }
+    
+    // A store built from another model or dictionary revision is stale
+    const char* name = image + sizeof(header);
+    if (header.model_name_length != strlen(model_name) ||
+        memcmp(name, model_name, header.model_name_length) != 0 ||
+        header.dictionary_hash != dictionary_hash ||
+        header.entry_count != (uint32_t)entry_count) {
+        printf("Embedding store %s does not match the current model/dictionary\n", path);
+        munmap(image, image_size);
+        return NULL;
+    }
+    
+    EmbeddingStore* store = calloc(1, sizeof(EmbeddingStore));
+    if (!store || !(store->model_name = strdup(model_name))) {
+        free(store);
+        munmap(image, image_size);
+        return NULL;
+    }
+    
+    store->dictionary_hash = dictionary_hash;
+    store->entry_count = entry_count;
+    store->dimensions = (int)header.dimensions;
+    store->precision = (EmbeddingPrecision)header.precision;
+    store->stride = header.stride;
+    if (store->precision == EmbeddingPrecisionF32) {
+        store->values = (float*)(image + header.values_offset);
+    } else {
+        store->half_values = (uint16_t*)(image + header.values_offset);
+    }
+    store->quantized_stride = header.quantized_stride;
+    if (header.quantized_offset) {
+        store->scales = (float*)(image + header.scales_offset);
+        store->quantized = (int8_t*)(image + header.quantized_offset);
+    }
+    store->signature_words = (int)header.signature_words;
+    if (header.signatures_offset) {
+        store->signatures = (uint64_t*)(image + header.signatures_offset);
+    }
+    store->image = image;
+    store->image_size = image_size;
+    store->complete = 1;
+    
+    printf("Mapped embedding store with %d entries from %s\n", store->entry_count, path);
+    return store;
+}
+
+// Float row of an F32 store; NULL for fp16 and bf16 stores, which are read
+// with embedding_store_read_row() or scored with embedding_store_dot()
+const float* embedding_store_row(const EmbeddingStore* store, int entry_id) {
+    if (!store || !store->values || entry_id < 0 || entry_id >= store->entry_count) {
+        return NULL;
+    }
+    
+    return store->values + (size_t)entry_id * store->stride;
+}
+
+// Rows of a mapped store are read-only
+float* embedding_store_mutable_row(EmbeddingStore* store, int entry_id) {
+    if (!store || store->image) {
+        return NULL;
+    }
+    return (float*)embedding_store_row(store, entry_id);
+}
+
+// Row entry_id as floats: the row itself in an F32 store, else widened into
+// buffer (dimensions floats)
+const float* embedding_store_read_row(const EmbeddingStore* store, int entry_id, float* buffer) {
+    if (!store || entry_id < 0 || entry_id >= store->entry_count) {
+        return NULL;
+    }
+    if (store->values) {
+        return embedding_store_row(store, entry_id);
+    }
+    
+    const uint16_t* row = store->half_values + (size_t)entry_id * store->stride;
+    if (store->precision == EmbeddingPrecisionF16) {
+        vector_from_f16(row, store->dimensions, buffer);
+    } else {
+        vector_from_bf16(row, store->dimensions, buffer);
+    }
+    return buffer;
+}
+
+// Dot product of query with one row, whatever its precision
+float embedding_store_dot(const EmbeddingStore* store, int entry_id, const float* query) {
+    if (!store || !query || entry_id < 0 || entry_id >= store->entry_count) {
+        return 0.0f;
+    }
+    
+    size_t offset = (size_t)entry_id * store->stride;
+    switch (store->precision) {
+        case EmbeddingPrecisionF16:
+            return vector_dot_f16(store->half_values + offset, query, store->dimensions);
+        case EmbeddingPrecisionBF16:
+            return vector_dot_bf16(store->half_values + offset, query, store->dimensions);
+        default:
+            return vector_dot(store->values + offset, query, store->dimensions);
+    }
+}
+
+// Bytes between row starts of the full-precision (not int8) rows
+size_t embedding_store_row_bytes(const EmbeddingStore* store) {
+    return store ? element_size(store->precision) * store->stride : 0;
+}
+
+// Dot product of query (dimensions floats, unit length) with every row, i.e.
+// the cosine similarity to every entry, in one pass over the matrix. Half
+// precision rows are widened as they are read, so the pass moves half the
+// bytes of a float scan.
+int embedding_store_score(const EmbeddingStore* store, const float* query, float* scores) {
+    if (!store || !query || !scores) {
+        return -1;
+    }
+    
+    switch (store->precision) {
+        case EmbeddingPrecisionF16:
+            vector_gemv_f16(store->half_values, store->entry_count, store->dimensions, store->stride,
+                            query, scores);
+            break;
+        case EmbeddingPrecisionBF16:
+            vector_gemv_bf16(store->half_values, store->entry_count, store->dimensions, store->stride,
+                             query, scores);
+            break;
+        default:
+            vector_gemv(store->values, store->entry_count, store->dimensions, store->stride,
+                        query, scores);
+            break;
+    }
+    return 0;
+}
+
+// Same as embedding_store_score() over the int8 rows: a quarter of the
+// memory traffic, at an error of about 1e-2 per score
+int embedding_store_score_quantized(const EmbeddingStore* store, const float* query, float* scores) {
+    if (!store || !store->quantized || !query || !scores) {
+        return -1;
+    }
+    
+    int8_t* quantized_query = malloc(store->dimensions);
+    if (!quantized_query) {
+        return -1;
+    }
+    
+    float query_scale = vector_quantize_i8(query, store->dimensions, quantized_query);
+    vector_gemv_i8(store->quantized, store->scales, store->entry_count, store->dimensions,
+                   store->quantized_stride, quantized_query, query_scale, scores);
+    
+    free(quantized_query);
+    return 0;
+}
+
+// The limit entries whose signatures are nearest the query's in Hamming
+// distance, in id order (ties at the cut-off go to the lowest ids); returns
+// how many were written to ids, or -1. The distances are small integers, so
+// a histogram finds the cut-off without sorting. At one bit per dimension,
+// this narrows a large store down to a shortlist worth scoring exactly.
+int embedding_store_signature_shortlist(const EmbeddingStore* store, const float* query,
+                                        int limit, int* ids) {
+    if (!store || !store->signatures || !query || !ids || limit <= 0) {
+        return -1;
+    }
+    
+    int rows = store->entry_count;
+    int words = store->signature_words;
+    uint64_t* query_signature = malloc(sizeof(uint64_t) * words);
+    uint16_t* distances = malloc(sizeof(uint16_t) * (rows > 0 ? rows : 1));
+    int* histogram = calloc(store->dimensions + 1, sizeof(int));
+    if (!query_signature || !distances || !histogram) {
+        free(query_signature);
+        free(distances);
+        free(histogram);
+        return -1;
+    }
+    
+    vector_sign_bits(query, store->dimensions, query_signature);
+    vector_hamming_scan(store->signatures, rows, words, query_signature, distances);
+    for (int r = 0; r < rows; r++) {
+        histogram[distances[r]]++;
+    }
+    
+    // Everything nearer than the cut-off fits; the rest is filled from it
+    int cutoff = 0;
+    int nearer = 0;
+    while (cutoff <= store->dimensions && nearer + histogram[cutoff] <= limit) {
+        nearer += histogram[cutoff++];
+    }
+    
+    int ties = limit - nearer;
+    int count = 0;
+    for (int r = 0; r < rows; r++) {
+        if (distances[r] < cutoff || (distances[r] == cutoff && ties-- > 0)) {
+            ids[count++] = r;
+        }
+    }
+    
+    free(query_signature);
+    free(distances);
+    free(histogram);
+    return count;
+}
+
+const char* embedding_precision_name(EmbeddingPrecision precision) {
+    switch (precision) {
+        case EmbeddingPrecisionF16: return "f16";
+        case EmbeddingPrecisionBF16: return "bf16";
+        default: return "f32";
+    }
+}
+
+// Parse "f32", "f16" or "bf16"; -1 for anything else
+int embedding_precision_from_name(const char* name, EmbeddingPrecision* precision) {
+    if (!name || !precision) {
+        return -1;
+    }
+    
+    for (int i = EmbeddingPrecisionF32; i <= EmbeddingPrecisionBF16; i++) {
+        if (strcmp(name, embedding_precision_name((EmbeddingPrecision)i)) == 0) {
+            *precision = (EmbeddingPrecision)i;
+            return 0;
+        }
+    }
+    return -1;
+}
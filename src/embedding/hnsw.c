@@ -0,0 +1,644 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../../include/hnsw.h"
+
+#define HNSW_MAGIC "NKHN"
+#define HNSW_VERSION 1
+
+// Highest layer a node can be drawn into
+#define HNSW_MAX_LEVEL 16
+
+// Fixed seed so the same store always produces the same graph
+#define HNSW_SEED 0x6E6F76616B6579ULL
+
+// Image header, followed by level0[], upper_offsets[] and upper[]
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t dictionary_hash;  // Store the graph was built from
+    uint64_t model_hash;
+    uint32_t node_count;
+    uint32_t dimensions;
+    uint32_t m;
+    uint32_t max_level;
+    uint32_t entry_point;
+    uint32_t upper_slot_count;
+} HnswImageHeader;
+
+// Working memory for one search: visit marks and the candidate max-heap
+typedef struct {
+    uint32_t* marks;       // Equal to generation once visited in the current pass
+    uint32_t generation;
+    TopKItem* queue;       // Nodes still to expand, best at the root
+    int queue_count;
+    int queue_capacity;
+    float* rows;           // While building: three rows widened from a half-precision store
+} HnswScratch;
+
+// Search memory kept with the index, since visit marks for every node are
+// too much to allocate per keystroke. One query at a time holds it; a query
+// that finds it taken allocates its own.
+struct HnswSearchCache {
+    pthread_mutex_t lock;
+    int ready;               // scratch is allocated
+    HnswScratch scratch;
+    TopKSelector* greedy;
+    TopKSelector* beam;      // Recreated when a query asks for another width
+};
+
+static uint64_t hash_model_name(const char* name) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (const unsigned char* p = (const unsigned char*)name; *p; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static int scratch_init(HnswScratch* scratch, int node_count) {
+    scratch->marks = calloc(node_count > 0 ? node_count : 1, sizeof(uint32_t));
+    scratch->generation = 0;
+    scratch->queue_count = 0;
+    scratch->queue_capacity = 64;
+    scratch->queue = malloc(sizeof(TopKItem) * scratch->queue_capacity);
+    scratch->rows = NULL;
+    return scratch->marks && scratch->queue ? 0 : -1;
+}
+
+static void scratch_free(HnswScratch* scratch) {
+    free(scratch->marks);
+    free(scratch->queue);
+    free(scratch->rows);
+}
+
+static int queue_push(HnswScratch* scratch, int id, float score) {
+    if (scratch->queue_count == scratch->queue_capacity) {
+        int capacity = scratch->queue_capacity * 2;
+        TopKItem* queue = realloc(scratch->queue, sizeof(TopKItem) * capacity);
+        if (!queue) return -1;
+        scratch->queue = queue;
+        scratch->queue_capacity = capacity;
+    }
+    
+    TopKItem* queue = scratch->queue;
+    int index = scratch->queue_count++;
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (queue[parent].score >= score) break;
+        queue[index] = queue[parent];
+        index = parent;
+    }
+    queue[index] = (TopKItem){ id, score };
+    return 0;
+}
+
+static TopKItem queue_pop(HnswScratch* scratch) {
+    TopKItem* queue = scratch->queue;
+    TopKItem best = queue[0];
+    TopKItem last = queue[--scratch->queue_count];
+    int count = scratch->queue_count;
+    int index = 0;
+    
+    for (;;) {
+        int child = 2 * index + 1;
+        if (child >= count) break;
+        if (child + 1 < count && queue[child + 1].score > queue[child].score) child++;
+        if (queue[child].score <= last.score) break;
+        queue[index] = queue[child];
+        index = child;
+    }
+    if (count > 0) {
+        queue[index] = last;
+    }
+    return best;
+}
+
+static const uint32_t* node_links(const HnswIndex* index, int node, int level) {
+    if (level == 0) {
+        return index->level0 + (size_t)node * (2 * index->m + 1);
+    }
+    return index->upper + ((size_t)index->upper_offsets[node] + level - 1) * (index->m + 1);
+}
+
+static int node_level(const HnswIndex* index, int node) {
+    return (int)(index->upper_offsets[node + 1] - index->upper_offsets[node]);
+}
+
+static int level_capacity(const HnswIndex* index, int level) {
+    return level == 0 ? 2 * index->m : index->m;
+}
+
+static float node_similarity(const HnswIndex* index, const float* query, int node) {
+    return embedding_store_dot(index->store, node, query);
+}
+
+// Best-first search of one layer; beam holds the entry points on input and
+// the best nodes found on output
+static int search_layer(const HnswIndex* index, HnswScratch* scratch, const float* query,
+                        TopKSelector* beam, int level) {
+    // Start a new generation instead of clearing every mark
+    if (++scratch->generation == 0) {
+        memset(scratch->marks, 0, sizeof(uint32_t) * index->node_count);
+        scratch->generation = 1;
+    }
+    
+    scratch->queue_count = 0;
+    for (int i = 0; i < beam->count; i++) {
+        scratch->marks[beam->items[i].id] = scratch->generation;
+        if (queue_push(scratch, beam->items[i].id, beam->items[i].score) != 0) {
+            return -1;
+        }
+    }
+    
+    while (scratch->queue_count > 0) {
+        TopKItem current = queue_pop(scratch);
+        
+        // Everything left to expand is worse than the whole beam
+        if (current.score < topk_threshold(beam)) {
+            break;
+        }
+        
+        const uint32_t* links = node_links(index, current.id, level);
+        for (uint32_t i = 1; i <= links[0]; i++) {
+            int neighbour = (int)links[i];
+            if (scratch->marks[neighbour] == scratch->generation) {
+                continue;
+            }
+            scratch->marks[neighbour] = scratch->generation;
+            
+            float score = node_similarity(index, query, neighbour);
+            if (topk_push(beam, neighbour, score) && queue_push(scratch, neighbour, score) != 0) {
+                return -1;
+            }
+        }
+    }
+    
+    return 0;
+}
+
+// Greedy descent through the upper layers, leaving the closest node in greedy
+static int descend(const HnswIndex* index, HnswScratch* scratch, const float* query,
+                   TopKSelector* greedy, int bottom_level) {
+    topk_reset(greedy);
+    topk_push(greedy, index->entry_point, node_similarity(index, query, index->entry_point));
+    
+    for (int level = index->max_level; level > bottom_level; level--) {
+        if (search_layer(index, scratch, query, greedy, level) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int compare_best_first(const void* a, const void* b) {
+    const TopKItem* ia = a;
+    const TopKItem* ib = b;
+    if (ia->score != ib->score) {
+        return ia->score < ib->score ? 1 : -1;
+    }
+    return (ia->id > ib->id) - (ia->id < ib->id);
+}
+
+// Keep candidates (best first) that are closer to the base node than to any
+// neighbour already kept, so links spread out instead of clustering. buffer
+// holds a widened row of a half-precision store.
+static int select_neighbours(const HnswIndex* index, const TopKItem* candidates, int count,
+                             int limit, uint32_t* selected, float* buffer) {
+    int kept = 0;
+    
+    for (int i = 0; i < count && kept < limit; i++) {
+        const float* row = embedding_store_read_row(index->store, candidates[i].id, buffer);
+        int diverse = 1;
+        for (int j = 0; j < kept && diverse; j++) {
+            if (node_similarity(index, row, (int)selected[j]) > candidates[i].score) {
+                diverse = 0;
+            }
+        }
+        if (diverse) {
+            selected[kept++] = (uint32_t)candidates[i].id;
+        }
+    }
+    
+    return kept;
+}
+
+// Add node to the links of neighbour, re-selecting them if the slot is full;
+// buffer has room for two rows
+static void link_back(HnswIndex* index, TopKItem* items, int neighbour, int node, int level,
+                      float* buffer) {
+    uint32_t* links = (uint32_t*)node_links(index, neighbour, level);
+    int capacity = level_capacity(index, level);
+    
+    if ((int)links[0] < capacity) {
+        links[++links[0]] = (uint32_t)node;
+        return;
+    }
+    
+    const float* row = embedding_store_read_row(index->store, neighbour, buffer);
+    int count = 0;
+    for (uint32_t i = 1; i <= links[0]; i++) {
+        items[count++] = (TopKItem){ (int)links[i], node_similarity(index, row, (int)links[i]) };
+    }
+    items[count++] = (TopKItem){ node, node_similarity(index, row, node) };
+    
+    qsort(items, count, sizeof(TopKItem), compare_best_first);
+    links[0] = (uint32_t)select_neighbours(index, items, count, capacity, links + 1,
+                                           buffer + index->store->dimensions);
+}
+
+static int insert_node(HnswIndex* index, HnswScratch* scratch, TopKSelector* greedy,
+                       TopKSelector* beam, TopKItem* items, int node) {
+    int dimensions = index->store->dimensions;
+    const float* query = embedding_store_read_row(index->store, node, scratch->rows);
+    int level = node_level(index, node);
+    
+    if (descend(index, scratch, query, greedy, level) != 0) {
+        return -1;
+    }
+    
+    topk_reset(beam);
+    topk_push(beam, greedy->items[0].id, greedy->items[0].score);
+    
+    for (int l = level < index->max_level ? level : index->max_level; l >= 0; l--) {
+        if (search_layer(index, scratch, query, beam, l) != 0) {
+            return -1;
+        }
+        
+        // The beam stays a heap: it seeds the next layer down
+        int count = beam->count;
+        memcpy(items, beam->items, sizeof(TopKItem) * count);
+        qsort(items, count, sizeof(TopKItem), compare_best_first);
+        
+        uint32_t* links = (uint32_t*)node_links(index, node, l);
+        links[0] = (uint32_t)select_neighbours(index, items, count, index->m, links + 1,
+                                               scratch->rows + dimensions);
+        for (uint32_t i = 1; i <= links[0]; i++) {
+            link_back(index, items, (int)links[i], node, l, scratch->rows + dimensions);
+        }
+    }
+    
+    if (level > index->max_level) {
+        index->max_level = level;
+        index->entry_point = node;
+    }
+    return 0;
+}
+
+// Point index at the arrays of image after checking it against store
+static int hnsw_open(HnswIndex* index, void* image, size_t image_size, const EmbeddingStore* store) {
+    if (image_size < sizeof(HnswImageHeader)) {
+        return -1;
+    }
+    
+    HnswImageHeader header;
+    memcpy(&header, image, sizeof(header));
+    if (memcmp(header.magic, HNSW_MAGIC, 4) != 0 || header.version != HNSW_VERSION ||
+        header.m < 2 || header.max_level > HNSW_MAX_LEVEL) {
+        return -1;
+    }
+    
+    // An index built from another model or dictionary revision is stale
+    if (header.dictionary_hash != store->dictionary_hash ||
+        header.model_hash != hash_model_name(store->model_name) ||
+        header.node_count != (uint32_t)store->entry_count ||
+        header.dimensions != (uint32_t)store->dimensions) {
+        return -1;
+    }
+    
+    size_t node_count = header.node_count;
+    size_t expected = sizeof(HnswImageHeader) +
+                      sizeof(uint32_t) * (node_count * (2 * header.m + 1) +
+                                          node_count + 1 +
+                                          (size_t)header.upper_slot_count * (header.m + 1));
+    if (expected != image_size || (node_count > 0 && header.entry_point >= node_count)) {
+        return -1;
+    }
+    
+    const uint32_t* cursor = (const uint32_t*)((const char*)image + sizeof(HnswImageHeader));
+    index->node_count = (int)header.node_count;
+    index->m = (int)header.m;
+    index->max_level = (int)header.max_level;
+    index->entry_point = (int)header.entry_point;
+    index->level0 = cursor;
+    cursor += node_count * (2 * header.m + 1);
+    index->upper_offsets = cursor;
+    cursor += node_count + 1;
+    index->upper = cursor;
+    index->store = store;
+    index->search_cache = NULL;
+    index->image = image;
+    index->image_size = image_size;
+    index->image_mapped = 0;
+    
+    if (index->upper_offsets[0] != 0 || index->upper_offsets[node_count] != header.upper_slot_count ||
+        (node_count == 0 && header.max_level != 0)) {
+        return -1;
+    }
+    for (int node = 0; node < index->node_count; node++) {
+        int level = (int)index->upper_offsets[node + 1] - (int)index->upper_offsets[node];
+        if (level < 0 || level > HNSW_MAX_LEVEL) {
+            return -1;
+        }
+        
+        // Searches start at max_level from the entry point, whose links on
+        // that layer must exist
+        if (node == index->entry_point && level < index->max_level) {
+            return -1;
+        }
+        for (int l = 0; l <= level; l++) {
+            const uint32_t* links = node_links(index, node, l);
+            if (links[0] > (uint32_t)level_capacity(index, l)) {
+                return -1;
+            }
+            for (uint32_t i = 1; i <= links[0]; i++) {
+                if (links[i] >= header.node_count) {
+                    return -1;
+                }
+            }
+        }
+    }
+    
+    index->search_cache = calloc(1, sizeof(HnswSearchCache));
+    if (!index->search_cache) {
+        return -1;
+    }
+    if (pthread_mutex_init(&index->search_cache->lock, NULL) != 0) {
+        free(index->search_cache);
+        index->search_cache = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+static int draw_level(uint64_t* state, double level_scale) {
+    // splitmix64
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    
+    // Uniform in (0, 1], so the level is geometric with ratio 1/m
+    double uniform = (double)((z >> 11) + 1) / 9007199254740992.0;
+    int level = (int)(-log(uniform) * level_scale);
+    return level < HNSW_MAX_LEVEL ? level : HNSW_MAX_LEVEL;
+}
+
+HnswIndex* hnsw_build(const EmbeddingStore* store, int m, int ef_construction) {
+    if (!store || m < 2 || ef_construction < 1) {
+        return NULL;
+    }
+    
+    int node_count = store->entry_count;
+    int max_level = 0;
+    
+    // Levels are drawn up front so every node's upper layers can be laid out flat
+    uint32_t* offsets = malloc(sizeof(uint32_t) * (node_count + 1));
+    if (!offsets) {
+        return NULL;
+    }
+    uint64_t state = HNSW_SEED;
+    double level_scale = 1.0 / log((double)m);
+    offsets[0] = 0;
+    for (int i = 0; i < node_count; i++) {
+        int level = draw_level(&state, level_scale);
+        offsets[i + 1] = offsets[i] + (uint32_t)level;
+        if (i == 0) max_level = level;
+    }
+    
+    HnswImageHeader header = {0};
+    memcpy(header.magic, HNSW_MAGIC, 4);
+    header.version = HNSW_VERSION;
+    header.dictionary_hash = store->dictionary_hash;
+    header.model_hash = hash_model_name(store->model_name);
+    header.node_count = (uint32_t)node_count;
+    header.dimensions = (uint32_t)store->dimensions;
+    header.m = (uint32_t)m;
+    header.max_level = (uint32_t)max_level;
+    header.entry_point = 0;
+    header.upper_slot_count = offsets[node_count];
+    
+    size_t level0_size = sizeof(uint32_t) * (size_t)node_count * (2 * m + 1);
+    size_t image_size = sizeof(HnswImageHeader) + level0_size +
+                        sizeof(uint32_t) * (node_count + 1) +
+                        sizeof(uint32_t) * (size_t)header.upper_slot_count * (m + 1);
+    char* image = calloc(1, image_size);
+    HnswIndex* index = malloc(sizeof(HnswIndex));
+    if (!image || !index) {
+        free(offsets);
+        free(image);
+        free(index);
+        return NULL;
+    }
+    
+    memcpy(image, &header, sizeof(header));
+    memcpy(image + sizeof(header) + level0_size, offsets, sizeof(uint32_t) * (node_count + 1));
+    free(offsets);
+    if (hnsw_open(index, image, image_size, store) != 0) {
+        free(image);
+        free(index);
+        return NULL;
+    }
+    
+    // Insert nodes one at a time; node 0 starts out as the entry point
+    HnswScratch scratch;
+    TopKSelector* greedy = topk_create(1);
+    TopKSelector* beam = topk_create(ef_construction);
+    int item_count = (ef_construction > 2 * m ? ef_construction : 2 * m) + 1;
+    TopKItem* items = malloc(sizeof(TopKItem) * item_count);
+    int ok = scratch_init(&scratch, node_count) == 0 && greedy && beam && items;
+    if (ok) {
+        scratch.rows = malloc(sizeof(float) * 3 * store->dimensions);
+        ok = scratch.rows != NULL;
+    }
+    
+    for (int node = 1; ok && node < node_count; node++) {
+        ok = insert_node(index, &scratch, greedy, beam, items, node) == 0;
+    }
+    
+    scratch_free(&scratch);
+    topk_destroy(greedy);
+    topk_destroy(beam);
+    free(items);
+    
+    if (!ok) {
+        hnsw_destroy(index);
+        return NULL;
+    }
+    
+    header.max_level = (uint32_t)index->max_level;
+    header.entry_point = (uint32_t)index->entry_point;
+    memcpy(image, &header, sizeof(header));
+    return index;
+}
+
+void hnsw_destroy(HnswIndex* index) {
+    if (!index) return;
+    
+    HnswSearchCache* cache = index->search_cache;
+    if (cache) {
+        if (cache->ready) {
+            scratch_free(&cache->scratch);
+        }
+        topk_destroy(cache->greedy);
+        topk_destroy(cache->beam);
+        pthread_mutex_destroy(&cache->lock);
+        free(cache);
+    }
+    
+    if (index->image_mapped) {
+        munmap(index->image, index->image_size);
+    } else {
+        free(index->image);
+    }
+    free(index);
+}
+
+int hnsw_save(const HnswIndex* index, const char* path) {
+    if (!index || !path) {
+        return -1;
+    }
+    
+    // Write to a temporary file and rename, as the old index may be mapped
+    char temp_path[4096];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    
+    FILE* file = fopen(temp_path, "wb");
+    if (!file) {
+        printf("Warning: Could not write HNSW index to %s\n", path);
+        return -1;
+    }
+    
+    int ok = fwrite(index->image, 1, index->image_size, file) == index->image_size;
+    if (fclose(file) != 0) {
+        ok = 0;
+    }
+    
+    if (!ok || rename(temp_path, path) != 0) {
+        printf("Warning: Failed to write HNSW index to %s\n", path);
+        remove(temp_path);
+        return -1;
+    }
+    
+    printf("Saved HNSW index with %d nodes to %s\n", index->node_count, path);
+    return 0;
+}
+
+HnswIndex* hnsw_load(const char* path, const EmbeddingStore* store) {
+    if (!path || !store) {
+        return NULL;
+    }
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(HnswImageHeader)) {
+        close(fd);
+        return NULL;
+    }
+    
+    size_t image_size = (size_t)st.st_size;
+    void* image = mmap(NULL, image_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        printf("Warning: Could not map HNSW index %s\n", path);
+        return NULL;
+    }
+    
+    HnswIndex* index = malloc(sizeof(HnswIndex));
+    if (!index || hnsw_open(index, image, image_size, store) != 0) {
+        printf("HNSW index %s does not match the current embedding store\n", path);
+        free(index);
+        munmap(image, image_size);
+        return NULL;
+    }
+    index->image_mapped = 1;
+    
+    printf("Mapped HNSW index with %d nodes from %s\n", index->node_count, path);
+    return index;
+}
+
+// Search memory for one query: the index's cache if it is free, else a
+// fresh allocation; returns 1 if the cache was taken
+static int take_search_memory(const HnswIndex* index, int ef, HnswScratch** scratch,
+                              TopKSelector** greedy, TopKSelector** beam, HnswScratch* local) {
+    HnswSearchCache* cache = index->search_cache;
+    if (cache && pthread_mutex_trylock(&cache->lock) == 0) {
+        if (!cache->ready && scratch_init(&cache->scratch, index->node_count) == 0) {
+            cache->ready = 1;
+        }
+        if (!cache->greedy) {
+            cache->greedy = topk_create(1);
+        }
+        if (cache->beam && cache->beam->k != ef) {
+            topk_destroy(cache->beam);
+            cache->beam = NULL;
+        }
+        if (!cache->beam) {
+            cache->beam = topk_create(ef);
+        }
+        
+        if (cache->ready && cache->greedy && cache->beam) {
+            topk_reset(cache->beam);
+            *scratch = &cache->scratch;
+            *greedy = cache->greedy;
+            *beam = cache->beam;
+            return 1;
+        }
+        pthread_mutex_unlock(&cache->lock);
+    }
+    
+    *scratch = scratch_init(local, index->node_count) == 0 ? local : NULL;
+    *greedy = topk_create(1);
+    *beam = topk_create(ef);
+    return 0;
+}
+
+int hnsw_search(const HnswIndex* index, const float* query, int ef, TopKSelector* results) {
+    if (!index || !query || !results) {
+        return -1;
+    }
+    if (index->node_count == 0) {
+        return 0;
+    }
+    
+    // The beam must be at least as wide as the number of results wanted
+    if (ef < results->k) {
+        ef = results->k;
+    }
+    
+    HnswScratch local = {0};
+    HnswScratch* scratch;
+    TopKSelector* greedy;
+    TopKSelector* beam;
+    int cached = take_search_memory(index, ef, &scratch, &greedy, &beam, &local);
+    int found = -1;
+    
+    if (scratch && greedy && beam && descend(index, scratch, query, greedy, 0) == 0) {
+        topk_push(beam, greedy->items[0].id, greedy->items[0].score);
+        if (search_layer(index, scratch, query, beam, 0) == 0) {
+            for (int i = 0; i < beam->count; i++) {
+                topk_push(results, beam->items[i].id, beam->items[i].score);
+            }
+            found = beam->count;
+        }
+    }
+    
+    if (cached) {
+        pthread_mutex_unlock(&index->search_cache->lock);
+    } else {
+        scratch_free(&local);
+        topk_destroy(greedy);
+        topk_destroy(beam);
+    }
+    return found;
+}
@@ -2,21 +2,37 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <time.h>
 #include <curl/curl.h>
-#include <cjson/cJSON.h>
 #include "../../include/embedding.h"
+#include "../../include/embedding_lru.h"
+#include "../../include/embedding_flight.h"
+#include "../../include/json_scan.h"
+#include "../../include/vector_ops.h"
+
+#define OLLAMA_RESPONSE_INITIAL_CAPACITY 16384
+#define OLLAMA_REQUEST_INITIAL_CAPACITY 256
 
 // HTTP response callback
 size_t write_callback(void* contents, size_t size, size_t nmemb, HttpResponse* response) {
     size_t real_size = size * nmemb;
-    char* ptr = realloc(response->data, response->size + real_size + 1);
     
-    if (!ptr) {
-        printf("Not enough memory (realloc returned NULL)\n");
-        return 0;
+    // Grow geometrically, so a reused buffer settles at the largest response
+    if (response->size + real_size + 1 > response->capacity) {
+        size_t capacity = response->capacity ? response->capacity : OLLAMA_RESPONSE_INITIAL_CAPACITY;
+        while (capacity < response->size + real_size + 1) {
+            capacity *= 2;
+        }
+        
+        char* ptr = realloc(response->data, capacity);
+        if (!ptr) {
+            printf("Not enough memory (realloc returned NULL)\n");
+            return 0;
+        }
+        response->data = ptr;
+        response->capacity = capacity;
     }
     
-    response->data = ptr;
     memcpy(&(response->data[response->size]), contents, real_size);
     response->size += real_size;
     response->data[response->size] = '\0';
@@ -24,6 +40,36 @@ size_t write_callback(void* contents, size_t size, size_t nmemb, HttpResponse* r
     return real_size;
 }
 
+// JSON content type, and no "Expect: 100-continue" round trip before
+// larger request bodies
+struct curl_slist* create_json_headers(void) {
+    struct curl_slist* headers = curl_slist_append(NULL, "Content-Type: application/json");
+    struct curl_slist* complete = headers ? curl_slist_append(headers, "Expect:") : NULL;
+    if (!complete) {
+        curl_slist_free_all(headers);
+    }
+    return complete;
+}
+
+void set_post_options(CURL* curl, struct curl_slist* headers, HttpResponse* response) {
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)OLLAMA_DEFAULT_TIMEOUT_MS);
+}
+
+uint64_t embedding_clock_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// Deadline timeout_ms from now
+uint64_t embedding_deadline_in(int timeout_ms) {
+    return embedding_clock_ms() + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0);
+}
+
+// One-off request on a fresh connection; clients use ollama_client_post()
 HttpResponse* http_post_json(const char* url, const char* json_data) {
     CURL* curl;
     CURLcode res;
@@ -35,23 +81,22 @@ HttpResponse* http_post_json(const char* url, const char* json_data) {
     
     response->data = malloc(1);
     response->size = 0;
+    response->capacity = 1;
     
     curl = curl_easy_init();
-    if (!curl) {
+    struct curl_slist* headers = create_json_headers();
+    if (!curl || !headers || !response->data) {
+        curl_slist_free_all(headers);
+        if (curl) curl_easy_cleanup(curl);
         free(response->data);
         free(response);
         return NULL;
     }
-    
-    struct curl_slist* headers = NULL;
-    headers = curl_slist_append(headers, "Content-Type: application/json");
+    response->data[0] = '\0';
     
     curl_easy_setopt(curl, CURLOPT_URL, url);
     curl_easy_setopt(curl, CURLOPT_POSTFIELDS, json_data);
-    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+    set_post_options(curl, headers, response);
     
     res = curl_easy_perform(curl);
     
@@ -75,8 +120,22 @@ void free_http_response(HttpResponse* response) {
     }
 }
 
+// base_url followed by path; the caller frees it
+char* build_url(const char* base_url, const char* path) {
+    if (!base_url) {
+        return NULL;
+    }
+    
+    size_t length = strlen(base_url) + strlen(path) + 1;
+    char* url = malloc(length);
+    if (url) {
+        snprintf(url, length, "%s%s", base_url, path);
+    }
+    return url;
+}
+
 OllamaClient* ollama_client_create(const char* base_url, const char* model_name) {
-    OllamaClient* client = malloc(sizeof(OllamaClient));
+    OllamaClient* client = calloc(1, sizeof(OllamaClient));
     if (!client) {
         return NULL;
     }
@@ -84,14 +143,31 @@ OllamaClient* ollama_client_create(const char* base_url, const char* model_name)
     // Initialize libcurl globally
     curl_global_init(CURL_GLOBAL_DEFAULT);
     
+    client->base_url = strdup(base_url ? base_url : "http://localhost:11434");
+    client->model_name = strdup(model_name ? model_name : "nomic-embed-text");
+    
+    // The handle, headers, URL and response buffer live as long as the client,
+    // so each request only sets its body and reuses the open connection
     client->curl = curl_easy_init();
-    if (!client->curl) {
-        free(client);
+    client->headers = create_json_headers();
+    client->response.data = malloc(OLLAMA_RESPONSE_INITIAL_CAPACITY);
+    client->response.capacity = OLLAMA_RESPONSE_INITIAL_CAPACITY;
+    client->embeddings_url = build_url(client->base_url, "/api/embeddings");
+    client->embed_url = build_url(client->base_url, "/api/embed");
+    client->batch_size = OLLAMA_DEFAULT_BATCH_SIZE;
+    client->timeout_ms = OLLAMA_DEFAULT_TIMEOUT_MS;
+    circuit_breaker_init(&client->breaker, CIRCUIT_BREAKER_DEFAULT_FAILURES,
+                         CIRCUIT_BREAKER_DEFAULT_SLOW_MS, CIRCUIT_BREAKER_DEFAULT_COOLDOWN_MS);
+    
+    if (!client->curl || !client->headers || !client->response.data ||
+        !client->embeddings_url || !client->embed_url || !client->model_name) {
+        ollama_client_destroy(client);
         return NULL;
     }
     
-    client->base_url = strdup(base_url ? base_url : "http://localhost:11434");
-    client->model_name = strdup(model_name ? model_name : "nomic-embed-text");
+    set_post_options(client->curl, client->headers, &client->response);
+    curl_easy_setopt(client->curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(client->curl, CURLOPT_NOSIGNAL, 1L);
     
     printf("Ollama client created (URL: %s, Model: %s)\n", 
            client->base_url, client->model_name);
@@ -105,7 +181,12 @@ void ollama_client_destroy(OllamaClient* client) {
     if (client->curl) {
         curl_easy_cleanup(client->curl);
     }
+    curl_slist_free_all(client->headers);
     
+    free(client->response.data);
+    free_request_buffer(&client->request);
+    free(client->embeddings_url);
+    free(client->embed_url);
     free(client->base_url);
     free(client->model_name);
     free(client);
@@ -114,70 +195,186 @@ void ollama_client_destroy(OllamaClient* client) {
     printf("Ollama client destroyed\n");
 }
 
-EmbeddingVector* generate_embedding(OllamaClient* client, const char* text) {
-    if (!client || !text) {
+// POST on the client's connection, abandoned at deadline_ms. The response
+// belongs to the client and is overwritten by its next request.
+const HttpResponse* ollama_client_post(OllamaClient* client, const char* url, const char* json_data,
+                                       uint64_t deadline_ms) {
+    if (!client || !url || !json_data) {
         return NULL;
     }
     
-    // Create JSON request
-    cJSON* json = cJSON_CreateObject();
-    cJSON* model = cJSON_CreateString(client->model_name);
-    cJSON* prompt = cJSON_CreateString(text);
+    long timeout_ms = client->timeout_ms > 0 ? client->timeout_ms : OLLAMA_DEFAULT_TIMEOUT_MS;
+    if (deadline_ms != EMBEDDING_NO_DEADLINE) {
+        uint64_t now = embedding_clock_ms();
+        if (now >= deadline_ms) {
+            return NULL;
+        }
+        timeout_ms = (long)(deadline_ms - now);
+    }
+    curl_easy_setopt(client->curl, CURLOPT_TIMEOUT_MS, timeout_ms);
+    
+    client->response.size = 0;
+    client->response.data[0] = '\0';
     
-    cJSON_AddItemToObject(json, "model", model);
-    cJSON_AddItemToObject(json, "prompt", prompt);
+    curl_easy_setopt(client->curl, CURLOPT_URL, url);
+    curl_easy_setopt(client->curl, CURLOPT_POSTFIELDS, json_data);
+    curl_easy_setopt(client->curl, CURLOPT_POSTFIELDSIZE, (long)strlen(json_data));
     
-    char* json_string = cJSON_Print(json);
-    if (!json_string) {
-        cJSON_Delete(json);
+    CURLcode res = curl_easy_perform(client->curl);
+    if (res != CURLE_OK) {
+        fprintf(stderr, "curl_easy_perform() failed: %s\n", curl_easy_strerror(res));
         return NULL;
     }
     
-    // Build URL
-    char url[512];
-    snprintf(url, sizeof(url), "%s/api/embeddings", client->base_url);
+    return &client->response;
+}
+
+static int reserve_request(RequestBuffer* buffer, size_t extra) {
+    if (buffer->size + extra + 1 <= buffer->capacity) {
+        return 0;
+    }
     
-    // Make HTTP request
-    HttpResponse* response = http_post_json(url, json_string);
+    size_t capacity = buffer->capacity ? buffer->capacity : OLLAMA_REQUEST_INITIAL_CAPACITY;
+    while (capacity < buffer->size + extra + 1) {
+        capacity *= 2;
+    }
     
-    free(json_string);
-    cJSON_Delete(json);
+    char* data = realloc(buffer->data, capacity);
+    if (!data) {
+        return -1;
+    }
+    buffer->data = data;
+    buffer->capacity = capacity;
+    return 0;
+}
+
+static int append_request(RequestBuffer* buffer, const char* text, size_t length) {
+    if (reserve_request(buffer, length) != 0) {
+        return -1;
+    }
     
-    if (!response) {
-        printf("Failed to get response from Ollama API\n");
-        return NULL;
+    memcpy(buffer->data + buffer->size, text, length);
+    buffer->size += length;
+    buffer->data[buffer->size] = '\0';
+    return 0;
+}
+
+#define APPEND_LITERAL(buffer, literal) append_request(buffer, literal, sizeof(literal) - 1)
+
+// text as a quoted JSON string: quotes, backslashes and control characters
+// are escaped, everything else (UTF-8 included) is copied as is
+static int append_json_string(RequestBuffer* buffer, const char* text) {
+    static const char hex[] = "0123456789abcdef";
+    
+    // At worst every byte becomes a six byte \u00XX escape
+    if (reserve_request(buffer, strlen(text) * 6 + 2) != 0) {
+        return -1;
     }
     
-    // Parse response JSON
-    cJSON* response_json = cJSON_Parse(response->data);
-    if (!response_json) {
-        printf("Failed to parse response JSON\n");
-        free_http_response(response);
+    char* out = buffer->data + buffer->size;
+    *out++ = '"';
+    for (const unsigned char* p = (const unsigned char*)text; *p; p++) {
+        unsigned char c = *p;
+        if (c == '"' || c == '\\') {
+            *out++ = '\\';
+            *out++ = (char)c;
+        } else if (c >= 0x20) {
+            *out++ = (char)c;
+        } else if (c == '\n') {
+            *out++ = '\\';
+            *out++ = 'n';
+        } else if (c == '\r') {
+            *out++ = '\\';
+            *out++ = 'r';
+        } else if (c == '\t') {
+            *out++ = '\\';
+            *out++ = 't';
+        } else {
+            memcpy(out, "\\u00", 4);
+            out[4] = hex[c >> 4];
+            out[5] = hex[c & 15];
+            out += 6;
+        }
+    }
+    *out++ = '"';
+    *out = '\0';
+    buffer->size = (size_t)(out - buffer->data);
+    return 0;
+}
+
+// Compact /api/embeddings body {"model":...,"prompt":...}, replacing what
+// the buffer held
+int write_embedding_request(RequestBuffer* buffer, const char* model_name, const char* text) {
+    if (!buffer || !model_name || !text) {
+        return -1;
+    }
+    
+    buffer->size = 0;
+    if (APPEND_LITERAL(buffer, "{\"model\":") != 0 ||
+        append_json_string(buffer, model_name) != 0 ||
+        APPEND_LITERAL(buffer, ",\"prompt\":") != 0 ||
+        append_json_string(buffer, text) != 0 ||
+        APPEND_LITERAL(buffer, "}") != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// Compact /api/embed body {"model":...,"input":[...]}; NULL texts are sent
+// as empty strings
+int write_batch_request(RequestBuffer* buffer, const char* model_name,
+                        const char* const* texts, int count) {
+    if (!buffer || !model_name || !texts || count < 0) {
+        return -1;
+    }
+    
+    buffer->size = 0;
+    if (APPEND_LITERAL(buffer, "{\"model\":") != 0 ||
+        append_json_string(buffer, model_name) != 0 ||
+        APPEND_LITERAL(buffer, ",\"input\":[") != 0) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        if ((i > 0 && APPEND_LITERAL(buffer, ",") != 0) ||
+            append_json_string(buffer, texts[i] ? texts[i] : "") != 0) {
+            return -1;
+        }
+    }
+    return APPEND_LITERAL(buffer, "]}");
+}
+
+void free_request_buffer(RequestBuffer* buffer) {
+    if (!buffer) return;
+    
+    free(buffer->data);
+    buffer->data = NULL;
+    buffer->size = 0;
+    buffer->capacity = 0;
+}
+
+// Embedding from the body of an /api/embeddings response, NULL if it has
+// none. The numbers are converted straight into the vector: nothing else is
+// allocated and the body is read once.
+EmbeddingVector* parse_embedding_response(const HttpResponse* response) {
+    if (!response || !response->data) {
         return NULL;
     }
     
-    // Extract embedding array
-    cJSON* embedding_json = cJSON_GetObjectItem(response_json, "embedding");
-    if (!cJSON_IsArray(embedding_json)) {
+    const char* end = response->data + response->size;
+    const char* embedding_json = json_find_member(response->data, end, "embedding");
+    int dimensions = json_count_floats(embedding_json, end);
+    if (dimensions < 0) {
         printf("No embedding array found in response\n");
-        cJSON_Delete(response_json);
-        free_http_response(response);
         return NULL;
     }
-    
-    int dimensions = cJSON_GetArraySize(embedding_json);
-    if (dimensions <= 0) {
+    if (dimensions == 0) {
         printf("Empty embedding array\n");
-        cJSON_Delete(response_json);
-        free_http_response(response);
         return NULL;
     }
     
     // Create embedding vector
     EmbeddingVector* vector = malloc(sizeof(EmbeddingVector));
     if (!vector) {
-        cJSON_Delete(response_json);
-        free_http_response(response);
         return NULL;
     }
     
@@ -185,30 +382,369 @@ EmbeddingVector* generate_embedding(OllamaClient* client, const char* text) {
     vector->values = malloc(sizeof(float) * dimensions);
     if (!vector->values) {
         free(vector);
-        cJSON_Delete(response_json);
-        free_http_response(response);
         return NULL;
     }
     
-    // Copy values
-    for (int i = 0; i < dimensions; i++) {
-        cJSON* value = cJSON_GetArrayItem(embedding_json, i);
-        if (cJSON_IsNumber(value)) {
-            vector->values[i] = (float)cJSON_GetNumberValue(value);
+    if (!json_read_floats(embedding_json, end, vector->values, dimensions)) {
+        printf("Malformed embedding array in response\n");
+        free_embedding_vector(vector);
+        return NULL;
+    }
+    
+    return vector;
+}
+
+static EmbeddingVector* copy_embedding(const float* values, int dimensions) {
+    EmbeddingVector* vector = malloc(sizeof(EmbeddingVector));
+    if (!vector) {
+        return NULL;
+    }
+    
+    vector->dimensions = dimensions;
+    vector->values = malloc(sizeof(float) * dimensions);
+    if (!vector->values) {
+        free(vector);
+        return NULL;
+    }
+    memcpy(vector->values, values, sizeof(float) * dimensions);
+    return vector;
+}
+
+// POST the client's request body through its circuit breaker. Only single
+// texts are judged on latency; a batch takes as long as its size needs. A
+// deadline that passed before sending is not held against Ollama, and one
+// that runs out mid-request only shows Ollama is slower than the caller's
+// budget: it counts as a slow call once that time is past the breaker's slow
+// threshold, and otherwise gives no verdict. Requests the breaker refuses
+// fail quietly, so an open circuit does not flood the log.
+static const HttpResponse* send_request(OllamaClient* client, const char* url,
+                                        uint64_t deadline_ms, int judge_latency) {
+    uint64_t start = embedding_clock_ms();
+    if (deadline_ms != EMBEDDING_NO_DEADLINE && start >= deadline_ms) {
+        return NULL;
+    }
+    if (!circuit_breaker_allow(&client->breaker, start)) {
+        return NULL;
+    }
+    
+    const HttpResponse* response = ollama_client_post(client, url, client->request.data, deadline_ms);
+    long status = 0;
+    if (response) {
+        curl_easy_getinfo(client->curl, CURLINFO_RESPONSE_CODE, &status);
+    } else {
+        printf("Failed to get response from Ollama API\n");
+    }
+    
+    uint64_t end = embedding_clock_ms();
+    int elapsed_ms = judge_latency ? (int)(end - start) : 0;
+    if (!response && deadline_ms != EMBEDDING_NO_DEADLINE && end >= deadline_ms &&
+        elapsed_ms <= client->breaker.slow_threshold_ms) {
+        circuit_breaker_release(&client->breaker);
+        return NULL;
+    }
+    circuit_breaker_record(&client->breaker, status >= 200 && status < 300, elapsed_ms, end);
+    return response;
+}
+
+// Embedding from the disk cache, else from Ollama
+static EmbeddingVector* fetch_embedding(OllamaClient* client, const char* text, uint64_t deadline_ms) {
+    // Text embedded before, by this process or an earlier one
+    int cached_dimensions;
+    const float* cached = embedding_cache_get(client->cache, client->model_name, text, &cached_dimensions);
+    if (cached) {
+        return copy_embedding(cached, cached_dimensions);
+    }
+    
+    if (write_embedding_request(&client->request, client->model_name, text) != 0) {
+        return NULL;
+    }
+    
+    // Make HTTP request
+    const HttpResponse* response = send_request(client, client->embeddings_url, deadline_ms, 1);
+    
+    if (!response) {
+        return NULL;
+    }
+    
+    EmbeddingVector* vector = parse_embedding_response(response);
+    if (!vector) {
+        return NULL;
+    }
+    
+    printf("Generated embedding with %d dimensions for text: '%.50s...'\n", 
+           vector->dimensions, text);
+    
+    if (client->cache) {
+        embedding_cache_put(client->cache, client->model_name, text, vector->values, vector->dimensions);
+    }
+    
+    return vector;
+}
+
+// Embed texts[0, count) with one /api/embed request into rows [first,
+// first + count) of matrix, allocating it once the dimensions are known
+static int embed_chunk(OllamaClient* client, const char* const* texts, int count,
+                       EmbeddingMatrix* matrix, int first, uint64_t deadline_ms) {
+    if (write_batch_request(&client->request, client->model_name, texts, count) != 0) {
+        return -1;
+    }
+    
+    const HttpResponse* response = send_request(client, client->embed_url, deadline_ms, 0);
+    if (!response) {
+        return -1;
+    }
+    
+    const char* end = response->data + response->size;
+    const char* embeddings_json = json_find_member(response->data, end, "embeddings");
+    const char* embedding_json = json_array_first(embeddings_json, end);
+    int row = first;
+    for (; embedding_json && row < first + count; row++) {
+        int dimensions = json_count_floats(embedding_json, end);
+        if (!matrix->values && dimensions > 0) {
+            matrix->dimensions = dimensions;
+            matrix->values = malloc(sizeof(float) * (size_t)matrix->count * dimensions);
+            if (!matrix->values) {
+                return -1;
+            }
+        }
+        
+        if (dimensions != matrix->dimensions || dimensions <= 0) {
+            printf("Embedding %d has %d dimensions, expected %d\n", row, dimensions, matrix->dimensions);
+            return -1;
+        }
+        
+        // Rows are parsed straight into the matrix
+        const char* row_end = json_read_floats(embedding_json, end,
+                                               matrix->values + (size_t)row * matrix->dimensions,
+                                               matrix->dimensions);
+        if (!row_end) {
+            printf("Malformed embedding %d in response\n", row);
+            return -1;
+        }
+        embedding_json = json_array_next(row_end, end);
+    }
+    
+    if (row != first + count || embedding_json) {
+        printf("No embeddings array with %d rows found in response\n", count);
+        return -1;
+    }
+    return 0;
+}
+
+static EmbeddingMatrix* request_embeddings_batch(OllamaClient* client, const char* const* texts, int count,
+                                                uint64_t deadline_ms) {
+    EmbeddingMatrix* matrix = calloc(1, sizeof(EmbeddingMatrix));
+    if (!matrix) {
+        return NULL;
+    }
+    matrix->count = count;
+    
+    int batch_size = client->batch_size > 0 ? client->batch_size : OLLAMA_DEFAULT_BATCH_SIZE;
+    int requests = 0;
+    for (int first = 0; first < count; first += batch_size) {
+        int chunk = count - first < batch_size ? count - first : batch_size;
+        if (embed_chunk(client, texts + first, chunk, matrix, first, deadline_ms) != 0) {
+            free_embedding_matrix(matrix);
+            return NULL;
+        }
+        requests++;
+    }
+    
+    printf("Generated %d embeddings with %d dimensions in %d requests\n",
+           count, matrix->dimensions, requests);
+    return matrix;
+}
+
+EmbeddingMatrix* generate_embeddings_batch(OllamaClient* client, const char* const* texts, int count) {
+    return generate_embeddings_batch_until(client, texts, count, EMBEDDING_NO_DEADLINE);
+}
+
+// Embeddings of count texts, client->batch_size texts per request; NULL if
+// any request fails or the deadline, shared by all of them, passes. Only
+// texts missing from the cache are requested.
+EmbeddingMatrix* generate_embeddings_batch_until(OllamaClient* client, const char* const* texts, int count,
+                                                 uint64_t deadline_ms) {
+    if (!client || !texts || count <= 0) {
+        return NULL;
+    }
+    
+    if (!client->cache) {
+        return request_embeddings_batch(client, texts, count, deadline_ms);
+    }
+    
+    const char** missing_texts = malloc(sizeof(const char*) * count);
+    int* missing_rows = malloc(sizeof(int) * count);
+    if (!missing_texts || !missing_rows) {
+        free(missing_texts);
+        free(missing_rows);
+        return NULL;
+    }
+    
+    // Hits must agree on the dimensions; anything else is requested again
+    int missing = 0;
+    int dimensions = 0;
+    for (int i = 0; i < count; i++) {
+        int cached_dimensions = 0;
+        const char* text = texts[i] ? texts[i] : "";
+        if (embedding_cache_get(client->cache, client->model_name, text, &cached_dimensions) &&
+            (dimensions == 0 || cached_dimensions == dimensions)) {
+            dimensions = cached_dimensions;
         } else {
-            vector->values[i] = 0.0f;
+            missing_texts[missing] = text;
+            missing_rows[missing++] = i;
         }
     }
     
-    cJSON_Delete(response_json);
-    free_http_response(response);
+    EmbeddingMatrix* fetched = NULL;
+    if (missing > 0) {
+        fetched = request_embeddings_batch(client, missing_texts, missing, deadline_ms);
+        if (!fetched || (dimensions != 0 && fetched->dimensions != dimensions)) {
+            free_embedding_matrix(fetched);
+            free(missing_texts);
+            free(missing_rows);
+            return NULL;
+        }
+        dimensions = fetched->dimensions;
+    }
     
-    printf("Generated embedding with %d dimensions for text: '%.50s...'\n", 
-           dimensions, text);
+    EmbeddingMatrix* matrix = calloc(1, sizeof(EmbeddingMatrix));
+    if (matrix) {
+        matrix->count = count;
+        matrix->dimensions = dimensions;
+        matrix->values = malloc(sizeof(float) * (size_t)count * dimensions);
+    }
+    if (!matrix || !matrix->values) {
+        free_embedding_matrix(matrix);
+        free_embedding_matrix(fetched);
+        free(missing_texts);
+        free(missing_rows);
+        return NULL;
+    }
     
+    // Copy the hits before any put, which may compact the cache under them
+    for (int i = 0, j = 0; i < count; i++) {
+        if (j < missing && missing_rows[j] == i) {
+            j++;
+            continue;
+        }
+        const float* cached = embedding_cache_get(client->cache, client->model_name,
+                                                  texts[i] ? texts[i] : "", NULL);
+        memcpy(matrix->values + (size_t)i * dimensions, cached, sizeof(float) * dimensions);
+    }
+    for (int j = 0; j < missing; j++) {
+        const float* row = fetched->values + (size_t)j * dimensions;
+        memcpy(matrix->values + (size_t)missing_rows[j] * dimensions, row, sizeof(float) * dimensions);
+        embedding_cache_put(client->cache, client->model_name, missing_texts[j], row, dimensions);
+    }
+    
+    free_embedding_matrix(fetched);
+    free(missing_texts);
+    free(missing_rows);
+    return matrix;
+}
+
+void free_embedding_matrix(EmbeddingMatrix* matrix) {
+    if (matrix) {
+        free(matrix->values);
+        free(matrix);
+    }
+}
+
+typedef struct {
+    OllamaClient* client;
+    uint64_t deadline_ms;
+} FlightFetch;
+
+// Fetch run by the first of the callers asking for a text. The result goes
+// into the memory cache before the flight lands, so a caller arriving just
+// after it finds the cache filled rather than starting a second request.
+static EmbeddingVector* fetch_for_flight(void* context, const char* text) {
+    FlightFetch* fetch = context;
+    EmbeddingVector* vector = fetch_embedding(fetch->client, text, fetch->deadline_ms);
+    if (vector && fetch->client->memory_cache) {
+        embedding_lru_release(embedding_lru_put(fetch->client->memory_cache, text,
+                                                vector->values, vector->dimensions));
+    }
+    return vector;
+}
+
+// fetch_embedding(), shared with other clients of the same flight group
+// asking for the same text at the same time
+static EmbeddingVector* fetch_coalesced(OllamaClient* client, const char* text, uint64_t deadline_ms) {
+    if (!client->flights) {
+        return fetch_embedding(client, text, deadline_ms);
+    }
+    
+    FlightFetch fetch = { client, deadline_ms };
+    return embedding_flight_do(client->flights, client->model_name, text, deadline_ms,
+                               fetch_for_flight, &fetch);
+}
+
+// Read-only embedding of text from the memory cache, else fetched by
+// deadline_ms and cached
+static const EmbeddingVector* acquire_cached(OllamaClient* client, const char* text, uint64_t deadline_ms) {
+    const EmbeddingVector* shared = embedding_lru_get(client->memory_cache, text);
+    if (shared) {
+        return shared;
+    }
+    
+    EmbeddingVector* vector = fetch_coalesced(client, text, deadline_ms);
+    if (!vector) {
+        return NULL;
+    }
+    shared = embedding_lru_put(client->memory_cache, text, vector->values, vector->dimensions);
+    free_embedding_vector(vector);
+    return shared;
+}
+
+// Owned embedding of text; free it with free_embedding_vector()
+EmbeddingVector* generate_embedding(OllamaClient* client, const char* text) {
+    return generate_embedding_until(client, text, EMBEDDING_NO_DEADLINE);
+}
+
+// As generate_embedding(), but NULL once deadline_ms passes, or at once
+// while the circuit breaker keeps Ollama out. Cached texts are still served.
+EmbeddingVector* generate_embedding_until(OllamaClient* client, const char* text, uint64_t deadline_ms) {
+    if (!client || !text) {
+        return NULL;
+    }
+    
+    if (!client->memory_cache) {
+        return fetch_coalesced(client, text, deadline_ms);
+    }
+    
+    const EmbeddingVector* shared = acquire_cached(client, text, deadline_ms);
+    if (!shared) {
+        return NULL;
+    }
+    EmbeddingVector* vector = copy_embedding(shared->values, shared->dimensions);
+    release_embedding(client, shared);
     return vector;
 }
 
+// Read-only embedding of text; give it back with release_embedding(). With a
+// memory cache, text used recently costs neither a request nor an allocation.
+const EmbeddingVector* acquire_embedding(OllamaClient* client, const char* text) {
+    if (!client || !text) {
+        return NULL;
+    }
+    
+    if (!client->memory_cache) {
+        return fetch_coalesced(client, text, EMBEDDING_NO_DEADLINE);
+    }
+    return acquire_cached(client, text, EMBEDDING_NO_DEADLINE);
+}
+
+void release_embedding(OllamaClient* client, const EmbeddingVector* vector) {
+    if (!client || !vector) return;
+    
+    if (client->memory_cache) {
+        embedding_lru_release(vector);
+    } else {
+        free_embedding_vector((EmbeddingVector*)vector);
+    }
+}
+
 void free_embedding_vector(EmbeddingVector* vector) {
     if (vector) {
         free(vector->values);
@@ -216,27 +752,33 @@ void free_embedding_vector(EmbeddingVector* vector) {
     }
 }
 
+void normalize_embedding_vector(EmbeddingVector* vector) {
+    if (vector && vector->values) {
+        vector_normalize(vector->values, vector->dimensions);
+    }
+}
+
 float calculate_cosine_similarity(const EmbeddingVector* a, const EmbeddingVector* b) {
     if (!a || !b || a->dimensions != b->dimensions) {
         return 0.0f;
     }
     
-    float dot_product = 0.0f;
-    float norm_a = 0.0f;
-    float norm_b = 0.0f;
-    
-    for (int i = 0; i < a->dimensions; i++) {
-        dot_product += a->values[i] * b->values[i];
-        norm_a += a->values[i] * a->values[i];
-        norm_b += b->values[i] * b->values[i];
-    }
-    
-    norm_a = sqrtf(norm_a);
-    norm_b = sqrtf(norm_b);
+    float dot_product = vector_dot(a->values, b->values, a->dimensions);
+    float norm_a = vector_norm(a->values, a->dimensions);
+    float norm_b = vector_norm(b->values, b->dimensions);
     
     if (norm_a == 0.0f || norm_b == 0.0f) {
         return 0.0f;
     }
     
     return dot_product / (norm_a * norm_b);
+}
+
+// Cosine similarity of vectors already scaled to unit length
+float calculate_normalized_similarity(const EmbeddingVector* a, const EmbeddingVector* b) {
+    if (!a || !b || a->dimensions != b->dimensions) {
+        return 0.0f;
+    }
+    
+    return vector_dot(a->values, b->values, a->dimensions);
 }
\ No newline at end of file
@@ -0,0 +1,1018 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stddef.h>
+#include <pthread.h>
+#include "../../include/vector_ops.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define VECTOR_OPS_X86 1
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define VECTOR_OPS_NEON 1
+#include <arm_neon.h>
+#endif
+
+// Rows scored together by the GEMV kernels, so each load of x feeds 4 rows
+#define GEMV_ROW_BLOCK 4
+
+typedef float (*DotKernel)(const float* a, const float* b, int n);
+typedef void (*Dot4Kernel)(const float* rows, size_t stride, const float* x, int n, float* out);
+typedef int32_t (*DotI8Kernel)(const int8_t* a, const int8_t* b, int n);
+typedef float (*DotHalfKernel)(const uint16_t* a, const float* b, int n);
+typedef int (*HammingKernel)(const uint64_t* a, const uint64_t* b, int words);
+
+typedef struct {
+    const char* name;
+    DotKernel dot;
+    Dot4Kernel dot4;
+    DotI8Kernel dot_i8;
+    DotHalfKernel dot_f16;
+    DotHalfKernel dot_bf16;
+    HammingKernel hamming;
+    int (*supported)(void);
+} VectorKernel;
+
+// IEEE half precision: 1 sign, 5 exponent and 10 mantissa bits
+static float f16_to_float(uint16_t half) {
+    uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+    
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent != 0) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else {
+        // Zero or subnormal: mantissa units of 2^-24
+        float value = (float)mantissa * (1.0f / 16777216.0f);
+        return sign ? -value : value;
+    }
+    
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// Rounds to nearest even, like the F16C conversion
+static uint16_t float_to_f16(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    uint32_t magnitude = bits & 0x7FFFFFFF;
+    
+    if (magnitude > 0x7F800000) {
+        return sign | 0x7E00;
+    }
+    if (magnitude >= 0x477FF000) {
+        // 65520 and up round past the largest half, 65504
+        return sign | 0x7C00;
+    }
+    if (magnitude < 0x38800000) {
+        // Below 2^-14 the result is subnormal; the scaling is exact
+        return sign | (uint16_t)lrintf(fabsf(value) * 16777216.0f);
+    }
+    
+    uint32_t rounded = magnitude + 0xFFF + ((magnitude >> 13) & 1);
+    return sign | (uint16_t)((rounded - 0x38000000) >> 13);
+}
+
+// bfloat16 is the upper half of a float
+static float bf16_to_float(uint16_t half) {
+    uint32_t bits = (uint32_t)half << 16;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static uint16_t float_to_bf16(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7FFFFFFF) > 0x7F800000) {
+        return (uint16_t)((bits >> 16) | 0x40);
+    }
+    bits += 0x7FFF + ((bits >> 16) & 1);
+    return (uint16_t)(bits >> 16);
+}
+
+static float dot_scalar(const float* a, const float* b, int n) {
+    // Four partial sums keep the dependency chain short
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int i = 0;
+    
+    for (; i + 4 <= n; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < n; i++) {
+        s0 += a[i] * b[i];
+    }
+    
+    return (s0 + s1) + (s2 + s3);
+}
+
+static void dot4_scalar(const float* rows, size_t stride, const float* x, int n, float* out) {
+    const float* r0 = rows;
+    const float* r1 = rows + stride;
+    const float* r2 = rows + 2 * stride;
+    const float* r3 = rows + 3 * stride;
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    
+    for (int i = 0; i < n; i++) {
+        float xi = x[i];
+        s0 += r0[i] * xi;
+        s1 += r1[i] * xi;
+        s2 += r2[i] * xi;
+        s3 += r3[i] * xi;
+    }
+    
+    out[0] = s0;
+    out[1] = s1;
+    out[2] = s2;
+    out[3] = s3;
+}
+
+static int32_t dot_i8_scalar(const int8_t* a, const int8_t* b, int n) {
+    int32_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+}
+
+static float dot_f16_scalar(const uint16_t* a, const float* b, int n) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int i = 0;
+    
+    for (; i + 4 <= n; i += 4) {
+        s0 += f16_to_float(a[i]) * b[i];
+        s1 += f16_to_float(a[i + 1]) * b[i + 1];
+        s2 += f16_to_float(a[i + 2]) * b[i + 2];
+        s3 += f16_to_float(a[i + 3]) * b[i + 3];
+    }
+    for (; i < n; i++) {
+        s0 += f16_to_float(a[i]) * b[i];
+    }
+    
+    return (s0 + s1) + (s2 + s3);
+}
+
+static float dot_bf16_scalar(const uint16_t* a, const float* b, int n) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    int i = 0;
+    
+    for (; i + 4 <= n; i += 4) {
+        s0 += bf16_to_float(a[i]) * b[i];
+        s1 += bf16_to_float(a[i + 1]) * b[i + 1];
+        s2 += bf16_to_float(a[i + 2]) * b[i + 2];
+        s3 += bf16_to_float(a[i + 3]) * b[i + 3];
+    }
+    for (; i < n; i++) {
+        s0 += bf16_to_float(a[i]) * b[i];
+    }
+    
+    return (s0 + s1) + (s2 + s3);
+}
+
+// Without a popcount instruction the builtin falls back to bit arithmetic
+static int hamming_scalar(const uint64_t* a, const uint64_t* b, int words) {
+    int distance = 0;
+    for (int i = 0; i < words; i++) {
+        distance += __builtin_popcountll(a[i] ^ b[i]);
+    }
+    return distance;
+}
+
+static int always_supported(void) {
+    return 1;
+}
+
+#ifdef VECTOR_OPS_X86
+
+// The same loop compiled to one POPCNT per word
+__attribute__((target("popcnt")))
+static int hamming_popcnt(const uint64_t* a, const uint64_t* b, int words) {
+    int distance = 0;
+    for (int i = 0; i < words; i++) {
+        distance += __builtin_popcountll(a[i] ^ b[i]);
+    }
+    return distance;
+}
+
+__attribute__((target("avx512f")))
+static float dot_avx512(const float* a, const float* b, int n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    int i = 0;
+    
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    }
+    if (i < n) {
+        // Masked loads handle the tail without a scalar loop
+        __mmask16 mask = (__mmask16)((1u << (n - i)) - 1);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i),
+                               _mm512_maskz_loadu_ps(mask, b + i), acc1);
+    }
+    
+    return _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+}
+
+__attribute__((target("avx512f")))
+static void dot4_avx512(const float* rows, size_t stride, const float* x, int n, float* out) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    __m512 acc2 = _mm512_setzero_ps();
+    __m512 acc3 = _mm512_setzero_ps();
+    int i = 0;
+    
+    for (; i + 16 <= n; i += 16) {
+        __m512 xv = _mm512_loadu_ps(x + i);
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(rows + i), xv, acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(rows + stride + i), xv, acc1);
+        acc2 = _mm512_fmadd_ps(_mm512_loadu_ps(rows + 2 * stride + i), xv, acc2);
+        acc3 = _mm512_fmadd_ps(_mm512_loadu_ps(rows + 3 * stride + i), xv, acc3);
+    }
+    if (i < n) {
+        __mmask16 mask = (__mmask16)((1u << (n - i)) - 1);
+        __m512 xv = _mm512_maskz_loadu_ps(mask, x + i);
+        acc0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, rows + i), xv, acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, rows + stride + i), xv, acc1);
+        acc2 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, rows + 2 * stride + i), xv, acc2);
+        acc3 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, rows + 3 * stride + i), xv, acc3);
+    }
+    
+    out[0] = _mm512_reduce_add_ps(acc0);
+    out[1] = _mm512_reduce_add_ps(acc1);
+    out[2] = _mm512_reduce_add_ps(acc2);
+    out[3] = _mm512_reduce_add_ps(acc3);
+}
+
+// Sign-extend to 16 bits, then multiply pairs and add them into 32-bit lanes
+__attribute__((target("avx512f,avx512bw")))
+static int32_t dot_i8_avx512(const int8_t* a, const int8_t* b, int n) {
+    __m512i acc = _mm512_setzero_si512();
+    int i = 0;
+    
+    for (; i + 32 <= n; i += 32) {
+        __m512i va = _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(a + i)));
+        __m512i vb = _mm512_cvtepi8_epi16(_mm256_loadu_si256((const __m256i*)(b + i)));
+        acc = _mm512_add_epi32(acc, _mm512_madd_epi16(va, vb));
+    }
+    
+    int32_t sum = _mm512_reduce_add_epi32(acc);
+    for (; i < n; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+}
+
+// AVX-512F converts 16 halves per instruction; bfloat16 only needs widening
+// to 32 bits and a shift into the upper half
+__attribute__((target("avx512f")))
+static float dot_f16_avx512(const uint16_t* a, const float* b, int n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    int i = 0;
+    
+    for (; i + 32 <= n; i += 32) {
+        __m512 a0 = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(a + i)));
+        __m512 a1 = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(a + i + 16)));
+        acc0 = _mm512_fmadd_ps(a0, _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(a1, _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        __m512 a0 = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i*)(a + i)));
+        acc0 = _mm512_fmadd_ps(a0, _mm512_loadu_ps(b + i), acc0);
+    }
+    
+    float result = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        result += f16_to_float(a[i]) * b[i];
+    }
+    return result;
+}
+
+__attribute__((target("avx512f")))
+static __m512 load_bf16_avx512(const uint16_t* a) {
+    __m512i wide = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i*)a));
+    return _mm512_castsi512_ps(_mm512_slli_epi32(wide, 16));
+}
+
+__attribute__((target("avx512f")))
+static float dot_bf16_avx512(const uint16_t* a, const float* b, int n) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    int i = 0;
+    
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm512_fmadd_ps(load_bf16_avx512(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(load_bf16_avx512(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm512_fmadd_ps(load_bf16_avx512(a + i), _mm512_loadu_ps(b + i), acc0);
+    }
+    
+    float result = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        result += bf16_to_float(a[i]) * b[i];
+    }
+    return result;
+}
+
+static int avx512_supported(void) {
+    return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+           __builtin_cpu_supports("popcnt");
+}
+
+__attribute__((target("avx2,fma")))
+static float hsum_avx2(__m256 v) {
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_avx2(const float* a, const float* b, int n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    int i = 0;
+    
+    for (; i + 32 <= n; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    
+    float result = hsum_avx2(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+    for (; i < n; i++) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+__attribute__((target("avx2,fma")))
+static void dot4_avx2(const float* rows, size_t stride, const float* x, int n, float* out) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    int i = 0;
+    
+    for (; i + 8 <= n; i += 8) {
+        __m256 xv = _mm256_loadu_ps(x + i);
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(rows + i), xv, acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(rows + stride + i), xv, acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(rows + 2 * stride + i), xv, acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(rows + 3 * stride + i), xv, acc3);
+    }
+    
+    out[0] = hsum_avx2(acc0);
+    out[1] = hsum_avx2(acc1);
+    out[2] = hsum_avx2(acc2);
+    out[3] = hsum_avx2(acc3);
+    for (; i < n; i++) {
+        out[0] += rows[i] * x[i];
+        out[1] += rows[stride + i] * x[i];
+        out[2] += rows[2 * stride + i] * x[i];
+        out[3] += rows[3 * stride + i] * x[i];
+    }
+}
+
+__attribute__((target("avx2")))
+static int32_t dot_i8_avx2(const int8_t* a, const int8_t* b, int n) {
+    __m256i acc = _mm256_setzero_si256();
+    int i = 0;
+    
+    for (; i + 16 <= n; i += 16) {
+        __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(a + i)));
+        __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i*)(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+    
+    __m128i sum4 = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum4 = _mm_add_epi32(sum4, _mm_shuffle_epi32(sum4, _MM_SHUFFLE(2, 3, 0, 1)));
+    
+    int32_t sum = _mm_cvtsi128_si32(sum4);
+    for (; i < n; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+}
+
+// F16C converts 8 halves per instruction
+__attribute__((target("avx2,fma,f16c")))
+static float dot_f16_avx2(const uint16_t* a, const float* b, int n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    
+    for (; i + 16 <= n; i += 16) {
+        __m256 a0 = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(a + i)));
+        __m256 a1 = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(a + i + 8)));
+        acc0 = _mm256_fmadd_ps(a0, _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(a1, _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m256 a0 = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(a + i)));
+        acc0 = _mm256_fmadd_ps(a0, _mm256_loadu_ps(b + i), acc0);
+    }
+    
+    float result = hsum_avx2(_mm256_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        result += f16_to_float(a[i]) * b[i];
+    }
+    return result;
+}
+
+__attribute__((target("avx2,fma")))
+static __m256 load_bf16_avx2(const uint16_t* a) {
+    __m256i wide = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)a));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16));
+}
+
+__attribute__((target("avx2,fma")))
+static float dot_bf16_avx2(const uint16_t* a, const float* b, int n) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    int i = 0;
+    
+    for (; i + 16 <= n; i += 16) {
+        acc0 = _mm256_fmadd_ps(load_bf16_avx2(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(load_bf16_avx2(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm256_fmadd_ps(load_bf16_avx2(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    
+    float result = hsum_avx2(_mm256_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        result += bf16_to_float(a[i]) * b[i];
+    }
+    return result;
+}
+
+// Every AVX2 CPU also has F16C and POPCNT
+static int avx2_supported(void) {
+    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") &&
+           __builtin_cpu_supports("f16c") && __builtin_cpu_supports("popcnt");
+}
+
+__attribute__((target("sse2")))
+static float dot_sse(const float* a, const float* b, int n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    int i = 0;
+    
+    for (; i + 8 <= n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    
+    __m128 sum = _mm_add_ps(acc0, acc1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    
+    float result = _mm_cvtss_f32(sum);
+    for (; i < n; i++) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+__attribute__((target("sse2")))
+static float hsum_sse(__m128 sum) {
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    return _mm_cvtss_f32(sum);
+}
+
+__attribute__((target("sse2")))
+static void dot4_sse(const float* rows, size_t stride, const float* x, int n, float* out) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    __m128 acc2 = _mm_setzero_ps();
+    __m128 acc3 = _mm_setzero_ps();
+    int i = 0;
+    
+    for (; i + 4 <= n; i += 4) {
+        __m128 xv = _mm_loadu_ps(x + i);
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(rows + i), xv));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(rows + stride + i), xv));
+        acc2 = _mm_add_ps(acc2, _mm_mul_ps(_mm_loadu_ps(rows + 2 * stride + i), xv));
+        acc3 = _mm_add_ps(acc3, _mm_mul_ps(_mm_loadu_ps(rows + 3 * stride + i), xv));
+    }
+    
+    out[0] = hsum_sse(acc0);
+    out[1] = hsum_sse(acc1);
+    out[2] = hsum_sse(acc2);
+    out[3] = hsum_sse(acc3);
+    for (; i < n; i++) {
+        out[0] += rows[i] * x[i];
+        out[1] += rows[stride + i] * x[i];
+        out[2] += rows[2 * stride + i] * x[i];
+        out[3] += rows[3 * stride + i] * x[i];
+    }
+}
+
+// SSE2 has no sign-extending load: interleave each byte with itself and
+// shift right arithmetically instead
+__attribute__((target("sse2")))
+static int32_t dot_i8_sse(const int8_t* a, const int8_t* b, int n) {
+    __m128i acc = _mm_setzero_si128();
+    int i = 0;
+    
+    for (; i + 16 <= n; i += 16) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+        __m128i a_low = _mm_srai_epi16(_mm_unpacklo_epi8(va, va), 8);
+        __m128i a_high = _mm_srai_epi16(_mm_unpackhi_epi8(va, va), 8);
+        __m128i b_low = _mm_srai_epi16(_mm_unpacklo_epi8(vb, vb), 8);
+        __m128i b_high = _mm_srai_epi16(_mm_unpackhi_epi8(vb, vb), 8);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(a_low, b_low));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(a_high, b_high));
+    }
+    
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+    acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+    
+    int32_t sum = _mm_cvtsi128_si32(acc);
+    for (; i < n; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+}
+
+// SSE2 has no half conversion: rebias the exponent with integer operations,
+// then fix up inf/NaN and (through a float subtraction) subnormals. halves
+// holds one value in the low 16 bits of each lane.
+__attribute__((target("sse2")))
+static __m128 widen_f16_sse(__m128i halves) {
+    const __m128i exponent_mask = _mm_set1_epi32(0x0F800000);
+    const __m128i rebias = _mm_set1_epi32(112 << 23);
+    
+    __m128i bits = _mm_slli_epi32(_mm_and_si128(halves, _mm_set1_epi32(0x7FFF)), 13);
+    __m128i exponent = _mm_and_si128(bits, exponent_mask);
+    bits = _mm_add_epi32(bits, rebias);
+    
+    __m128i special = _mm_cmpeq_epi32(exponent, exponent_mask);
+    bits = _mm_add_epi32(bits, _mm_and_si128(special, rebias));
+    
+    __m128 tiny = _mm_castsi128_ps(_mm_cmpeq_epi32(exponent, _mm_setzero_si128()));
+    __m128 renormalized = _mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(1 << 23))),
+                                     _mm_castsi128_ps(_mm_set1_epi32(113 << 23)));
+    __m128 value = _mm_or_ps(_mm_andnot_ps(tiny, _mm_castsi128_ps(bits)),
+                             _mm_and_ps(tiny, renormalized));
+    
+    __m128i sign = _mm_slli_epi32(_mm_and_si128(halves, _mm_set1_epi32(0x8000)), 16);
+    return _mm_or_ps(value, _mm_castsi128_ps(sign));
+}
+
+__attribute__((target("sse2")))
+static float dot_f16_sse(const uint16_t* a, const float* b, int n) {
+    __m128i zero = _mm_setzero_si128();
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    int i = 0;
+    
+    for (; i + 8 <= n; i += 8) {
+        __m128i halves = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128 a0 = widen_f16_sse(_mm_unpacklo_epi16(halves, zero));
+        __m128 a1 = widen_f16_sse(_mm_unpackhi_epi16(halves, zero));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(a0, _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(a1, _mm_loadu_ps(b + i + 4)));
+    }
+    
+    float result = hsum_sse(_mm_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        result += f16_to_float(a[i]) * b[i];
+    }
+    return result;
+}
+
+// bfloat16 widens by interleaving zeros below each value
+__attribute__((target("sse2")))
+static float dot_bf16_sse(const uint16_t* a, const float* b, int n) {
+    __m128i zero = _mm_setzero_si128();
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    int i = 0;
+    
+    for (; i + 8 <= n; i += 8) {
+        __m128i halves = _mm_loadu_si128((const __m128i*)(a + i));
+        __m128 a0 = _mm_castsi128_ps(_mm_unpacklo_epi16(zero, halves));
+        __m128 a1 = _mm_castsi128_ps(_mm_unpackhi_epi16(zero, halves));
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(a0, _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(a1, _mm_loadu_ps(b + i + 4)));
+    }
+    
+    float result = hsum_sse(_mm_add_ps(acc0, acc1));
+    for (; i < n; i++) {
+        result += bf16_to_float(a[i]) * b[i];
+    }
+    return result;
+}
+
+static int sse_supported(void) {
+    return __builtin_cpu_supports("sse2");
+}
+
+#endif // VECTOR_OPS_X86
+
+#ifdef VECTOR_OPS_NEON
+
+static float dot_neon(const float* a, const float* b, int n) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4_t acc2 = vdupq_n_f32(0.0f);
+    float32x4_t acc3 = vdupq_n_f32(0.0f);
+    int i = 0;
+    
+    for (; i + 16 <= n; i += 16) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+        acc2 = vfmaq_f32(acc2, vld1q_f32(a + i + 8), vld1q_f32(b + i + 8));
+        acc3 = vfmaq_f32(acc3, vld1q_f32(a + i + 12), vld1q_f32(b + i + 12));
+    }
+    for (; i + 4 <= n; i += 4) {
+        acc0 = vfmaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    
+    float result = vaddvq_f32(vaddq_f32(vaddq_f32(acc0, acc1), vaddq_f32(acc2, acc3)));
+    for (; i < n; i++) {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+static void dot4_neon(const float* rows, size_t stride, const float* x, int n, float* out) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    float32x4_t acc2 = vdupq_n_f32(0.0f);
+    float32x4_t acc3 = vdupq_n_f32(0.0f);
+    int i = 0;
+    
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t xv = vld1q_f32(x + i);
+        acc0 = vfmaq_f32(acc0, vld1q_f32(rows + i), xv);
+        acc1 = vfmaq_f32(acc1, vld1q_f32(rows + stride + i), xv);
+        acc2 = vfmaq_f32(acc2, vld1q_f32(rows + 2 * stride + i), xv);
+        acc3 = vfmaq_f32(acc3, vld1q_f32(rows + 3 * stride + i), xv);
+    }
+    
+    out[0] = vaddvq_f32(acc0);
+    out[1] = vaddvq_f32(acc1);
+    out[2] = vaddvq_f32(acc2);
+    out[3] = vaddvq_f32(acc3);
+    for (; i < n; i++) {
+        out[0] += rows[i] * x[i];
+        out[1] += rows[stride + i] * x[i];
+        out[2] += rows[2 * stride + i] * x[i];
+        out[3] += rows[3 * stride + i] * x[i];
+    }
+}
+
+static int32_t dot_i8_neon(const int8_t* a, const int8_t* b, int n) {
+    int32x4_t acc = vdupq_n_s32(0);
+    int i = 0;
+    
+    for (; i + 16 <= n; i += 16) {
+        int8x16_t va = vld1q_s8(a + i);
+        int8x16_t vb = vld1q_s8(b + i);
+        acc = vpadalq_s16(acc, vmull_s8(vget_low_s8(va), vget_low_s8(vb)));
+        acc = vpadalq_s16(acc, vmull_s8(vget_high_s8(va), vget_high_s8(vb)));
+    }
+    
+    int32_t sum = vaddvq_s32(acc);
+    for (; i < n; i++) {
+        sum += (int32_t)a[i] * b[i];
+    }
+    return sum;
+}
+
+static float dot_f16_neon(const uint16_t* a, const float* b, int n) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    int i = 0;
+    
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t a0 = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(a + i)));
+        float32x4_t a1 = vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(a + i + 4)));
+        acc0 = vfmaq_f32(acc0, a0, vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, a1, vld1q_f32(b + i + 4));
+    }
+    
+    float result = vaddvq_f32(vaddq_f32(acc0, acc1));
+    for (; i < n; i++) {
+        result += f16_to_float(a[i]) * b[i];
+    }
+    return result;
+}
+
+static float dot_bf16_neon(const uint16_t* a, const float* b, int n) {
+    float32x4_t acc0 = vdupq_n_f32(0.0f);
+    float32x4_t acc1 = vdupq_n_f32(0.0f);
+    int i = 0;
+    
+    for (; i + 8 <= n; i += 8) {
+        float32x4_t a0 = vreinterpretq_f32_u32(vshll_n_u16(vld1_u16(a + i), 16));
+        float32x4_t a1 = vreinterpretq_f32_u32(vshll_n_u16(vld1_u16(a + i + 4), 16));
+        acc0 = vfmaq_f32(acc0, a0, vld1q_f32(b + i));
+        acc1 = vfmaq_f32(acc1, a1, vld1q_f32(b + i + 4));
+    }
+    
+    float result = vaddvq_f32(vaddq_f32(acc0, acc1));
+    for (; i < n; i++) {
+        result += bf16_to_float(a[i]) * b[i];
+    }
+    return result;
+}
+
+// Bits set per byte, summed across the vector: 128 at most, so no overflow
+static int hamming_neon(const uint64_t* a, const uint64_t* b, int words) {
+    int distance = 0;
+    int i = 0;
+    
+    for (; i + 2 <= words; i += 2) {
+        uint8x16_t difference = veorq_u8(vreinterpretq_u8_u64(vld1q_u64(a + i)),
+                                         vreinterpretq_u8_u64(vld1q_u64(b + i)));
+        distance += vaddlvq_u8(vcntq_u8(difference));
+    }
+    for (; i < words; i++) {
+        distance += __builtin_popcountll(a[i] ^ b[i]);
+    }
+    return distance;
+}
+
+#endif // VECTOR_OPS_NEON
+
+// Best first; the scalar kernel is always last and always available
+static const VectorKernel kernels[] = {
+#ifdef VECTOR_OPS_X86
+    { "avx512", dot_avx512, dot4_avx512, dot_i8_avx512, dot_f16_avx512, dot_bf16_avx512,
+      hamming_popcnt, avx512_supported },
+    { "avx2", dot_avx2, dot4_avx2, dot_i8_avx2, dot_f16_avx2, dot_bf16_avx2,
+      hamming_popcnt, avx2_supported },
+    { "sse", dot_sse, dot4_sse, dot_i8_sse, dot_f16_sse, dot_bf16_sse,
+      hamming_scalar, sse_supported },
+#endif
+#ifdef VECTOR_OPS_NEON
+    { "neon", dot_neon, dot4_neon, dot_i8_neon, dot_f16_neon, dot_bf16_neon,
+      hamming_neon, always_supported },
+#endif
+    { "scalar", dot_scalar, dot4_scalar, dot_i8_scalar, dot_f16_scalar, dot_bf16_scalar,
+      hamming_scalar, always_supported },
+};
+
+#define VECTOR_KERNEL_COUNT ((int)(sizeof(kernels) / sizeof(kernels[0])))
+
+static const VectorKernel* active_kernel = NULL;
+static pthread_once_t kernel_once = PTHREAD_ONCE_INIT;
+
+static void select_kernel(void) {
+    for (int i = 0; i < VECTOR_KERNEL_COUNT; i++) {
+        if (kernels[i].supported()) {
+            active_kernel = &kernels[i];
+            return;
+        }
+    }
+}
+
+static const VectorKernel* current_kernel(void) {
+    pthread_once(&kernel_once, select_kernel);
+    return active_kernel;
+}
+
+float vector_dot(const float* a, const float* b, int n) {
+    if (!a || !b || n <= 0) {
+        return 0.0f;
+    }
+    return current_kernel()->dot(a, b, n);
+}
+
+void vector_gemv(const float* matrix, int rows, int cols, size_t stride,
+                 const float* x, float* out) {
+    if (!matrix || !x || !out || rows <= 0 || cols <= 0) {
+        return;
+    }
+    
+    const VectorKernel* kernel = current_kernel();
+    int row = 0;
+    
+    for (; row + GEMV_ROW_BLOCK <= rows; row += GEMV_ROW_BLOCK) {
+        kernel->dot4(matrix + (size_t)row * stride, stride, x, cols, out + row);
+    }
+    for (; row < rows; row++) {
+        out[row] = kernel->dot(matrix + (size_t)row * stride, x, cols);
+    }
+}
+
+// Symmetric per-vector quantization: out[i] = round(v[i] / scale), where
+// scale maps the largest magnitude to 127; returns the scale
+float vector_quantize_i8(const float* v, int n, int8_t* out) {
+    float max_abs = 0.0f;
+    for (int i = 0; i < n; i++) {
+        float magnitude = fabsf(v[i]);
+        if (magnitude > max_abs) max_abs = magnitude;
+    }
+    
+    if (max_abs == 0.0f) {
+        memset(out, 0, n);
+        return 0.0f;
+    }
+    
+    float scale = max_abs / 127.0f;
+    float inverse = 127.0f / max_abs;
+    for (int i = 0; i < n; i++) {
+        long q = lrintf(v[i] * inverse);
+        out[i] = (int8_t)(q > 127 ? 127 : (q < -127 ? -127 : q));
+    }
+    return scale;
+}
+
+int32_t vector_dot_i8(const int8_t* a, const int8_t* b, int n) {
+    if (!a || !b || n <= 0) {
+        return 0;
+    }
+    return current_kernel()->dot_i8(a, b, n);
+}
+
+// out[r] = x_scale * row_scales[r] * (row r . x), the dequantized dot products
+void vector_gemv_i8(const int8_t* matrix, const float* row_scales, int rows, int cols,
+                    size_t stride, const int8_t* x, float x_scale, float* out) {
+    if (!matrix || !row_scales || !x || !out || rows <= 0 || cols <= 0) {
+        return;
+    }
+    
+    DotI8Kernel dot_i8 = current_kernel()->dot_i8;
+    for (int row = 0; row < rows; row++) {
+        out[row] = x_scale * row_scales[row] * (float)dot_i8(matrix + (size_t)row * stride, x, cols);
+    }
+}
+
+// Half-precision rows: half the memory and bandwidth of floats. Conversion
+// rounds to nearest even; dot products widen to float and accumulate in
+// float, against a float x.
+
+void vector_to_f16(const float* v, int n, uint16_t* out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = float_to_f16(v[i]);
+    }
+}
+
+void vector_from_f16(const uint16_t* v, int n, float* out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = f16_to_float(v[i]);
+    }
+}
+
+void vector_to_bf16(const float* v, int n, uint16_t* out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = float_to_bf16(v[i]);
+    }
+}
+
+void vector_from_bf16(const uint16_t* v, int n, float* out) {
+    for (int i = 0; i < n; i++) {
+        out[i] = bf16_to_float(v[i]);
+    }
+}
+
+float vector_dot_f16(const uint16_t* a, const float* b, int n) {
+    if (!a || !b || n <= 0) {
+        return 0.0f;
+    }
+    return current_kernel()->dot_f16(a, b, n);
+}
+
+float vector_dot_bf16(const uint16_t* a, const float* b, int n) {
+    if (!a || !b || n <= 0) {
+        return 0.0f;
+    }
+    return current_kernel()->dot_bf16(a, b, n);
+}
+
+static void gemv_half(DotHalfKernel dot, const uint16_t* matrix, int rows, int cols,
+                      size_t stride, const float* x, float* out) {
+    if (!matrix || !x || !out || rows <= 0 || cols <= 0) {
+        return;
+    }
+    
+    for (int row = 0; row < rows; row++) {
+        out[row] = dot(matrix + (size_t)row * stride, x, cols);
+    }
+}
+
+void vector_gemv_f16(const uint16_t* matrix, int rows, int cols, size_t stride,
+                     const float* x, float* out) {
+    gemv_half(current_kernel()->dot_f16, matrix, rows, cols, stride, x, out);
+}
+
+void vector_gemv_bf16(const uint16_t* matrix, int rows, int cols, size_t stride,
+                      const float* x, float* out) {
+    gemv_half(current_kernel()->dot_bf16, matrix, rows, cols, stride, x, out);
+}
+
+// One bit per element, set where v[i] > 0: (n + 63) / 64 words, with the
+// bits past n clear. Vectors pointing the same way share most sign bits, so
+// the Hamming distance between signatures tracks the angle between vectors.
+void vector_sign_bits(const float* v, int n, uint64_t* out) {
+    int words = (n + 63) / 64;
+    memset(out, 0, sizeof(uint64_t) * words);
+    for (int i = 0; i < n; i++) {
+        if (v[i] > 0.0f) {
+            out[i / 64] |= 1ULL << (i % 64);
+        }
+    }
+}
+
+int vector_hamming(const uint64_t* a, const uint64_t* b, int words) {
+    if (!a || !b || words <= 0) {
+        return 0;
+    }
+    return current_kernel()->hamming(a, b, words);
+}
+
+// out[r] = Hamming distance from x to signature r; signatures are packed
+// words apart. Distances fit 16 bits for up to 65535-bit signatures.
+void vector_hamming_scan(const uint64_t* signatures, int rows, int words,
+                         const uint64_t* x, uint16_t* out) {
+    if (!signatures || !x || !out || rows <= 0 || words <= 0) {
+        return;
+    }
+    
+    HammingKernel hamming = current_kernel()->hamming;
+    for (int row = 0; row < rows; row++) {
+        out[row] = (uint16_t)hamming(signatures + (size_t)row * words, x, words);
+    }
+}
+
+float vector_norm(const float* v, int n) {
+    return sqrtf(vector_dot(v, v, n));
+}
+
+void vector_normalize(float* v, int n) {
+    float norm = vector_norm(v, n);
+    if (norm == 0.0f) {
+        return;
+    }
+    
+    float scale = 1.0f / norm;
+    for (int i = 0; i < n; i++) {
+        v[i] *= scale;
+    }
+}
+
+const char* vector_kernel_name(void) {
+    return current_kernel()->name;
+}
+
+// Kernels usable on this CPU, best first
+int vector_kernel_count(void) {
+    int count = 0;
+    for (int i = 0; i < VECTOR_KERNEL_COUNT; i++) {
+        if (kernels[i].supported()) count++;
+    }
+    return count;
+}
+
+const char* vector_kernel_name_at(int index) {
+    for (int i = 0; i < VECTOR_KERNEL_COUNT; i++) {
+        if (kernels[i].supported() && index-- == 0) {
+            return kernels[i].name;
+        }
+    }
+    return NULL;
+}
+
+// Force a specific kernel (tests and benchmarks); not safe while scoring
+int vector_use_kernel(const char* name) {
+    current_kernel();
+    
+    for (int i = 0; i < VECTOR_KERNEL_COUNT; i++) {
+        if (strcmp(kernels[i].name, name) == 0 && kernels[i].supported()) {
+            active_kernel = &kernels[i];
+            return 0;
+        }
+    }
+    return -1;
+}
@@ -2,9 +2,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <ctype.h>
 #include "../../include/search.h"
-
-Dictionary* create_fallback_dictionary(void);
+#include "../../include/vector_ops.h"
+#include "../../include/utf8.h"
 
 SearchConfig* create_search_config(void) {
     SearchConfig* config = malloc(sizeof(SearchConfig));
@@ -17,6 +18,12 @@ SearchConfig* create_search_config(void) {
     config->phonetic_weight = 0.4f;
     config->max_candidates = 10;
     config->dictionary_path = strdup("resources/dictionary.txt");
+    config->embedding_store_path = strdup("resources/dictionary.emb");
+    config->semantic_index_path = strdup("resources/dictionary.hnsw");
+    config->quantized_embeddings = 1;
+    config->embedding_precision = EmbeddingPrecisionF16;
+    config->binary_prefilter = 0;
+    config->embedding_timeout_ms = SEARCH_DEFAULT_EMBEDDING_TIMEOUT_MS;
     
     return config;
 }
@@ -24,114 +31,436 @@ SearchConfig* create_search_config(void) {
 void free_search_config(SearchConfig* config) {
     if (config) {
         free(config->dictionary_path);
+        free(config->embedding_store_path);
+        free(config->semantic_index_path);
         free(config);
     }
 }
 
-Dictionary* load_dictionary(const char* path) {
-    FILE* file = fopen(path, "r");
-    if (!file) {
-        printf("Warning: Could not load dictionary from %s, using basic fallback\n", path);
-        return create_fallback_dictionary();
+// Text an entry is embedded from: its kanji, and for backends that only
+// compare surface forms its readings too, so kana input can match it
+static char* entry_embedding_text(const Dictionary* dict, int index, const EmbeddingBackend* backend) {
+    const char* kanji = dictionary_field(dict, index, DictionaryFieldKanji);
+    if (!backend->embeds_readings) {
+        return strdup(kanji);
     }
     
-    Dictionary* dict = malloc(sizeof(Dictionary));
-    if (!dict) {
-        fclose(file);
-        return NULL;
+    const char* hiragana = dictionary_field(dict, index, DictionaryFieldHiragana);
+    const char* romaji = dictionary_field(dict, index, DictionaryFieldRomaji);
+    size_t size = strlen(kanji) + strlen(hiragana) + strlen(romaji) + 3;
+    char* text = malloc(size);
+    if (text) {
+        snprintf(text, size, "%s %s %s", kanji, hiragana, romaji);
+    }
+    return text;
+}
+
+static void free_entry_texts(char** texts, int count) {
+    for (int i = 0; i < count; i++) {
+        free(texts[i]);
+        texts[i] = NULL;
+    }
+}
+
+// One request per entry, for servers without the batch endpoint
+static EmbeddingStore* embed_entries_individually(const Dictionary* dict, EmbeddingBackend* backend,
+                                                  uint64_t fingerprint) {
+    EmbeddingStore* store = NULL;
+    
+    for (int i = 0; i < dict->entry_count; i++) {
+        char* text = entry_embedding_text(dict, i, backend);
+        EmbeddingVector* vector = text ? embedding_backend_embed(backend, text, EMBEDDING_NO_DEADLINE) : NULL;
+        free(text);
+        
+        if (!store) {
+            // The first entry decides the dimensions; without it the backend is unusable
+            if (!vector) {
+                printf("Warning: Could not embed dictionary entries, semantic scoring disabled\n");
+                return NULL;
+            }
+            store = embedding_store_create(backend->model_name, fingerprint,
+                                           dict->entry_count, vector->dimensions);
+            if (!store) {
+                free_embedding_vector(vector);
+                return NULL;
+            }
+        }
+        
+        if (vector && vector->dimensions == store->dimensions) {
+            // Rows are stored at unit length so scoring is a plain dot product
+            normalize_embedding_vector(vector);
+            memcpy(embedding_store_mutable_row(store, i), vector->values,
+                   sizeof(float) * store->dimensions);
+        } else {
+            store->complete = 0;
+        }
+        
+        free_embedding_vector(vector);
     }
     
-    dict->capacity = 1000;
-    dict->entry_count = 0;
-    dict->entries = malloc(sizeof(DictionaryEntry) * dict->capacity);
-    if (!dict->entries) {
-        free(dict);
-        fclose(file);
+    return store;
+}
+
+static EmbeddingStore* build_dictionary_embeddings(const Dictionary* dict, EmbeddingBackend* backend,
+                                                   uint64_t fingerprint) {
+    int batch_size = backend->batch_size > 0 ? backend->batch_size : OLLAMA_DEFAULT_BATCH_SIZE;
+    char** texts = calloc(batch_size, sizeof(char*));
+    if (!texts) {
         return NULL;
     }
     
-    char line[1024];
-    while (fgets(line, sizeof(line), file) && dict->entry_count < dict->capacity) {
-        // Remove newline
-        line[strcspn(line, "\n")] = '\0';
+    // One request per batch, copied straight into the store's rows
+    EmbeddingStore* store = NULL;
+    for (int first = 0; first < dict->entry_count; first += batch_size) {
+        int count = dict->entry_count - first < batch_size ? dict->entry_count - first : batch_size;
+        int composed = 1;
+        for (int i = 0; i < count; i++) {
+            texts[i] = entry_embedding_text(dict, first + i, backend);
+            composed = composed && texts[i];
+        }
         
-        // Parse line format: "kanji,hiragana,katakana,romaji,frequency"
-        char* kanji = strtok(line, ",");
-        char* hiragana = strtok(NULL, ",");
-        char* katakana = strtok(NULL, ",");
-        char* romaji = strtok(NULL, ",");
-        char* freq_str = strtok(NULL, ",");
+        EmbeddingMatrix* matrix = composed ?
+            embedding_backend_embed_batch(backend, (const char* const*)texts, count,
+                                          EMBEDDING_NO_DEADLINE) : NULL;
+        free_entry_texts(texts, count);
+        if (!store) {
+            if (!matrix) {
+                printf("Warning: Batch embedding failed, embedding entries one at a time\n");
+                free(texts);
+                return embed_entries_individually(dict, backend, fingerprint);
+            }
+            store = embedding_store_create(backend->model_name, fingerprint,
+                                           dict->entry_count, matrix->dimensions);
+            if (!store) {
+                free_embedding_matrix(matrix);
+                free(texts);
+                return NULL;
+            }
+        }
         
-        if (kanji && hiragana && katakana && romaji && freq_str) {
-            DictionaryEntry* entry = &dict->entries[dict->entry_count];
-            entry->kanji = strdup(kanji);
-            entry->hiragana = strdup(hiragana);
-            entry->katakana = strdup(katakana);
-            entry->romaji = strdup(romaji);
-            entry->frequency = atof(freq_str);
-            dict->entry_count++;
+        if (matrix && matrix->dimensions == store->dimensions) {
+            for (int i = 0; i < count; i++) {
+                // Rows are stored at unit length so scoring is a plain dot product
+                float* row = embedding_store_mutable_row(store, first + i);
+                memcpy(row, matrix->values + (size_t)i * matrix->dimensions,
+                       sizeof(float) * store->dimensions);
+                vector_normalize(row, store->dimensions);
+            }
+        } else {
+            store->complete = 0;
         }
+        
+        free_embedding_matrix(matrix);
+    }
+    
+    free(texts);
+    return store;
+}
+
+// Float copy of a loaded store, so it can be saved again at another precision
+// without embedding the dictionary again
+static EmbeddingStore* copy_store_rows(const EmbeddingStore* source) {
+    EmbeddingStore* store = embedding_store_create(source->model_name, source->dictionary_hash,
+                                                   source->entry_count, source->dimensions);
+    if (!store) {
+        return NULL;
     }
     
-    fclose(file);
-    printf("Loaded dictionary with %d entries\n", dict->entry_count);
-    return dict;
+    for (int i = 0; i < source->entry_count; i++) {
+        float* row = embedding_store_mutable_row(store, i);
+        const float* source_row = embedding_store_read_row(source, i, row);
+        if (source_row != row) {
+            memcpy(row, source_row, sizeof(float) * store->dimensions);
+        }
+    }
+    return store;
 }
 
-Dictionary* create_fallback_dictionary(void) {
-    Dictionary* dict = malloc(sizeof(Dictionary));
-    if (!dict) return NULL;
+// Below this many entries one GEMV over the store beats walking a graph
+#define SEARCH_HNSW_MIN_ENTRIES 20000
+
+static HnswIndex* attach_semantic_index(const EmbeddingStore* store, const char* index_path) {
+    HnswIndex* index = index_path ? hnsw_load(index_path, store) : NULL;
+    if (index) {
+        return index;
+    }
     
-    dict->capacity = 10;
-    dict->entry_count = 5;
-    dict->entries = malloc(sizeof(DictionaryEntry) * dict->capacity);
-    if (!dict->entries) {
-        free(dict);
+    index = hnsw_build(store, HNSW_DEFAULT_M, HNSW_DEFAULT_EF_CONSTRUCTION);
+    if (!index) {
+        printf("Warning: Could not build HNSW index, using exact semantic scoring\n");
         return NULL;
     }
+    if (index_path) {
+        hnsw_save(index, index_path);
+    }
+    return index;
+}
+
+int attach_dictionary_embeddings(Dictionary* dict, EmbeddingBackend* backend,
+                                 const SearchConfig* config) {
+    if (!dict || !backend || !config) {
+        return -1;
+    }
     
-    // Basic fallback entries
-    const char* fallback_data[][5] = {
-        {"こんにちは", "こんにちは", "コンニチハ", "konnichiwa", "1.0"},
-        {"ありがとう", "ありがとう", "アリガトウ", "arigatou", "0.9"},
-        {"さようなら", "さようなら", "サヨウナラ", "sayounara", "0.8"},
-        {"おはよう", "おはよう", "オハヨウ", "ohayou", "0.85"},
-        {"こんばんは", "こんばんは", "コンバンハ", "konbanwa", "0.75"}
-    };
+    const char* store_path = config->embedding_store_path;
+    uint64_t fingerprint = dictionary_fingerprint(dict);
+    EmbeddingStore* store = NULL;
     
-    for (int i = 0; i < dict->entry_count; i++) {
-        DictionaryEntry* entry = &dict->entries[i];
-        entry->kanji = strdup(fallback_data[i][0]);
-        entry->hiragana = strdup(fallback_data[i][1]);
-        entry->katakana = strdup(fallback_data[i][2]);
-        entry->romaji = strdup(fallback_data[i][3]);
-        entry->frequency = atof(fallback_data[i][4]);
+    if (store_path) {
+        store = embedding_store_load(store_path, backend->model_name,
+                                     fingerprint, dict->entry_count);
+    }
+    
+    // A store saved at another precision, or without the signatures the
+    // prefilter needs, is converted rather than rebuilt
+    if (store && (store->precision != config->embedding_precision ||
+                  (config->binary_prefilter && !store->signatures))) {
+        printf("Converting embedding store from %s to %s\n",
+               embedding_precision_name(store->precision),
+               embedding_precision_name(config->embedding_precision));
+        EmbeddingStore* loaded = store;
+        store = copy_store_rows(loaded);
+        embedding_store_destroy(loaded);
+        if (!store) {
+            return -1;
+        }
+    }
+    
+    if (!store || !store->image) {
+        if (!store) {
+            store = build_dictionary_embeddings(dict, backend, fingerprint);
+            if (!store) {
+                return -1;
+            }
+        }
+        if (embedding_store_quantize(store) != 0) {
+            printf("Warning: Could not quantize dictionary embeddings\n");
+        }
+        if (embedding_store_build_signatures(store) != 0) {
+            printf("Warning: Could not build dictionary embedding signatures\n");
+        }
+        if (embedding_store_set_precision(store, config->embedding_precision) != 0) {
+            printf("Warning: Could not store dictionary embeddings as %s\n",
+                   embedding_precision_name(config->embedding_precision));
+        }
+        
+        // Only persist a full build, so missing rows get retried next startup.
+        // The saved file is then mapped, so full rows stay out of memory
+        // unless a query re-ranks them
+        if (store_path && store->complete && embedding_store_save(store, store_path) == 0) {
+            EmbeddingStore* mapped = embedding_store_load(store_path, backend->model_name,
+                                                          fingerprint, dict->entry_count);
+            if (mapped) {
+                embedding_store_destroy(store);
+                store = mapped;
+            }
+        }
     }
     
-    printf("Created fallback dictionary with %d entries\n", dict->entry_count);
-    return dict;
+    hnsw_destroy(dict->semantic_index);
+    dict->semantic_index = NULL;
+    embedding_store_destroy(dict->embeddings);
+    dict->embeddings = store;
+    
+    // The signature prefilter scans every entry in place of the graph
+    int prefiltered = config->binary_prefilter && store->signatures;
+    if (store->entry_count >= SEARCH_HNSW_MIN_ENTRIES && !prefiltered) {
+        dict->semantic_index = attach_semantic_index(store, config->semantic_index_path);
+    }
+    return 0;
 }
 
-void free_dictionary(Dictionary* dict) {
-    if (!dict) return;
+// Entries taken on embedding similarity alone, in addition to the trie
+// candidates, so semantically close words with unrelated readings still compete
+#define SEARCH_SEMANTIC_CANDIDATES 64
+
+// Beam width of HNSW queries; wider trades latency for recall
+#define SEARCH_SEMANTIC_EF 128
+
+// With int8 scoring, this many times SEARCH_SEMANTIC_CANDIDATES entries are
+// shortlisted on approximate scores and re-ranked with the full rows
+#define SEARCH_RERANK_FACTOR 4
+
+// Signatures rank far more coarsely than int8 rows, so their shortlist is
+// longer; it is scored exactly either way
+#define SEARCH_SIGNATURE_RERANK_FACTOR 16
+
+// Per-query state shared by the candidate generators
+typedef struct {
+    const char* query;              // Input as compared against reading_field
+    EditPattern query_pattern;      // query prepared for edit distance
+    DictionaryField reading_field;  // Hiragana, or romaji for ASCII input
+    const Dictionary* dict;
+    const SearchConfig* config;
+    const float* query_embedding;   // Unit-length input embedding, or NULL
+    const float* embedding_scores;  // Query similarity of every entry, or NULL
+    int approximate_scores;         // embedding_scores come from the int8 rows
+    const int* semantic_ids;        // Already scored from embeddings, ascending
+    int semantic_count;
+    TopKSelector* selector;         // Best max_candidates entries seen so far
+} SearchContext;
+
+// 1 - (edit distance / longer length), in code points
+static float reading_similarity(const EditPattern* pattern, const char* reading) {
+    int reading_length;
+    int distance = edit_pattern_distance(pattern, reading, &reading_length);
+    int longest = pattern->length > reading_length ? pattern->length : reading_length;
     
-    for (int i = 0; i < dict->entry_count; i++) {
-        free(dict->entries[i].kanji);
-        free(dict->entries[i].hiragana);
-        free(dict->entries[i].katakana);
-        free(dict->entries[i].romaji);
+    if (longest == 0) return 1.0f;
+    if (distance < 0) return 0.0f;
+    return 1.0f - (float)distance / (float)longest;
+}
+
+static float exact_embedding_score(const SearchContext* context, int entry_id) {
+    return embedding_store_dot(context->dict->embeddings, entry_id, context->query_embedding);
+}
+
+static float entry_embedding_score(const SearchContext* context, int entry_id) {
+    // Embedding similarity comes from the batched score array when the whole
+    // dictionary was scored, else from the entry's row
+    if (context->embedding_scores) {
+        return context->embedding_scores[entry_id];
+    } else if (context->query_embedding) {
+        return exact_embedding_score(context, entry_id);
+    }
+    return 0.0f;
+}
+
+// Score one dictionary entry against the query; returns the combined score
+static float score_entry(const SearchContext* context, int entry_id,
+                         float* embedding_score, float* phonetic_score) {
+    // Calculate phonetic similarity
+    const char* reading = dictionary_field(context->dict, entry_id, context->reading_field);
+    *phonetic_score = reading_similarity(&context->query_pattern, reading);
+    *embedding_score = entry_embedding_score(context, entry_id);
+    
+    // Calculate combined score
+    return calculate_combined_score(*embedding_score, *phonetic_score,
+                                    context->dict->frequencies[entry_id], context->config);
+}
+
+// Largest edit distance at which the entry can still beat threshold, from
+// inverting calculate_combined_score() for the phonetic score; -1 if no
+// reading could, or query plus reading length if anything goes
+static int max_useful_distance(const SearchContext* context, int entry_id, float embedding_score,
+                               int longest, float threshold) {
+    const SearchConfig* config = context->config;
+    float frequency_factor = 1.0f + context->dict->frequencies[entry_id] * SEARCH_FREQUENCY_BOOST;
+    if (config->phonetic_weight <= 0.0f || frequency_factor <= 0.0f) {
+        return longest;
     }
     
-    free(dict->entries);
-    free(dict);
+    float min_phonetic = (threshold / frequency_factor - embedding_score * config->embedding_weight) /
+                         config->phonetic_weight;
+    if (min_phonetic >= 1.0f) return -1;
+    if (min_phonetic <= 0.0f) return longest;
+    
+    // phonetic = 1 - distance / longest must exceed min_phonetic; rounding
+    // down keeps the boundary case, which the exact score then decides
+    return (int)(longest * (1.0f - min_phonetic));
+}
+
+// Largest edit distance at which any reading can still beat threshold, as
+// max_useful_distance() bounds it for the most frequent entry. A reading of
+// length L is at least |L - query_length| edits from the query and must stay
+// under L * (1 - min_phonetic), which caps the distance at
+// query_length * (1 - min_phonetic) / min_phonetic; -1 if nothing can.
+int search_typo_distance(const Dictionary* dict, const SearchConfig* config, int query_length,
+                         float embedding_score, float threshold) {
+    float frequency_factor = 1.0f + dict->max_frequency * SEARCH_FREQUENCY_BOOST;
+    if (config->phonetic_weight <= 0.0f || frequency_factor <= 0.0f) {
+        return SEARCH_MAX_TYPO_DISTANCE;
+    }
+    
+    float min_phonetic = (threshold / frequency_factor - embedding_score * config->embedding_weight) /
+                         config->phonetic_weight;
+    if (min_phonetic >= 1.0f) return -1;
+    if (min_phonetic <= 0.0f) return SEARCH_MAX_TYPO_DISTANCE;
+    
+    float reachable = query_length * (1.0f - min_phonetic) / min_phonetic;
+    return reachable < SEARCH_MAX_TYPO_DISTANCE ? (int)reachable : SEARCH_MAX_TYPO_DISTANCE;
+}
+
+static int compare_ids(const void* a, const void* b) {
+    int id_a = *(const int*)a;
+    int id_b = *(const int*)b;
+    return (id_a > id_b) - (id_a < id_b);
+}
+
+static void collect_entry(SearchContext* context, int entry_id) {
+    // Entries picked on embedding similarity were scored up front
+    if (context->semantic_count > 0 &&
+        bsearch(&entry_id, context->semantic_ids, context->semantic_count,
+                sizeof(int), compare_ids)) {
+        return;
+    }
+    
+    // Only keep candidates with reasonable scores that can enter the top K,
+    // so the edit distance can stop as soon as the reading is too far off
+    float threshold = topk_threshold(context->selector);
+    if (threshold < SEARCH_MIN_COMBINED_SCORE) {
+        threshold = SEARCH_MIN_COMBINED_SCORE;
+    }
+    
+    const EditPattern* pattern = &context->query_pattern;
+    const char* reading = dictionary_field(context->dict, entry_id, context->reading_field);
+    int reading_length = utf8_length(reading);
+    int longest = pattern->length > reading_length ? pattern->length : reading_length;
+    
+    float embedding_score = entry_embedding_score(context, entry_id);
+    int max_distance = max_useful_distance(context, entry_id, embedding_score, longest, threshold);
+    if (max_distance < 0) {
+        return;
+    }
+    
+    int distance = edit_pattern_distance_bounded(pattern, reading, reading_length, max_distance);
+    if (distance < 0 || distance > max_distance) {
+        return;
+    }
+    
+    float phonetic_score = longest > 0 ? 1.0f - (float)distance / (float)longest : 1.0f;
+    float combined_score = calculate_combined_score(embedding_score, phonetic_score,
+                                                    context->dict->frequencies[entry_id],
+                                                    context->config);
+    if (combined_score > SEARCH_MIN_COMBINED_SCORE) {
+        topk_push(context->selector, entry_id, combined_score);
+    }
+}
+
+// Lowercased copy of the input if it looks like romaji keystrokes, else NULL
+static char* normalize_romaji_input(const char* input_text) {
+    if (!input_text[0]) {
+        return NULL;
+    }
+    
+    for (const char* p = input_text; *p; p++) {
+        if (!isalpha((unsigned char)*p) && *p != '-' && *p != '\'') {
+            return NULL;
+        }
+    }
+    
+    char* query = strdup(input_text);
+    if (query) {
+        for (char* p = query; *p; p++) {
+            *p = (char)tolower((unsigned char)*p);
+        }
+    }
+    return query;
+}
+
+// Every trie candidate is offered to the selector, so the best K are exact
+// whatever order the trie enumerates them in
+static int visit_trie_candidate(int entry_id, void* user_data) {
+    collect_entry(user_data, entry_id);
+    return 0;
 }
 
 CandidateList* search_candidates(const char* input_text,
                                 const MorphResult* morph_result,
                                 const Dictionary* dict,
                                 const SearchConfig* config,
-                                OllamaClient* ollama_client) {
-    if (!input_text || !dict || !config) {
+                                EmbeddingBackend* backend) {
+    if (!input_text || !dict || !config || config->max_candidates <= 0) {
         return NULL;
     }
     
@@ -141,57 +470,171 @@ CandidateList* search_candidates(const char* input_text,
     candidates->capacity = config->max_candidates;
     candidates->candidate_count = 0;
     candidates->candidates = malloc(sizeof(NovaKeyCandidate) * candidates->capacity);
-    if (!candidates->candidates) {
+    TopKSelector* selector = topk_create(config->max_candidates);
+    if (!candidates->candidates || !selector) {
+        topk_destroy(selector);
+        free(candidates->candidates);
         free(candidates);
         return NULL;
     }
     
-    // Generate embedding for input text
+    // Generate embedding for input text; entries are scored against the
+    // precomputed store, so this is the only embedding request per query.
+    // Past its deadline, or while the backend's circuit is open, the query
+    // is scored on readings alone.
+    const EmbeddingStore* store = dict->embeddings;
     EmbeddingVector* input_embedding = NULL;
-    if (ollama_client) {
-        input_embedding = generate_embedding(ollama_client, input_text);
+    if (backend && store) {
+        uint64_t deadline_ms = config->embedding_timeout_ms > 0 ?
+            embedding_deadline_in(config->embedding_timeout_ms) : EMBEDDING_NO_DEADLINE;
+        input_embedding = embedding_backend_embed(backend, input_text, deadline_ms);
+        if (input_embedding && input_embedding->dimensions != store->dimensions) {
+            free_embedding_vector(input_embedding);
+            input_embedding = NULL;
+        }
+        normalize_embedding_vector(input_embedding);
     }
     
-    // Search through dictionary entries
-    for (int i = 0; i < dict->entry_count && candidates->candidate_count < config->max_candidates; i++) {
-        DictionaryEntry* entry = &dict->entries[i];
-        
-        // Calculate phonetic similarity
-        float phonetic_score = calculate_phonetic_similarity(input_text, entry->hiragana);
-        
-        // Calculate embedding similarity
-        float embedding_score = 0.0f;
-        if (input_embedding && ollama_client) {
-            EmbeddingVector* entry_embedding = generate_embedding(ollama_client, entry->kanji);
-            if (entry_embedding) {
-                embedding_score = calculate_cosine_similarity(input_embedding, entry_embedding);
-                free_embedding_vector(entry_embedding);
+    // Score the whole dictionary with one GEMV over the store matrix, unless
+    // it is large enough to have a neighbour graph, or semantic candidates
+    // come from signatures
+    float* embedding_scores = NULL;
+    int quantized = config->quantized_embeddings && store && store->quantized;
+    int prefiltered = config->binary_prefilter && store && store->signatures;
+    if (input_embedding && !dict->semantic_index && !prefiltered && dict->entry_count > 0) {
+        embedding_scores = malloc(sizeof(float) * dict->entry_count);
+        int status = -1;
+        if (embedding_scores) {
+            status = quantized ?
+                embedding_store_score_quantized(store, input_embedding->values, embedding_scores) :
+                embedding_store_score(store, input_embedding->values, embedding_scores);
+        }
+        if (status != 0) {
+            free(embedding_scores);
+            embedding_scores = NULL;
+        }
+    }
+    
+    // Romaji keystrokes are resolved through the romaji index directly
+    char* romaji_query = normalize_romaji_input(input_text);
+    const DoubleArrayTrie* index = romaji_query ? &dict->romaji_index : &dict->hiragana_index;
+    
+    SearchContext context = {
+        .query = romaji_query ? romaji_query : input_text,
+        .reading_field = romaji_query ? DictionaryFieldRomaji : DictionaryFieldHiragana,
+        .dict = dict,
+        .config = config,
+        .query_embedding = input_embedding ? input_embedding->values : NULL,
+        .embedding_scores = embedding_scores,
+        .approximate_scores = embedding_scores && quantized,
+        .semantic_ids = NULL,
+        .semantic_count = 0,
+        .selector = selector
+    };
+    if (edit_pattern_init(&context.query_pattern, context.query) != 0) {
+        free(romaji_query);
+        free(embedding_scores);
+        free_embedding_vector(input_embedding);
+        topk_destroy(selector);
+        free(candidates->candidates);
+        free(candidates);
+        return NULL;
+    }
+    
+    // Candidate generation by embedding: the nearest entries whatever their
+    // reading, from the score array or the HNSW graph
+    int semantic_ids[SEARCH_SEMANTIC_CANDIDATES];
+    TopKSelector* semantic = input_embedding ? topk_create(SEARCH_SEMANTIC_CANDIDATES) : NULL;
+    if (semantic) {
+        if (prefiltered) {
+            // Shortlist on signature Hamming distance, then score the
+            // shortlist exactly; other entries are scored from their rows
+            int limit = SEARCH_SEMANTIC_CANDIDATES * SEARCH_SIGNATURE_RERANK_FACTOR;
+            int* shortlist = malloc(sizeof(int) * limit);
+            int count = shortlist ?
+                embedding_store_signature_shortlist(store, input_embedding->values, limit, shortlist) : -1;
+            for (int i = 0; i < count; i++) {
+                topk_push(semantic, shortlist[i], exact_embedding_score(&context, shortlist[i]));
+            }
+            free(shortlist);
+        } else if (context.approximate_scores) {
+            // Shortlist on int8 scores, then order the shortlist exactly
+            TopKSelector* shortlist = topk_create(SEARCH_SEMANTIC_CANDIDATES * SEARCH_RERANK_FACTOR);
+            if (shortlist) {
+                topk_push_scores(shortlist, embedding_scores, dict->entry_count, 0.0f);
+                for (int i = 0; i < shortlist->count; i++) {
+                    int entry_id = shortlist->items[i].id;
+                    embedding_scores[entry_id] = exact_embedding_score(&context, entry_id);
+                    topk_push(semantic, entry_id, embedding_scores[entry_id]);
+                }
+                topk_destroy(shortlist);
             }
+        } else if (embedding_scores) {
+            topk_push_scores(semantic, embedding_scores, dict->entry_count, 0.0f);
+        } else {
+            hnsw_search(dict->semantic_index, input_embedding->values, SEARCH_SEMANTIC_EF, semantic);
         }
-        
-        // Calculate combined score
-        float combined_score = calculate_combined_score(embedding_score, phonetic_score, 
-                                                       entry->frequency, config);
-        
-        // Only add candidates with reasonable scores
-        if (combined_score > 0.1f) {
-            NovaKeyCandidate* candidate = &candidates->candidates[candidates->candidate_count];
-            candidate->text = strdup(entry->kanji);
-            candidate->reading = strdup(entry->hiragana);
-            candidate->embedding_score = embedding_score;
-            candidate->phonetic_score = phonetic_score;
-            candidate->combined_score = combined_score;
-            
-            candidates->candidate_count++;
+        for (int i = 0; i < semantic->count; i++) {
+            collect_entry(&context, semantic->items[i].id);
+            semantic_ids[i] = semantic->items[i].id;
         }
+        context.semantic_count = semantic->count;
+        context.semantic_ids = semantic_ids;
+        qsort(semantic_ids, context.semantic_count, sizeof(int), compare_ids);
+        topk_destroy(semantic);
     }
     
-    // Sort candidates by combined score
-    sort_candidates_by_score(candidates);
+    // Candidate generation through the reading trie: completions of the input,
+    // then shorter readings the input starts with. Against empty input no
+    // reading scores on sound, so the whole trie is not enumerated for it.
+    size_t query_length = strlen(context.query);
+    int matched = 0;
+    if (query_length > 0) {
+        matched = trie_predictive_search(index, context.query, visit_trie_candidate, &context);
+        matched += trie_common_prefix_search(index, context.query, query_length - 1,
+                                             visit_trie_candidate, &context);
+    }
+    
+    // Nothing shares a prefix with the input (typos): look up the readings
+    // within a few edits of it. Entries close to the query embedding came in
+    // as semantic candidates, so this only looks for ones that win on sound.
+    if (matched == 0) {
+        float threshold = topk_threshold(selector);
+        if (threshold < SEARCH_MIN_COMBINED_SCORE) {
+            threshold = SEARCH_MIN_COMBINED_SCORE;
+        }
+        int max_distance = search_typo_distance(dict, config, context.query_pattern.length,
+                                                0.0f, threshold);
+        trie_fuzzy_search(index, context.query, max_distance, visit_trie_candidate, &context);
+    }
+    
+    // Materialize only the winners, best first
+    int selected = topk_finish(selector);
+    for (int i = 0; i < selected; i++) {
+        int entry_id = selector->items[i].id;
+        NovaKeyCandidate* candidate = &candidates->candidates[i];
+        
+        // Winners are reported with exact embedding scores
+        if (context.approximate_scores) {
+            embedding_scores[entry_id] = exact_embedding_score(&context, entry_id);
+        }
+        candidate->combined_score = score_entry(&context, entry_id, &candidate->embedding_score,
+                                                &candidate->phonetic_score);
+        candidate->text = strdup(dictionary_field(dict, entry_id, DictionaryFieldKanji));
+        candidate->reading = strdup(dictionary_field(dict, entry_id, DictionaryFieldHiragana));
+    }
+    candidates->candidate_count = selected;
+    if (context.approximate_scores) {
+        sort_candidates_by_score(candidates);
+    }
+    topk_destroy(selector);
+    free(embedding_scores);
     
     if (input_embedding) {
         free_embedding_vector(input_embedding);
     }
+    edit_pattern_free(&context.query_pattern);
+    free(romaji_query);
     
     printf("Found %d candidates for input: %s\n", candidates->candidate_count, input_text);
     return candidates;
@@ -219,51 +662,36 @@ float calculate_phonetic_similarity(const char* input_reading, const char* candi
 }
 
 float calculate_edit_distance_score(const char* a, const char* b) {
-    int len_a = strlen(a);
-    int len_b = strlen(b);
-    
-    if (len_a == 0) return len_b == 0 ? 1.0f : 0.0f;
-    if (len_b == 0) return 0.0f;
-    
-    // Simple implementation - can be optimized with dynamic programming
-    int max_len = (len_a > len_b) ? len_a : len_b;
-    int common = 0;
-    
-    // Count common characters (simplified)
-    for (int i = 0; i < len_a && i < len_b; i++) {
-        if (a[i] == b[i]) {
-            common++;
-        }
+    EditPattern pattern;
+    if (!a || !b || edit_pattern_init(&pattern, a) != 0) {
+        return 0.0f;
     }
     
-    return (float)common / (float)max_len;
+    float score = reading_similarity(&pattern, b);
+    edit_pattern_free(&pattern);
+    return score;
 }
 
 float calculate_combined_score(float embedding_score, float phonetic_score,
                               float frequency_score, const SearchConfig* config) {
     float weighted_embedding = embedding_score * config->embedding_weight;
     float weighted_phonetic = phonetic_score * config->phonetic_weight;
-    float frequency_factor = 1.0f + (frequency_score * 0.1f); // Small frequency boost
+    float frequency_factor = 1.0f + (frequency_score * SEARCH_FREQUENCY_BOOST); // Small frequency boost
     
     return (weighted_embedding + weighted_phonetic) * frequency_factor;
 }
 
+static int compare_candidates(const void* a, const void* b) {
+    float score_a = ((const NovaKeyCandidate*)a)->combined_score;
+    float score_b = ((const NovaKeyCandidate*)b)->combined_score;
+    return (score_a < score_b) - (score_a > score_b);
+}
+
 void sort_candidates_by_score(CandidateList* candidates) {
     if (!candidates || candidates->candidate_count <= 1) {
         return;
     }
     
-    // Simple bubble sort - can be optimized
-    for (int i = 0; i < candidates->candidate_count - 1; i++) {
-        for (int j = 0; j < candidates->candidate_count - 1 - i; j++) {
-            if (candidates->candidates[j].combined_score < 
-                candidates->candidates[j + 1].combined_score) {
-                
-                // Swap candidates
-                NovaKeyCandidate temp = candidates->candidates[j];
-                candidates->candidates[j] = candidates->candidates[j + 1];
-                candidates->candidates[j + 1] = temp;
-            }
-        }
-    }
+    qsort(candidates->candidates, candidates->candidate_count,
+          sizeof(NovaKeyCandidate), compare_candidates);
 }
\ No newline at end of file
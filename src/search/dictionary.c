@@ -0,0 +1,568 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../../include/search.h"
+
+// Compiled dictionary image layout (native byte order):
+//   DictionaryHeader, then 64-byte aligned sections located by the section table.
+#define DICTIONARY_MAGIC "NKDC"
+#define DICTIONARY_VERSION 4
+#define DICTIONARY_MAX_SECTIONS 8
+#define DICTIONARY_SECTION_ALIGN 64
+
+#define DICTIONARY_TAG(a, b, c, d) \
+    ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+#define DICTIONARY_SECTION_OFFSETS     DICTIONARY_TAG('O', 'F', 'F', 'S')
+#define DICTIONARY_SECTION_FREQUENCIES DICTIONARY_TAG('F', 'R', 'E', 'Q')
+#define DICTIONARY_SECTION_STRINGS     DICTIONARY_TAG('S', 'T', 'R', 'S')
+#define DICTIONARY_SECTION_HIRAGANA_INDEX DICTIONARY_TAG('H', 'I', 'D', 'X')
+#define DICTIONARY_SECTION_ROMAJI_INDEX   DICTIONARY_TAG('R', 'I', 'D', 'X')
+
+typedef struct {
+    uint32_t tag;
+    uint32_t reserved;
+    uint64_t offset;
+    uint64_t size;
+} DictionarySection;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t section_count;
+    uint64_t fingerprint;
+    float max_frequency;
+    uint32_t checksum;              // FNV-1a of the header with this field zeroed
+    DictionarySection sections[DICTIONARY_MAX_SECTIONS];
+} DictionaryHeader;
+
+// Growable buffers used while reading the text format
+typedef struct {
+    char* pool;
+    size_t pool_size;
+    size_t pool_capacity;
+    uint32_t* offsets;
+    float* frequencies;
+    int entry_count;
+    int entry_capacity;
+    uint64_t fingerprint;
+    float max_frequency;
+} DictionaryBuilder;
+
+static void builder_init(DictionaryBuilder* builder) {
+    memset(builder, 0, sizeof(DictionaryBuilder));
+    builder->fingerprint = 1469598103934665603ULL;
+}
+
+static void builder_free(DictionaryBuilder* builder) {
+    free(builder->pool);
+    free(builder->offsets);
+    free(builder->frequencies);
+}
+
+static int builder_append_string(DictionaryBuilder* builder, const char* text, uint32_t* offset) {
+    size_t length = strlen(text) + 1;
+    
+    if (builder->pool_size + length > builder->pool_capacity) {
+        size_t capacity = builder->pool_capacity ? builder->pool_capacity * 2 : 4096;
+        while (capacity < builder->pool_size + length) {
+            capacity *= 2;
+        }
+        char* pool = realloc(builder->pool, capacity);
+        if (!pool) return -1;
+        builder->pool = pool;
+        builder->pool_capacity = capacity;
+    }
+    
+    if (builder->pool_size + length > UINT32_MAX) {
+        return -1;
+    }
+    
+    *offset = (uint32_t)builder->pool_size;
+    memcpy(builder->pool + builder->pool_size, text, length);
+    builder->pool_size += length;
+    return 0;
+}
+
+static int builder_add_entry(DictionaryBuilder* builder, const char* const* fields, float frequency) {
+    if (builder->entry_count >= builder->entry_capacity) {
+        int capacity = builder->entry_capacity ? builder->entry_capacity * 2 : 1024;
+        uint32_t* offsets = realloc(builder->offsets,
+                                    sizeof(uint32_t) * DICTIONARY_FIELD_COUNT * capacity);
+        if (!offsets) return -1;
+        builder->offsets = offsets;
+        
+        float* frequencies = realloc(builder->frequencies, sizeof(float) * capacity);
+        if (!frequencies) return -1;
+        builder->frequencies = frequencies;
+        builder->entry_capacity = capacity;
+    }
+    
+    uint32_t* entry_offsets = &builder->offsets[builder->entry_count * DICTIONARY_FIELD_COUNT];
+    for (int f = 0; f < DICTIONARY_FIELD_COUNT; f++) {
+        // Readings often repeat the previous field (kana-only words), share them
+        if (f > 0 && strcmp(fields[f], fields[f - 1]) == 0) {
+            entry_offsets[f] = entry_offsets[f - 1];
+        } else if (builder_append_string(builder, fields[f], &entry_offsets[f]) != 0) {
+            return -1;
+        }
+    }
+    builder->frequencies[builder->entry_count] = frequency;
+    if (builder->entry_count == 0 || frequency > builder->max_frequency) {
+        builder->max_frequency = frequency;
+    }
+    builder->entry_count++;
+    
+    // FNV-1a over the fields that determine the embedded text and entry order
+    const char* hashed[] = { fields[DictionaryFieldKanji], fields[DictionaryFieldHiragana] };
+    for (int f = 0; f < 2; f++) {
+        for (const unsigned char* p = (const unsigned char*)hashed[f]; *p; p++) {
+            builder->fingerprint = (builder->fingerprint ^ *p) * 1099511628211ULL;
+        }
+        builder->fingerprint = (builder->fingerprint ^ 0xFF) * 1099511628211ULL;
+    }
+    
+    return 0;
+}
+
+static int builder_read_text(DictionaryBuilder* builder, FILE* file) {
+    char* line = NULL;
+    size_t line_capacity = 0;
+    ssize_t length;
+    
+    while ((length = getline(&line, &line_capacity, file)) != -1) {
+        // Remove newline
+        line[strcspn(line, "\r\n")] = '\0';
+        
+        // Parse line format: "kanji,hiragana,katakana,romaji,frequency"
+        char* fields[DICTIONARY_FIELD_COUNT + 1];
+        int field_count = 0;
+        char* cursor = line;
+        while (field_count < DICTIONARY_FIELD_COUNT + 1) {
+            fields[field_count++] = cursor;
+            char* comma = strchr(cursor, ',');
+            if (!comma) break;
+            *comma = '\0';
+            cursor = comma + 1;
+        }
+        
+        if (field_count != DICTIONARY_FIELD_COUNT + 1) {
+            continue;
+        }
+        
+        int valid = 1;
+        for (int f = 0; f < DICTIONARY_FIELD_COUNT + 1; f++) {
+            if (fields[f][0] == '\0' && f != DictionaryFieldRomaji) valid = 0;
+        }
+        if (!valid) {
+            continue;
+        }
+        
+        // Romaji may be left empty in the source and is derived at load time
+        char* derived_romaji = NULL;
+        if (fields[DictionaryFieldRomaji][0] == '\0') {
+            derived_romaji = romanize_hiragana(fields[DictionaryFieldHiragana]);
+            if (!derived_romaji) {
+                free(line);
+                return -1;
+            }
+            fields[DictionaryFieldRomaji] = derived_romaji;
+        }
+        
+        int added = builder_add_entry(builder, (const char* const*)fields,
+                                      (float)atof(fields[DICTIONARY_FIELD_COUNT]));
+        free(derived_romaji);
+        if (added != 0) {
+            free(line);
+            return -1;
+        }
+    }
+    
+    free(line);
+    return 0;
+}
+
+static uint32_t header_checksum(const DictionaryHeader* header) {
+    DictionaryHeader copy = *header;
+    copy.checksum = 0;
+    
+    uint32_t hash = 2166136261u;
+    const unsigned char* bytes = (const unsigned char*)&copy;
+    for (size_t i = 0; i < sizeof(copy); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static size_t align_section(size_t offset) {
+    return (offset + DICTIONARY_SECTION_ALIGN - 1) & ~(size_t)(DICTIONARY_SECTION_ALIGN - 1);
+}
+
+// Build the serialized reading trie over one string field of every entry
+static void* builder_build_index(const DictionaryBuilder* builder, DictionaryField field,
+                                 size_t* index_size) {
+    const char** keys = malloc(sizeof(char*) * (builder->entry_count + 1));
+    if (!keys) {
+        return NULL;
+    }
+    
+    for (int i = 0; i < builder->entry_count; i++) {
+        keys[i] = builder->pool + builder->offsets[i * DICTIONARY_FIELD_COUNT + field];
+    }
+    
+    void* index = trie_build_image(keys, builder->entry_count, index_size);
+    free(keys);
+    return index;
+}
+
+// Lay out the builder contents as a compiled image in one heap buffer
+static void* builder_assemble(const DictionaryBuilder* builder, size_t* image_size) {
+    size_t hiragana_index_size = 0;
+    void* hiragana_index = builder_build_index(builder, DictionaryFieldHiragana,
+                                               &hiragana_index_size);
+    size_t romaji_index_size = 0;
+    void* romaji_index = builder_build_index(builder, DictionaryFieldRomaji, &romaji_index_size);
+    if (!hiragana_index || !romaji_index) {
+        free(hiragana_index);
+        free(romaji_index);
+        return NULL;
+    }
+    
+    struct {
+        uint32_t tag;
+        const void* data;
+        size_t size;
+    } parts[] = {
+        { DICTIONARY_SECTION_OFFSETS, builder->offsets,
+          sizeof(uint32_t) * DICTIONARY_FIELD_COUNT * builder->entry_count },
+        { DICTIONARY_SECTION_FREQUENCIES, builder->frequencies,
+          sizeof(float) * builder->entry_count },
+        { DICTIONARY_SECTION_STRINGS, builder->pool, builder->pool_size },
+        { DICTIONARY_SECTION_HIRAGANA_INDEX, hiragana_index, hiragana_index_size },
+        { DICTIONARY_SECTION_ROMAJI_INDEX, romaji_index, romaji_index_size },
+    };
+    int part_count = sizeof(parts) / sizeof(parts[0]);
+    
+    DictionaryHeader header = {0};
+    memcpy(header.magic, DICTIONARY_MAGIC, 4);
+    header.version = DICTIONARY_VERSION;
+    header.entry_count = (uint32_t)builder->entry_count;
+    header.section_count = (uint32_t)part_count;
+    header.fingerprint = builder->fingerprint;
+    header.max_frequency = builder->max_frequency;
+    
+    size_t offset = align_section(sizeof(DictionaryHeader));
+    for (int i = 0; i < part_count; i++) {
+        header.sections[i].tag = parts[i].tag;
+        header.sections[i].offset = offset;
+        header.sections[i].size = parts[i].size;
+        offset = align_section(offset + parts[i].size);
+    }
+    header.checksum = header_checksum(&header);
+    
+    char* image = calloc(1, offset);
+    if (image) {
+        memcpy(image, &header, sizeof(header));
+        for (int i = 0; i < part_count; i++) {
+            if (parts[i].size > 0) {
+                memcpy(image + header.sections[i].offset, parts[i].data, parts[i].size);
+            }
+        }
+        *image_size = offset;
+    }
+    
+    free(hiragana_index);
+    free(romaji_index);
+    return image;
+}
+
+static const DictionarySection* find_section(const DictionaryHeader* header, uint32_t tag) {
+    for (uint32_t i = 0; i < header->section_count; i++) {
+        if (header->sections[i].tag == tag) {
+            return &header->sections[i];
+        }
+    }
+    return NULL;
+}
+
+// Wrap a compiled image without copying; takes ownership of the image.
+// Opening reads the header and section table only, so it takes the same
+// time for any dictionary size; the sections are bounds-checked as lookups
+// read them (dictionary_field(), the reading tries).
+static Dictionary* dictionary_from_image(const void* image, size_t image_size, int mapped) {
+    const DictionaryHeader* header = image;
+    
+    if (image_size < sizeof(DictionaryHeader) ||
+        memcmp(header->magic, DICTIONARY_MAGIC, 4) != 0 ||
+        header->version != DICTIONARY_VERSION ||
+        header->checksum != header_checksum(header) ||
+        header->section_count > DICTIONARY_MAX_SECTIONS ||
+        header->entry_count > INT32_MAX) {
+        return NULL;
+    }
+    
+    for (uint32_t i = 0; i < header->section_count; i++) {
+        const DictionarySection* section = &header->sections[i];
+        if (section->offset > image_size || section->size > image_size - section->offset) {
+            return NULL;
+        }
+    }
+    
+    const DictionarySection* offsets = find_section(header, DICTIONARY_SECTION_OFFSETS);
+    const DictionarySection* frequencies = find_section(header, DICTIONARY_SECTION_FREQUENCIES);
+    const DictionarySection* strings = find_section(header, DICTIONARY_SECTION_STRINGS);
+    const DictionarySection* hiragana_index = find_section(header, DICTIONARY_SECTION_HIRAGANA_INDEX);
+    const DictionarySection* romaji_index = find_section(header, DICTIONARY_SECTION_ROMAJI_INDEX);
+    if (!offsets || !frequencies || !strings || !hiragana_index || !romaji_index ||
+        offsets->size != sizeof(uint32_t) * DICTIONARY_FIELD_COUNT * header->entry_count ||
+        frequencies->size != sizeof(float) * header->entry_count ||
+        offsets->offset % sizeof(uint32_t) != 0 || frequencies->offset % sizeof(float) != 0) {
+        return NULL;
+    }
+    
+    // With the pool ending in NUL, any offset dictionary_field() accepts
+    // starts a string that ends inside the image
+    const char* base = image;
+    const char* pool = base + strings->offset;
+    if (header->entry_count > 0 && (strings->size == 0 || pool[strings->size - 1] != '\0')) {
+        return NULL;
+    }
+    const uint32_t* string_offsets = (const uint32_t*)(base + offsets->offset);
+    
+    DoubleArrayTrie hiragana_trie;
+    DoubleArrayTrie romaji_trie;
+    if (trie_open(&hiragana_trie, base + hiragana_index->offset, hiragana_index->size) != 0 ||
+        trie_open(&romaji_trie, base + romaji_index->offset, romaji_index->size) != 0 ||
+        trie_entry_count(&hiragana_trie) != (int)header->entry_count ||
+        trie_entry_count(&romaji_trie) != (int)header->entry_count) {
+        return NULL;
+    }
+    
+    Dictionary* dict = malloc(sizeof(Dictionary));
+    if (!dict) {
+        return NULL;
+    }
+    
+    dict->entry_count = (int)header->entry_count;
+    dict->fingerprint = header->fingerprint;
+    dict->string_pool = pool;
+    dict->string_pool_size = strings->size;
+    dict->string_offsets = string_offsets;
+    dict->frequencies = (const float*)(base + frequencies->offset);
+    dict->max_frequency = header->max_frequency;
+    dict->hiragana_index = hiragana_trie;
+    dict->romaji_index = romaji_trie;
+    dict->image = image;
+    dict->image_size = image_size;
+    dict->image_mapped = mapped;
+    dict->embeddings = NULL;
+    dict->semantic_index = NULL;
+    
+    return dict;
+}
+
+static Dictionary* dictionary_from_builder(const DictionaryBuilder* builder) {
+    size_t image_size = 0;
+    void* image = builder_assemble(builder, &image_size);
+    if (!image) {
+        return NULL;
+    }
+    
+    Dictionary* dict = dictionary_from_image(image, image_size, 0);
+    if (!dict) {
+        free(image);
+    }
+    return dict;
+}
+
+Dictionary* load_dictionary(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        printf("Warning: Could not load dictionary from %s, using basic fallback\n", path);
+        return create_fallback_dictionary();
+    }
+    
+    // Compiled dictionaries are mapped directly instead of parsed
+    char magic[4];
+    if (fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+        memcmp(magic, DICTIONARY_MAGIC, sizeof(magic)) == 0) {
+        fclose(file);
+        return load_compiled_dictionary(path);
+    }
+    rewind(file);
+    
+    DictionaryBuilder builder;
+    builder_init(&builder);
+    
+    Dictionary* dict = NULL;
+    if (builder_read_text(&builder, file) == 0) {
+        dict = dictionary_from_builder(&builder);
+    }
+    
+    builder_free(&builder);
+    fclose(file);
+    
+    if (dict) {
+        printf("Loaded dictionary with %d entries\n", dict->entry_count);
+    }
+    return dict;
+}
+
+Dictionary* load_compiled_dictionary(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        printf("Warning: Could not open compiled dictionary %s\n", path);
+        return NULL;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(DictionaryHeader)) {
+        close(fd);
+        return NULL;
+    }
+    
+    // Shared read-only mapping: pages come from the page cache and are
+    // shared by every process that opens the same dictionary
+    size_t image_size = (size_t)st.st_size;
+    void* image = mmap(NULL, image_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) {
+        printf("Warning: Could not map compiled dictionary %s\n", path);
+        return NULL;
+    }
+    
+    Dictionary* dict = dictionary_from_image(image, image_size, 1);
+    if (!dict) {
+        printf("Warning: Invalid compiled dictionary %s\n", path);
+        munmap(image, image_size);
+        return NULL;
+    }
+    
+    printf("Mapped compiled dictionary with %d entries\n", dict->entry_count);
+    return dict;
+}
+
+Dictionary* create_fallback_dictionary(void) {
+    // Basic fallback entries
+    const char* fallback_data[][5] = {
+        {"こんにちは", "こんにちは", "コンニチハ", "konnichiwa", "1.0"},
+        {"ありがとう", "ありがとう", "アリガトウ", "arigatou", "0.9"},
+        {"さようなら", "さようなら", "サヨウナラ", "sayounara", "0.8"},
+        {"おはよう", "おはよう", "オハヨウ", "ohayou", "0.85"},
+        {"こんばんは", "こんばんは", "コンバンハ", "konbanwa", "0.75"}
+    };
+    int fallback_count = sizeof(fallback_data) / sizeof(fallback_data[0]);
+    
+    DictionaryBuilder builder;
+    builder_init(&builder);
+    
+    for (int i = 0; i < fallback_count; i++) {
+        if (builder_add_entry(&builder, fallback_data[i], atof(fallback_data[i][4])) != 0) {
+            builder_free(&builder);
+            return NULL;
+        }
+    }
+    
+    Dictionary* dict = dictionary_from_builder(&builder);
+    builder_free(&builder);
+    
+    if (dict) {
+        printf("Created fallback dictionary with %d entries\n", dict->entry_count);
+    }
+    return dict;
+}
+
+void free_dictionary(Dictionary* dict) {
+    if (!dict) return;
+    
+    if (dict->image_mapped) {
+        munmap((void*)dict->image, dict->image_size);
+    } else {
+        free((void*)dict->image);
+    }
+    
+    hnsw_destroy(dict->semantic_index);
+    embedding_store_destroy(dict->embeddings);
+    free(dict);
+}
+
+uint64_t dictionary_fingerprint(const Dictionary* dict) {
+    return dict ? dict->fingerprint : 0;
+}
+
+int compile_dictionary(const char* text_path, const char* output_path) {
+    FILE* input = fopen(text_path, "r");
+    if (!input) {
+        fprintf(stderr, "Could not open dictionary source %s\n", text_path);
+        return -1;
+    }
+    
+    DictionaryBuilder builder;
+    builder_init(&builder);
+    
+    size_t image_size = 0;
+    void* image = NULL;
+    if (builder_read_text(&builder, input) == 0) {
+        image = builder_assemble(&builder, &image_size);
+    }
+    int entry_count = builder.entry_count;
+    builder_free(&builder);
+    fclose(input);
+    
+    if (!image) {
+        fprintf(stderr, "Failed to compile dictionary %s\n", text_path);
+        return -1;
+    }
+    
+    // Write to a temporary file and rename, so processes that still have the
+    // old dictionary mapped keep a consistent image
+    char temp_path[4096];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", output_path);
+    
+    FILE* output = fopen(temp_path, "wb");
+    int ok = output && fwrite(image, 1, image_size, output) == image_size;
+    if (output && fclose(output) != 0) {
+        ok = 0;
+    }
+    free(image);
+    
+    if (!ok || rename(temp_path, output_path) != 0) {
+        fprintf(stderr, "Failed to write compiled dictionary %s\n", output_path);
+        remove(temp_path);
+        return -1;
+    }
+    
+    printf("Compiled %d entries from %s into %s (%zu bytes)\n",
+           entry_count, text_path, output_path, image_size);
+    return 0;
+}
+
+const char* dictionary_field(const Dictionary* dict, int index, DictionaryField field) {
+    if (!dict || index < 0 || index >= dict->entry_count) {
+        return NULL;
+    }
+    
+    uint32_t offset = dict->string_offsets[(size_t)index * DICTIONARY_FIELD_COUNT + field];
+    if (offset >= dict->string_pool_size) {
+        return "";
+    }
+    return dict->string_pool + offset;
+}
+
+DictionaryEntry dictionary_get_entry(const Dictionary* dict, int index) {
+    DictionaryEntry entry = {0};
+    if (!dict || index < 0 || index >= dict->entry_count) {
+        return entry;
+    }
+    
+    entry.kanji = dictionary_field(dict, index, DictionaryFieldKanji);
+    entry.hiragana = dictionary_field(dict, index, DictionaryFieldHiragana);
+    entry.katakana = dictionary_field(dict, index, DictionaryFieldKatakana);
+    entry.romaji = dictionary_field(dict, index, DictionaryFieldRomaji);
+    entry.frequency = dict->frequencies[index];
+    return entry;
+}
@@ -0,0 +1,648 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/trie.h"
+#include "../../include/utf8.h"
+
+// Code 0 marks the end of a key, byte b is stored as code b + 1, so a key
+// that is a prefix of another sorts (and is enumerated) first
+#define TRIE_TERMINAL_CODE 0
+#define TRIE_CODE_COUNT 257
+
+// Serialized image header, followed by base[], check[], key_starts[], entry_ids[]
+typedef struct {
+    uint32_t node_count;
+    uint32_t key_count;
+    uint32_t entry_count;
+    uint32_t max_key_length;    // In bytes, bounding the depth of any walk
+} TrieImageHeader;
+
+typedef struct {
+    const char* key;
+    int entry_id;
+} TrieKey;
+
+typedef struct {
+    int32_t* base;
+    int32_t* check;
+    int capacity;
+    int node_count;
+    int first_free;
+    const char** keys;    // Distinct keys in byte order
+    int max_key_length;
+} TrieBuilder;
+
+static int compare_trie_keys(const void* a, const void* b) {
+    const TrieKey* ka = a;
+    const TrieKey* kb = b;
+    int cmp = strcmp(ka->key, kb->key);
+    if (cmp != 0) return cmp;
+    return (ka->entry_id > kb->entry_id) - (ka->entry_id < kb->entry_id);
+}
+
+static int builder_reserve(TrieBuilder* builder, int size) {
+    if (size <= builder->capacity) {
+        return 0;
+    }
+    
+    int capacity = builder->capacity ? builder->capacity : 1024;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+    
+    int32_t* base = realloc(builder->base, sizeof(int32_t) * capacity);
+    if (!base) return -1;
+    builder->base = base;
+    
+    int32_t* check = realloc(builder->check, sizeof(int32_t) * capacity);
+    if (!check) return -1;
+    builder->check = check;
+    
+    for (int i = builder->capacity; i < capacity; i++) {
+        builder->base[i] = 0;
+        builder->check[i] = -1;
+    }
+    builder->capacity = capacity;
+    return 0;
+}
+
+static int key_code(const char* key, int depth) {
+    unsigned char byte = (unsigned char)key[depth];
+    return byte ? byte + 1 : TRIE_TERMINAL_CODE;
+}
+
+// Insert the children of node for keys[lo, hi), which share their first depth bytes
+static int builder_insert(TrieBuilder* builder, int node, int lo, int hi, int depth) {
+    int codes[TRIE_CODE_COUNT];
+    int starts[TRIE_CODE_COUNT + 1];
+    int code_count = 0;
+    
+    for (int i = lo; i < hi; i++) {
+        int code = key_code(builder->keys[i], depth);
+        if (code_count == 0 || codes[code_count - 1] != code) {
+            codes[code_count] = code;
+            starts[code_count] = i;
+            code_count++;
+        }
+    }
+    starts[code_count] = hi;
+    
+    // Find a base where every child slot is free
+    while (builder->first_free < builder->capacity && builder->check[builder->first_free] != -1) {
+        builder->first_free++;
+    }
+    int base = builder->first_free - codes[0];
+    if (base < 1) base = 1;
+    
+    for (;; base++) {
+        if (builder_reserve(builder, base + codes[code_count - 1] + 1) != 0) {
+            return -1;
+        }
+        
+        int free_slots = 1;
+        for (int c = 0; c < code_count; c++) {
+            if (builder->check[base + codes[c]] != -1) {
+                free_slots = 0;
+                break;
+            }
+        }
+        if (free_slots) break;
+    }
+    
+    builder->base[node] = base;
+    for (int c = 0; c < code_count; c++) {
+        int child = base + codes[c];
+        builder->check[child] = node;
+        if (child + 1 > builder->node_count) {
+            builder->node_count = child + 1;
+        }
+    }
+    
+    for (int c = 0; c < code_count; c++) {
+        int child = base + codes[c];
+        if (codes[c] == TRIE_TERMINAL_CODE) {
+            // Distinct keys, so exactly one key ends here
+            builder->base[child] = -(starts[c] + 1);
+        } else if (builder_insert(builder, child, starts[c], starts[c + 1], depth + 1) != 0) {
+            return -1;
+        }
+    }
+    
+    return 0;
+}
+
+void* trie_build_image(const char* const* keys, int count, size_t* image_size) {
+    if (!keys || count < 0 || !image_size) {
+        return NULL;
+    }
+    
+    TrieKey* sorted = malloc(sizeof(TrieKey) * (count + 1));
+    const char** distinct = malloc(sizeof(char*) * (count + 1));
+    uint32_t* key_starts = malloc(sizeof(uint32_t) * (count + 1));
+    if (!sorted || !distinct || !key_starts) {
+        free(sorted);
+        free(distinct);
+        free(key_starts);
+        return NULL;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        sorted[i].key = keys[i] ? keys[i] : "";
+        sorted[i].entry_id = i;
+    }
+    qsort(sorted, count, sizeof(TrieKey), compare_trie_keys);
+    
+    int key_count = 0;
+    int max_key_length = 0;
+    for (int i = 0; i < count; i++) {
+        if (key_count == 0 || strcmp(distinct[key_count - 1], sorted[i].key) != 0) {
+            distinct[key_count] = sorted[i].key;
+            key_starts[key_count] = (uint32_t)i;
+            key_count++;
+            int length = (int)strlen(sorted[i].key);
+            if (length > max_key_length) max_key_length = length;
+        }
+    }
+    key_starts[key_count] = (uint32_t)count;
+    
+    TrieBuilder builder = {0};
+    builder.keys = distinct;
+    builder.max_key_length = max_key_length;
+    builder.first_free = 1;
+    builder.node_count = 1;
+    
+    int ok = builder_reserve(&builder, TRIE_CODE_COUNT + 1) == 0;
+    if (ok) {
+        builder.check[TRIE_ROOT] = TRIE_ROOT;
+        if (key_count > 0) {
+            ok = builder_insert(&builder, TRIE_ROOT, 0, key_count, 0) == 0;
+        }
+    }
+    
+    char* image = NULL;
+    size_t size = sizeof(TrieImageHeader) +
+                  sizeof(int32_t) * 2 * builder.node_count +
+                  sizeof(uint32_t) * (key_count + 1) +
+                  sizeof(uint32_t) * count;
+    if (ok) {
+        image = malloc(size);
+    }
+    
+    if (image) {
+        TrieImageHeader header = {
+            .node_count = (uint32_t)builder.node_count,
+            .key_count = (uint32_t)key_count,
+            .entry_count = (uint32_t)count,
+            .max_key_length = (uint32_t)builder.max_key_length
+        };
+        char* cursor = image;
+        memcpy(cursor, &header, sizeof(header));
+        cursor += sizeof(header);
+        memcpy(cursor, builder.base, sizeof(int32_t) * builder.node_count);
+        cursor += sizeof(int32_t) * builder.node_count;
+        memcpy(cursor, builder.check, sizeof(int32_t) * builder.node_count);
+        cursor += sizeof(int32_t) * builder.node_count;
+        memcpy(cursor, key_starts, sizeof(uint32_t) * (key_count + 1));
+        cursor += sizeof(uint32_t) * (key_count + 1);
+        for (int i = 0; i < count; i++) {
+            uint32_t entry_id = (uint32_t)sorted[i].entry_id;
+            memcpy(cursor, &entry_id, sizeof(entry_id));
+            cursor += sizeof(entry_id);
+        }
+        *image_size = size;
+    }
+    
+    free(builder.base);
+    free(builder.check);
+    free(sorted);
+    free(distinct);
+    free(key_starts);
+    return image;
+}
+
+int trie_open(DoubleArrayTrie* trie, const void* image, size_t image_size) {
+    if (!trie || !image || image_size < sizeof(TrieImageHeader)) {
+        return -1;
+    }
+    
+    TrieImageHeader header;
+    memcpy(&header, image, sizeof(header));
+    
+    size_t expected = sizeof(TrieImageHeader) +
+                      sizeof(int32_t) * 2 * (size_t)header.node_count +
+                      sizeof(uint32_t) * ((size_t)header.key_count + 1) +
+                      sizeof(uint32_t) * (size_t)header.entry_count;
+    if (header.node_count == 0 || expected != image_size) {
+        return -1;
+    }
+    
+    if (header.node_count > INT32_MAX - TRIE_CODE_COUNT || header.key_count > INT32_MAX ||
+        header.entry_count > INT32_MAX || header.max_key_length > INT32_MAX - 1 ||
+        ((uintptr_t)image & (sizeof(int32_t) - 1)) != 0) {
+        return -1;
+    }
+    
+    const char* cursor = (const char*)image + sizeof(TrieImageHeader);
+    const int32_t* base = (const int32_t*)cursor;
+    cursor += sizeof(int32_t) * header.node_count;
+    const int32_t* check = (const int32_t*)cursor;
+    cursor += sizeof(int32_t) * header.node_count;
+    const uint32_t* key_starts = (const uint32_t*)cursor;
+    cursor += sizeof(uint32_t) * (header.key_count + 1);
+    const uint32_t* entry_ids = (const uint32_t*)cursor;
+    
+    // Only the layout is checked here, so opening costs the same for any
+    // size. The array contents are checked as lookups read them: child
+    // offsets, key indices, key ranges and entry ids out of range are
+    // treated as absent, and walks stop at the longest key, so a damaged
+    // image gives wrong answers but never reads outside itself or loops
+    if (key_starts[0] != 0 || key_starts[header.key_count] != header.entry_count) {
+        return -1;
+    }
+    
+    trie->node_count = (int)header.node_count;
+    trie->base = base;
+    trie->check = check;
+    trie->key_count = (int)header.key_count;
+    trie->key_starts = key_starts;
+    trie->entry_ids = entry_ids;
+    trie->max_key_length = (int)header.max_key_length;
+    
+    return 0;
+}
+
+// Number of entry ids in the trie, which every lookup returns ids below
+int trie_entry_count(const DoubleArrayTrie* trie) {
+    return trie && trie->key_starts ? (int)trie->key_starts[trie->key_count] : 0;
+}
+
+static int child_for_code(const DoubleArrayTrie* trie, int node, int code) {
+    int32_t base = trie->base[node];
+    if (base <= 0 || base >= trie->node_count - code) {
+        return -1;
+    }
+    
+    int child = base + code;
+    if (trie->check[child] != node) {
+        return -1;
+    }
+    return child;
+}
+
+// Index of the key a terminal slot stands for, or -1
+static int leaf_key(const DoubleArrayTrie* trie, int leaf) {
+    int32_t base = trie->base[leaf];
+    if (base >= 0 || -(int64_t)base - 1 >= trie->key_count) {
+        return -1;
+    }
+    return -base - 1;
+}
+
+int trie_child(const DoubleArrayTrie* trie, int node, unsigned char byte) {
+    if (!trie || node < 0 || node >= trie->node_count) {
+        return -1;
+    }
+    return child_for_code(trie, node, byte + 1);
+}
+
+int trie_walk(const DoubleArrayTrie* trie, int node, const char* text, size_t length) {
+    for (size_t i = 0; i < length && node >= 0; i++) {
+        node = trie_child(trie, node, (unsigned char)text[i]);
+    }
+    return node;
+}
+
+// Index of the key ending exactly at node, or -1
+static int terminal_key(const DoubleArrayTrie* trie, int node) {
+    int leaf = child_for_code(trie, node, TRIE_TERMINAL_CODE);
+    return leaf >= 0 ? leaf_key(trie, leaf) : -1;
+}
+
+// Visit entries of keys[first, last]; returns visited count, negative if stopped
+static int visit_keys(const DoubleArrayTrie* trie, int first, int last,
+                      TrieVisitor visitor, void* user_data) {
+    int visited = 0;
+    uint32_t entry_count = trie->key_starts[trie->key_count];
+    uint32_t end = trie->key_starts[last + 1];
+    if (end > entry_count) {
+        end = entry_count;
+    }
+    
+    for (uint32_t i = trie->key_starts[first]; i < end; i++) {
+        if (trie->entry_ids[i] >= entry_count) {
+            continue;
+        }
+        visited++;
+        if (visitor && visitor((int)trie->entry_ids[i], user_data)) {
+            return -visited;
+        }
+    }
+    return visited;
+}
+
+// Follow the smallest (or largest) child down to a key terminal, at most
+// one step per byte of the longest key plus the terminal
+static int edge_key(const DoubleArrayTrie* trie, int node, int rightmost) {
+    for (int depth = 0; trie->base[node] > 0; depth++) {
+        int next = -1;
+        for (int i = 0; i < TRIE_CODE_COUNT && next < 0; i++) {
+            next = child_for_code(trie, node, rightmost ? TRIE_CODE_COUNT - 1 - i : i);
+        }
+        if (next < 0 || depth > trie->max_key_length) {
+            return -1;
+        }
+        node = next;
+    }
+    return leaf_key(trie, node);
+}
+
+// Visit the entries of the key ending exactly at node, e.g. one reached by
+// trie_walk() or trie_fuzzy_nodes(); returns the number visited
+int trie_node_entries(const DoubleArrayTrie* trie, int node,
+                      TrieVisitor visitor, void* user_data) {
+    if (!trie || node < 0 || node >= trie->node_count) {
+        return 0;
+    }
+    
+    int index = terminal_key(trie, node);
+    if (index < 0) {
+        return 0;
+    }
+    
+    int visited = visit_keys(trie, index, index, visitor, user_data);
+    return visited < 0 ? -visited : visited;
+}
+
+int trie_exact_match(const DoubleArrayTrie* trie, const char* key,
+                     TrieVisitor visitor, void* user_data) {
+    if (!trie || !key) {
+        return 0;
+    }
+    
+    int node = trie_walk(trie, TRIE_ROOT, key, strlen(key));
+    return trie_node_entries(trie, node, visitor, user_data);
+}
+
+int trie_common_prefix_search(const DoubleArrayTrie* trie, const char* text, size_t length,
+                              TrieVisitor visitor, void* user_data) {
+    if (!trie || !text) {
+        return 0;
+    }
+    
+    int total = 0;
+    int node = TRIE_ROOT;
+    
+    // Keys that end at or before text[length]
+    for (size_t i = 0; node >= 0; i++) {
+        int index = terminal_key(trie, node);
+        if (index >= 0) {
+            int visited = visit_keys(trie, index, index, visitor, user_data);
+            if (visited < 0) {
+                return total - visited;
+            }
+            total += visited;
+        }
+        
+        if (i == length) break;
+        node = trie_child(trie, node, (unsigned char)text[i]);
+    }
+    
+    return total;
+}
+
+int trie_enumerate_subtree(const DoubleArrayTrie* trie, int node,
+                           TrieVisitor visitor, void* user_data) {
+    if (!trie || node < 0 || node >= trie->node_count) {
+        return 0;
+    }
+    
+    // Keys are numbered in byte order, so a subtree is a contiguous key range
+    int first = edge_key(trie, node, 0);
+    int last = edge_key(trie, node, 1);
+    if (first < 0 || last < first) {
+        return 0;
+    }
+    
+    int visited = visit_keys(trie, first, last, visitor, user_data);
+    return visited < 0 ? -visited : visited;
+}
+
+int trie_predictive_search(const DoubleArrayTrie* trie, const char* prefix,
+                           TrieVisitor visitor, void* user_data) {
+    if (!trie || !prefix) {
+        return 0;
+    }
+    
+    int node = trie_walk(trie, TRIE_ROOT, prefix, strlen(prefix));
+    if (node < 0) {
+        return 0;
+    }
+    return trie_enumerate_subtree(trie, node, visitor, user_data);
+}
+
+// Bytes in the sequence a lead byte starts, as utf8_decode() reads it
+static int sequence_length(unsigned char lead) {
+    if ((lead & 0xE0) == 0xC0) return 2;
+    if ((lead & 0xF0) == 0xE0) return 3;
+    if ((lead & 0xF8) == 0xF0) return 4;
+    return 1;
+}
+
+// Add one byte to the code point being read, with pending bytes of it still
+// to come (0 at a lead byte); sets how many remain after this one
+static uint32_t extend_code_point(uint32_t code_point, int pending, unsigned char byte,
+                                  int* remaining) {
+    if (pending == 0) {
+        *remaining = sequence_length(byte) - 1;
+        return *remaining > 0 ? byte & (0x7F >> (*remaining + 1)) : byte;
+    }
+    
+    *remaining = pending - 1;
+    return (code_point << 6) | (byte & 0x3F);
+}
+
+// Children of node whose paths add the rest of code_point; non-zero once stopped
+static int visit_children(const DoubleArrayTrie* trie, int node, uint32_t code_point, int pending,
+                          TrieChildVisitor visitor, void* user_data, int* visited) {
+    for (int code = TRIE_TERMINAL_CODE + 1; code < TRIE_CODE_COUNT; code++) {
+        int child = child_for_code(trie, node, code);
+        if (child < 0) {
+            continue;
+        }
+        
+        int remaining;
+        uint32_t next = extend_code_point(code_point, pending, (unsigned char)(code - 1), &remaining);
+        if (remaining > 0) {
+            if (visit_children(trie, child, next, remaining, visitor, user_data, visited)) {
+                return 1;
+            }
+            continue;
+        }
+        
+        (*visited)++;
+        if (visitor && visitor(child, next, user_data)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Visit the nodes one code point below node, with the code point leading to
+// each; returns the number visited. Keys ending inside a UTF-8 sequence are
+// skipped.
+int trie_enumerate_children(const DoubleArrayTrie* trie, int node,
+                            TrieChildVisitor visitor, void* user_data) {
+    if (!trie || node < 0 || node >= trie->node_count) {
+        return 0;
+    }
+    
+    int visited = 0;
+    visit_children(trie, node, 0, 0, visitor, user_data, &visited);
+    return visited;
+}
+
+// Levenshtein walk: one dynamic-programming row per code point on the path,
+// row[i] being the distance from the path to the first i query code points
+typedef struct {
+    const DoubleArrayTrie* trie;
+    const uint32_t* query;
+    int query_length;        // In code points
+    int max_distance;
+    int* rows;               // query_length + max_distance + 2 rows
+    TrieNodeVisitor visitor;
+    void* user_data;
+    int visited;
+} FuzzyWalk;
+
+// Walk below node, whose path ends depth code points plus the first bytes
+// of code_point, with pending bytes still to come; non-zero once stopped
+static int fuzzy_walk(FuzzyWalk* walk, int node, int depth, uint32_t code_point, int pending) {
+    const int* row = walk->rows + (size_t)depth * (walk->query_length + 1);
+    
+    if (pending == 0 && row[walk->query_length] <= walk->max_distance) {
+        walk->visited++;
+        if (walk->visitor && walk->visitor(node, depth, row[walk->query_length], walk->user_data)) {
+            return 1;
+        }
+    }
+    
+    for (int code = TRIE_TERMINAL_CODE + 1; code < TRIE_CODE_COUNT; code++) {
+        int child = child_for_code(walk->trie, node, code);
+        if (child < 0) {
+            continue;
+        }
+        
+        int remaining;
+        uint32_t next = extend_code_point(code_point, pending, (unsigned char)(code - 1), &remaining);
+        if (remaining > 0) {
+            if (fuzzy_walk(walk, child, depth, next, remaining)) {
+                return 1;
+            }
+            continue;
+        }
+        
+        // A subtree is dropped once every prefix of the query is too far
+        // from its path: extending the path cannot bring any of them closer
+        int* next_row = walk->rows + (size_t)(depth + 1) * (walk->query_length + 1);
+        next_row[0] = row[0] + 1;
+        int column_min = next_row[0];
+        for (int i = 1; i <= walk->query_length; i++) {
+            int best = row[i - 1] + (walk->query[i - 1] != next);
+            if (row[i] + 1 < best) best = row[i] + 1;
+            if (next_row[i - 1] + 1 < best) best = next_row[i - 1] + 1;
+            next_row[i] = best;
+            if (best < column_min) column_min = best;
+        }
+        
+        if (column_min <= walk->max_distance && fuzzy_walk(walk, child, depth + 1, 0, 0)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Visit every node, at a code point boundary, whose path is within
+// max_distance edits of query, in code points, with its depth and distance;
+// returns the number visited. Only subtrees still within reach are entered,
+// so the cost follows the number of nearby paths rather than the size of
+// the trie.
+int trie_fuzzy_nodes(const DoubleArrayTrie* trie, const char* query, int max_distance,
+                     TrieNodeVisitor visitor, void* user_data) {
+    if (!trie || !query || max_distance < 0) {
+        return 0;
+    }
+    
+    FuzzyWalk walk = {
+        .trie = trie,
+        .max_distance = max_distance,
+        .visitor = visitor,
+        .user_data = user_data,
+        .visited = 0
+    };
+    
+    // A code point takes at least one byte; a path longer than the query
+    // by more than max_distance is out of reach
+    uint32_t* code_points = malloc(sizeof(uint32_t) * (strlen(query) + 1));
+    if (!code_points) {
+        return 0;
+    }
+    while (*query) {
+        query += utf8_decode(query, &code_points[walk.query_length]);
+        walk.query_length++;
+    }
+    walk.query = code_points;
+    walk.rows = malloc(sizeof(int) * (size_t)(walk.query_length + max_distance + 2) *
+                       (walk.query_length + 1));
+    if (!walk.rows) {
+        free(code_points);
+        return 0;
+    }
+    
+    // Against the empty path, the distance to i query code points is i
+    for (int i = 0; i <= walk.query_length; i++) {
+        walk.rows[i] = i;
+    }
+    fuzzy_walk(&walk, TRIE_ROOT, 0, 0, 0);
+    
+    free(walk.rows);
+    free(code_points);
+    return walk.visited;
+}
+
+// Entry visitor of a fuzzy search, called for the keys of the nodes in reach
+typedef struct {
+    const DoubleArrayTrie* trie;
+    TrieVisitor visitor;
+    void* user_data;
+    int visited;
+} FuzzyKeys;
+
+static int visit_fuzzy_keys(int node, int depth, int distance, void* user_data) {
+    FuzzyKeys* keys = user_data;
+    (void)depth;
+    (void)distance;
+    
+    int index = terminal_key(keys->trie, node);
+    if (index < 0) {
+        return 0;
+    }
+    
+    int visited = visit_keys(keys->trie, index, index, keys->visitor, keys->user_data);
+    keys->visited += visited < 0 ? -visited : visited;
+    return visited < 0;
+}
+
+// Visit the entries of every key within max_distance edits of query, in
+// code points. Keys ending inside a UTF-8 sequence are skipped.
+int trie_fuzzy_search(const DoubleArrayTrie* trie, const char* query, int max_distance,
+                      TrieVisitor visitor, void* user_data) {
+    FuzzyKeys keys = {
+        .trie = trie,
+        .visitor = visitor,
+        .user_data = user_data,
+        .visited = 0
+    };
+    
+    trie_fuzzy_nodes(trie, query, max_distance, visit_fuzzy_keys, &keys);
+    return keys.visited;
+}
@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/edit_distance.h"
+#include "../../include/utf8.h"
+
+static int symbol_slot(const EditPattern* pattern, uint32_t symbol) {
+    uint32_t slot = (symbol * 2654435761u) & (EDIT_PATTERN_SLOTS - 1);
+    while (pattern->symbols[slot] != 0 && pattern->symbols[slot] != symbol) {
+        slot = (slot + 1) & (EDIT_PATTERN_SLOTS - 1);
+    }
+    return (int)slot;
+}
+
+static uint64_t symbol_mask(const EditPattern* pattern, uint32_t symbol) {
+    int slot = symbol_slot(pattern, symbol);
+    return pattern->symbols[slot] == symbol ? pattern->masks[slot] : 0;
+}
+
+int edit_pattern_init(EditPattern* pattern, const char* text) {
+    if (!pattern || !text) {
+        return -1;
+    }
+    
+    memset(pattern, 0, sizeof(*pattern));
+    
+    // A code point takes at least one byte
+    pattern->code_points = malloc(sizeof(uint32_t) * (strlen(text) + 1));
+    if (!pattern->code_points) {
+        return -1;
+    }
+    
+    while (*text) {
+        text += utf8_decode(text, &pattern->code_points[pattern->length]);
+        pattern->length++;
+    }
+    
+    if (pattern->length <= EDIT_PATTERN_MAX_BITS) {
+        for (int i = 0; i < pattern->length; i++) {
+            int slot = symbol_slot(pattern, pattern->code_points[i]);
+            pattern->symbols[slot] = pattern->code_points[i];
+            pattern->masks[slot] |= 1ULL << i;
+        }
+    }
+    
+    return 0;
+}
+
+void edit_pattern_free(EditPattern* pattern) {
+    if (!pattern) return;
+    
+    free(pattern->code_points);
+    pattern->code_points = NULL;
+    pattern->length = 0;
+}
+
+// Myers' bit-parallel algorithm in Hyyro's formulation: pv/mv hold the
+// vertical +1/-1 deltas of the current DP column, one bit per pattern
+// symbol, and score follows the bottom row
+static int myers_distance(const EditPattern* pattern, const char* text, int* text_length) {
+    uint64_t last = 1ULL << (pattern->length - 1);
+    uint64_t pv = ~0ULL;
+    uint64_t mv = 0;
+    int score = pattern->length;
+    int length = 0;
+    
+    while (*text) {
+        uint32_t code_point;
+        text += utf8_decode(text, &code_point);
+        length++;
+        
+        uint64_t eq = symbol_mask(pattern, code_point);
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        
+        if (ph & last) {
+            score++;
+        } else if (mh & last) {
+            score--;
+        }
+        
+        // The top row grows by one per column: global, not substring, distance
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+    }
+    
+    *text_length = length;
+    return score;
+}
+
+// Two-row dynamic programming for patterns too long for one machine word
+static int table_distance(const EditPattern* pattern, const char* text, int* text_length) {
+    int* row = malloc(sizeof(int) * (pattern->length + 1));
+    if (!row) {
+        return -1;
+    }
+    
+    for (int i = 0; i <= pattern->length; i++) {
+        row[i] = i;
+    }
+    
+    int length = 0;
+    while (*text) {
+        uint32_t code_point;
+        text += utf8_decode(text, &code_point);
+        length++;
+        
+        int diagonal = row[0];
+        row[0] = length;
+        for (int i = 1; i <= pattern->length; i++) {
+            int above = row[i];
+            int best = diagonal + (pattern->code_points[i - 1] != code_point);
+            if (row[i] + 1 < best) best = row[i] + 1;
+            if (row[i - 1] + 1 < best) best = row[i - 1] + 1;
+            row[i] = best;
+            diagonal = above;
+        }
+    }
+    
+    int distance = row[pattern->length];
+    free(row);
+    *text_length = length;
+    return distance;
+}
+
+// Levenshtein distance in code points between the pattern and text; the
+// code point length of text is stored in text_length if it is not NULL
+int edit_pattern_distance(const EditPattern* pattern, const char* text, int* text_length) {
+    int length = 0;
+    int distance;
+    
+    if (!pattern || !text) {
+        return -1;
+    }
+    
+    if (pattern->length == 0) {
+        length = utf8_length(text);
+        distance = length;
+    } else if (pattern->length <= EDIT_PATTERN_MAX_BITS) {
+        distance = myers_distance(pattern, text, &length);
+    } else {
+        distance = table_distance(pattern, text, &length);
+    }
+    
+    if (text_length) {
+        *text_length = length;
+    }
+    return distance;
+}
+
+// Myers' algorithm with two cutoffs. Along the diagonal that ends in the
+// bottom-right cell the distance never decreases (Ukkonen), and that cell is
+// j plus the vertical deltas above it; the bottom row can fall by at most
+// one per remaining column.
+static int myers_bounded_distance(const EditPattern* pattern, const char* text,
+                                  int text_length, int max_distance) {
+    uint64_t last = 1ULL << (pattern->length - 1);
+    uint64_t pv = ~0ULL;
+    uint64_t mv = 0;
+    int score = pattern->length;
+    int offset = pattern->length - text_length;
+    
+    for (int j = 1; *text; j++) {
+        uint32_t code_point;
+        text += utf8_decode(text, &code_point);
+        
+        uint64_t eq = symbol_mask(pattern, code_point);
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+        
+        if (ph & last) {
+            score++;
+        } else if (mh & last) {
+            score--;
+        }
+        
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+        
+        if (score - (text_length - j) > max_distance) {
+            return max_distance + 1;
+        }
+        
+        int row = j + offset;
+        if (row > 0 && row < pattern->length) {
+            uint64_t above = (1ULL << row) - 1;
+            int diagonal = j + __builtin_popcountll(pv & above) - __builtin_popcountll(mv & above);
+            if (diagonal > max_distance) {
+                return max_distance + 1;
+            }
+        }
+    }
+    
+    return score > max_distance ? max_distance + 1 : score;
+}
+
+// Ukkonen's banded table: only cells within max_distance of the diagonal can
+// lead to a distance within the bound, and everything beyond it is clamped to
+// max_distance + 1, so a column costs O(max_distance)
+static int table_bounded_distance(const EditPattern* pattern, const char* text, int max_distance) {
+    int limit = max_distance + 1;
+    int* row = malloc(sizeof(int) * (pattern->length + 1));
+    if (!row) {
+        return -1;
+    }
+    
+    for (int i = 0; i <= pattern->length; i++) {
+        row[i] = i < limit ? i : limit;
+    }
+    
+    for (int j = 1; *text; j++) {
+        uint32_t code_point;
+        text += utf8_decode(text, &code_point);
+        
+        int low = j - max_distance > 1 ? j - max_distance : 1;
+        int high = j + max_distance < pattern->length ? j + max_distance : pattern->length;
+        
+        // The cell left of the band is either the top row or outside it
+        int diagonal = row[low - 1];
+        row[low - 1] = low == 1 && j < limit ? j : limit;
+        int column_min = row[low - 1];
+        
+        for (int i = low; i <= high; i++) {
+            int above = row[i];
+            int best = diagonal + (pattern->code_points[i - 1] != code_point);
+            if (row[i] + 1 < best) best = row[i] + 1;
+            if (row[i - 1] + 1 < best) best = row[i - 1] + 1;
+            if (best > limit) best = limit;
+            row[i] = best;
+            diagonal = above;
+            if (best < column_min) column_min = best;
+        }
+        
+        if (column_min > max_distance) {
+            free(row);
+            return limit;
+        }
+    }
+    
+    int distance = row[pattern->length];
+    free(row);
+    return distance;
+}
+
+// Levenshtein distance between the pattern and text if it is at most
+// max_distance, else max_distance + 1, giving up as soon as the bound is
+// exceeded. text_length is the length of text in code points (utf8_length).
+int edit_pattern_distance_bounded(const EditPattern* pattern, const char* text,
+                                  int text_length, int max_distance) {
+    if (!pattern || !text || text_length < 0 || max_distance < 0) {
+        return -1;
+    }
+    
+    // Every extra code point on one side costs at least one edit
+    int length_difference = abs(pattern->length - text_length);
+    if (length_difference > max_distance) {
+        return max_distance + 1;
+    }
+    
+    if (pattern->length == 0) {
+        return text_length;
+    } else if (pattern->length <= EDIT_PATTERN_MAX_BITS) {
+        return myers_bounded_distance(pattern, text, text_length, max_distance);
+    }
+    return table_bounded_distance(pattern, text, max_distance);
+}
+
+int edit_distance(const char* a, const char* b) {
+    EditPattern pattern;
+    if (edit_pattern_init(&pattern, a) != 0) {
+        return -1;
+    }
+    
+    int distance = edit_pattern_distance(&pattern, b, NULL);
+    edit_pattern_free(&pattern);
+    return distance;
+}
@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../include/search.h"
+#include "../../include/utf8.h"
+
+// Hepburn romanization for one hiragana code point (U+3041..U+3096)
+static const char* const kana_romaji[] = {
+    "a", "a", "i", "i", "u", "u", "e", "e", "o", "o",             // ぁあぃいぅうぇえぉお
+    "ka", "ga", "ki", "gi", "ku", "gu", "ke", "ge", "ko", "go",   // かがきぎくぐけげこご
+    "sa", "za", "shi", "ji", "su", "zu", "se", "ze", "so", "zo", // さざしじすずせぜそぞ
+    "ta", "da", "chi", "ji", "", "tsu", "zu", "te", "de", "to", "do", // ただちぢっつづてでとど
+    "na", "ni", "nu", "ne", "no",                                // なにぬねの
+    "ha", "ba", "pa", "hi", "bi", "pi", "fu", "bu", "pu",       // はばぱひびぴふぶぷ
+    "he", "be", "pe", "ho", "bo", "po",                          // へべぺほぼぽ
+    "ma", "mi", "mu", "me", "mo",                                // まみむめも
+    "ya", "ya", "yu", "yu", "yo", "yo",                          // ゃやゅゆょよ
+    "ra", "ri", "ru", "re", "ro",                                // らりるれろ
+    "wa", "wa", "wi", "we", "wo", "n",                           // ゎわゐゑをん
+    "vu", "ka", "ke"                                             // ゔゕゖ
+};
+
+#define HIRAGANA_FIRST 0x3041
+#define HIRAGANA_LAST 0x3096
+#define HIRAGANA_SMALL_TSU 0x3063
+
+static int is_small_y(uint32_t code_point) {
+    return code_point == 0x3083 || code_point == 0x3085 || code_point == 0x3087;
+}
+
+char* romanize_hiragana(const char* hiragana) {
+    if (!hiragana) {
+        return NULL;
+    }
+    
+    // Each kana is 3 bytes of UTF-8 and at most 3 letters of romaji
+    size_t capacity = strlen(hiragana) * 2 + 1;
+    char* romaji = malloc(capacity);
+    if (!romaji) {
+        return NULL;
+    }
+    
+    const char* s = hiragana;
+    size_t length = 0;
+    int double_next = 0;
+    
+    while (*s) {
+        uint32_t code_point;
+        s += utf8_decode(s, &code_point);
+        
+        if (code_point < HIRAGANA_FIRST || code_point > HIRAGANA_LAST) {
+            // Pass ASCII through, drop anything else
+            if (code_point < 0x80) {
+                romaji[length++] = (char)code_point;
+            }
+            double_next = 0;
+            continue;
+        }
+        
+        if (code_point == HIRAGANA_SMALL_TSU) {
+            double_next = 1;
+            continue;
+        }
+        
+        const char* syllable = kana_romaji[code_point - HIRAGANA_FIRST];
+        
+        // Contracted sounds: きゃ -> kya, しゃ -> sha, ちゃ -> cha, じゃ -> ja
+        uint32_t next = 0;
+        int next_bytes = *s ? utf8_decode(s, &next) : 0;
+        char contracted[8];
+        if (is_small_y(next) && strlen(syllable) >= 2 && syllable[strlen(syllable) - 1] == 'i') {
+            const char* glide = kana_romaji[next - HIRAGANA_FIRST];
+            size_t stem = strlen(syllable) - 1;
+            if (strcmp(syllable, "shi") == 0 || strcmp(syllable, "chi") == 0 ||
+                strcmp(syllable, "ji") == 0) {
+                snprintf(contracted, sizeof(contracted), "%.*s%s", (int)stem, syllable, glide + 1);
+            } else {
+                snprintf(contracted, sizeof(contracted), "%.*s%s", (int)stem, syllable, glide);
+            }
+            syllable = contracted;
+            s += next_bytes;
+        }
+        
+        if (double_next && syllable[0] && strchr("aiueon", syllable[0]) == NULL) {
+            // っち is written tch in Hepburn
+            romaji[length++] = syllable[0] == 'c' ? 't' : syllable[0];
+        }
+        double_next = 0;
+        
+        size_t syllable_length = strlen(syllable);
+        memcpy(romaji + length, syllable, syllable_length);
+        length += syllable_length;
+    }
+    
+    romaji[length] = '\0';
+    return romaji;
+}
@@ -0,0 +1,563 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "../../include/search_session.h"
+#include "../../include/utf8.h"
+
+// State for adding the children of one node to the pending frontier
+typedef struct {
+    SearchSession* session;
+    int depth;                // Of the children
+    uint32_t code_point;      // Edge taken at match_distance
+    int match_distance;
+    int other_distance;       // Of the children along any other edge
+    int failed;
+} FrontierStep;
+
+// State for scoring the entries of one reading length
+typedef struct {
+    const SearchSession* session;
+    TopKSelector* selector;
+    int query_length;         // In code points
+    int reading_length;       // In code points, or -1 to count each reading's
+    int distance;
+} SessionScorer;
+
+// Same rule as search_candidates() uses to route input to the romaji index
+static int is_romaji_byte(unsigned char c) {
+    return isalpha(c) || c == '-' || c == '\'';
+}
+
+static int text_is_romaji(const char* text, size_t length) {
+    if (length == 0) {
+        return 0;
+    }
+    
+    for (size_t i = 0; i < length; i++) {
+        if (!is_romaji_byte((unsigned char)text[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static const DoubleArrayTrie* session_index(const SearchSession* session) {
+    return session->romaji ? &session->dict->romaji_index : &session->dict->hiragana_index;
+}
+
+static DictionaryField session_field(const SearchSession* session) {
+    return session->romaji ? DictionaryFieldRomaji : DictionaryFieldHiragana;
+}
+
+static int compare_frontier_nodes(const void* a, const void* b) {
+    int node_a = ((const SearchSessionNode*)a)->node;
+    int node_b = ((const SearchSessionNode*)b)->node;
+    return (node_a > node_b) - (node_a < node_b);
+}
+
+static int reserve_text(SearchSession* session, size_t length) {
+    if (length + 1 <= session->text_capacity) {
+        return 0;
+    }
+    
+    size_t capacity = session->text_capacity * 2;
+    while (capacity < length + 1) {
+        capacity *= 2;
+    }
+    
+    char* text = realloc(session->text, capacity);
+    if (!text) return -1;
+    session->text = text;
+    
+    char* query = realloc(session->query, capacity);
+    if (!query) return -1;
+    session->query = query;
+    
+    session->text_capacity = capacity;
+    return 0;
+}
+
+static int reserve_frame(SearchSession* session) {
+    if (session->frame_count < session->frame_capacity) {
+        return 0;
+    }
+    
+    int capacity = session->frame_capacity * 2;
+    SearchSessionFrame* frames = realloc(session->frames, sizeof(SearchSessionFrame) * capacity);
+    if (!frames) {
+        return -1;
+    }
+    
+    session->frames = frames;
+    session->frame_capacity = capacity;
+    return 0;
+}
+
+static int add_node(SearchSessionNode** nodes, size_t* count, size_t* capacity,
+                    int node, int depth, int distance) {
+    if (*count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 256;
+        SearchSessionNode* grown = realloc(*nodes, sizeof(SearchSessionNode) * new_capacity);
+        if (!grown) {
+            return -1;
+        }
+        *nodes = grown;
+        *capacity = new_capacity;
+    }
+    
+    SearchSessionNode* added = &(*nodes)[(*count)++];
+    added->node = node;
+    added->depth = depth;
+    added->distance = distance;
+    return 0;
+}
+
+static int add_pending(SearchSession* session, int node, int depth, int distance) {
+    return add_node(&session->pending, &session->pending_count, &session->pending_capacity,
+                    node, depth, distance);
+}
+
+static int visit_step_child(int child, uint32_t code_point, void* user_data) {
+    FrontierStep* step = user_data;
+    int distance = code_point == step->code_point ? step->match_distance : step->other_distance;
+    if (add_pending(step->session, child, step->depth, distance) != 0) {
+        step->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+static int add_frontier(SearchSession* session, int node, int depth, int distance) {
+    return add_node(&session->frontier, &session->frontier_count, &session->frontier_capacity,
+                    node, depth, distance);
+}
+
+static int visit_seed_node(int node, int depth, int distance, void* user_data) {
+    FrontierStep* step = user_data;
+    if (add_frontier(step->session, node, depth, distance) != 0) {
+        step->failed = 1;
+        return 1;
+    }
+    return 0;
+}
+
+// Compute the frontier of the last frame from scratch: the nodes within
+// max_distance of the query, as trie_fuzzy_search() walks them
+static int seed_frontier(SearchSession* session, SearchSessionFrame* frame) {
+    FrontierStep step = { .session = session, .failed = 0 };
+    trie_fuzzy_nodes(session_index(session), session->query, frame->max_distance,
+                     visit_seed_node, &step);
+    if (step.failed) {
+        session->frontier_count = frame->frontier_start;
+        return -1;
+    }
+    return 0;
+}
+
+// Step the previous frame's frontier by the code point just typed. With D
+// the distance from a path to the text, appending c to the text gives
+//     D'(node) = min(D(node) + 1, D(parent) + (c != edge), D'(parent) + 1)
+// A node can only come within max_distance through a previous node or its
+// parent within it, so the previous frontier plus their children suffice.
+// The last term is settled one distance at a time: the nodes at distance d
+// are final before their children are offered d + 1.
+static int step_frontier(SearchSession* session, const SearchSessionFrame* previous,
+                         SearchSessionFrame* frame, uint32_t code_point,
+                         const char* bytes, int byte_count) {
+    const DoubleArrayTrie* index = session_index(session);
+    int max_distance = frame->max_distance;
+    FrontierStep step = { .session = session, .code_point = code_point, .failed = 0 };
+    
+    session->pending_count = 0;
+    for (int i = 0; i < previous->frontier_count && !step.failed; i++) {
+        SearchSessionNode from = session->frontier[previous->frontier_start + i];
+        if (from.distance > max_distance) {
+            continue;
+        }
+        
+        if (from.distance < max_distance) {
+            step.depth = from.depth + 1;
+            step.match_distance = from.distance;
+            step.other_distance = from.distance + 1;
+            step.failed = add_pending(session, from.node, from.depth, from.distance + 1) != 0;
+            if (!step.failed) {
+                trie_enumerate_children(index, from.node, visit_step_child, &step);
+            }
+        } else {
+            // Only the child matching the code point stays in reach
+            int child = trie_walk(index, from.node, bytes, byte_count);
+            if (child >= 0) {
+                step.failed = add_pending(session, child, from.depth + 1, from.distance) != 0;
+            }
+        }
+    }
+    
+    size_t bucket_starts[SEARCH_MAX_TYPO_DISTANCE + 2];
+    for (int distance = 0; distance <= max_distance && !step.failed; distance++) {
+        size_t start = session->frontier_count;
+        bucket_starts[distance] = start;
+        for (size_t i = 0; i < session->pending_count && !step.failed; i++) {
+            SearchSessionNode node = session->pending[i];
+            if (node.distance == distance) {
+                step.failed = add_frontier(session, node.node, node.depth, node.distance) != 0;
+            }
+        }
+        if (step.failed) {
+            break;
+        }
+        
+        // Keep one copy of each node, unless it already settled closer
+        size_t count = session->frontier_count - start;
+        SearchSessionNode* bucket = session->frontier + start;
+        if (count > 1) {
+            qsort(bucket, count, sizeof(SearchSessionNode), compare_frontier_nodes);
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (kept > 0 && bucket[kept - 1].node == bucket[i].node) {
+                continue;
+            }
+            
+            int settled = 0;
+            for (int closer = 0; closer < distance && !settled; closer++) {
+                size_t closer_count = bucket_starts[closer + 1] - bucket_starts[closer];
+                settled = closer_count > 0 &&
+                    bsearch(&bucket[i], session->frontier + bucket_starts[closer], closer_count,
+                            sizeof(SearchSessionNode), compare_frontier_nodes) != NULL;
+            }
+            if (!settled) {
+                bucket[kept++] = bucket[i];
+            }
+        }
+        session->frontier_count = start + kept;
+        bucket_starts[distance + 1] = session->frontier_count;
+        
+        // Paths that insert a code point past a settled node
+        if (distance < max_distance) {
+            step.match_distance = distance + 1;
+            step.other_distance = distance + 1;
+            for (size_t i = start; i < session->frontier_count && !step.failed; i++) {
+                step.depth = session->frontier[i].depth + 1;
+                trie_enumerate_children(index, session->frontier[i].node, visit_step_child, &step);
+            }
+        }
+    }
+    
+    if (step.failed) {
+        session->frontier_count = frame->frontier_start;
+        return -1;
+    }
+    return 0;
+}
+
+// search_candidates() falls back to a fuzzy walk when no reading completes
+// or starts the query, which the empty query always does
+static int frame_is_fuzzy(const SearchSessionFrame* frame, int query_length) {
+    return query_length == 0 || (frame->node < 0 && frame->prefix_entries == 0);
+}
+
+// Keep the frontier of the last frame if it needs one: stepped from the
+// previous frame's when that covers the distance needed, else computed anew
+static int build_frame(SearchSession* session, uint32_t code_point,
+                       const char* bytes, int byte_count) {
+    SearchSessionFrame* frame = &session->frames[session->frame_count - 1];
+    const SearchSessionFrame* previous = session->frame_count > 1 ? frame - 1 : NULL;
+    int query_length = session->frame_count - 1;
+    
+    frame->frontier_start = session->frontier_count;
+    frame->frontier_count = 0;
+    frame->max_distance = -1;
+    if (!frame_is_fuzzy(frame, query_length)) {
+        return 0;
+    }
+    
+    frame->max_distance = search_typo_distance(session->dict, session->config, query_length,
+                                               0.0f, SEARCH_MIN_COMBINED_SCORE);
+    if (frame->max_distance < 0) {
+        frame->max_distance = -1;
+        return 0;
+    }
+    
+    int status = previous && previous->max_distance >= frame->max_distance ?
+        step_frontier(session, previous, frame, code_point, bytes, byte_count) :
+        seed_frontier(session, frame);
+    frame->frontier_count = (int)(session->frontier_count - frame->frontier_start);
+    return status;
+}
+
+static int push_code_point(SearchSession* session, const char* bytes, int byte_count) {
+    if (reserve_frame(session) != 0) {
+        return -1;
+    }
+    
+    const SearchSessionFrame* previous = &session->frames[session->frame_count - 1];
+    size_t length = previous->text_length;
+    if (reserve_text(session, length + byte_count) != 0) {
+        return -1;
+    }
+    
+    for (int i = 0; i < byte_count; i++) {
+        session->text[length + i] = bytes[i];
+        session->query[length + i] = session->romaji ? (char)tolower((unsigned char)bytes[i]) : bytes[i];
+    }
+    session->text[length + byte_count] = '\0';
+    session->query[length + byte_count] = '\0';
+    
+    // Readings ending at the previous frame's node are prefixes of this text
+    const DoubleArrayTrie* index = session_index(session);
+    SearchSessionFrame* frame = &session->frames[session->frame_count];
+    frame->text_length = length + byte_count;
+    frame->node = previous->node >= 0 ?
+        trie_walk(index, previous->node, session->query + length, byte_count) : -1;
+    frame->prefix_entries = previous->prefix_entries +
+        trie_node_entries(index, previous->node, NULL, NULL);
+    session->frame_count++;
+    
+    uint32_t code_point;
+    utf8_decode(session->query + length, &code_point);
+    if (build_frame(session, code_point, session->query + length, byte_count) != 0) {
+        session->frame_count--;
+        session->text[length] = '\0';
+        session->query[length] = '\0';
+        return -1;
+    }
+    return 0;
+}
+
+// Start over from the empty text in the current mode
+static int start_frames(SearchSession* session) {
+    session->frame_count = 1;
+    session->frontier_count = 0;
+    session->text[0] = '\0';
+    session->query[0] = '\0';
+    session->frames[0].text_length = 0;
+    session->frames[0].node = TRIE_ROOT;
+    session->frames[0].prefix_entries = 0;
+    return build_frame(session, 0, "", 0);
+}
+
+// Every frame depends on the index in use, so switching between romaji and
+// kana input replays the text
+static int rebuild_frames(SearchSession* session, const char* text) {
+    char* copy = strdup(text);
+    if (!copy) {
+        return -1;
+    }
+    
+    session->romaji = text_is_romaji(copy, strlen(copy));
+    int status = start_frames(session);
+    for (const char* p = copy; *p && status == 0; ) {
+        uint32_t code_point;
+        int byte_count = utf8_decode(p, &code_point);
+        status = push_code_point(session, p, byte_count);
+        p += byte_count;
+    }
+    
+    free(copy);
+    return status;
+}
+
+SearchSession* search_session_create(const Dictionary* dict, const SearchConfig* config) {
+    if (!dict || !config) {
+        return NULL;
+    }
+    
+    SearchSession* session = calloc(1, sizeof(SearchSession));
+    if (!session) {
+        return NULL;
+    }
+    
+    session->dict = dict;
+    session->config = config;
+    session->text_capacity = 64;
+    session->text = malloc(session->text_capacity);
+    session->query = malloc(session->text_capacity);
+    session->frame_capacity = 16;
+    session->frames = malloc(sizeof(SearchSessionFrame) * session->frame_capacity);
+    
+    if (!session->text || !session->query || !session->frames || search_session_reset(session) != 0) {
+        search_session_destroy(session);
+        return NULL;
+    }
+    
+    return session;
+}
+
+void search_session_destroy(SearchSession* session) {
+    if (!session) return;
+    
+    free(session->text);
+    free(session->query);
+    free(session->frames);
+    free(session->frontier);
+    free(session->pending);
+    free(session);
+}
+
+int search_session_reset(SearchSession* session) {
+    if (!session) {
+        return -1;
+    }
+    
+    session->romaji = 0;
+    return start_frames(session);
+}
+
+// Append whole UTF-8 code points, e.g. the characters of one key event
+int search_session_append(SearchSession* session, const char* text) {
+    if (!session || !text) {
+        return -1;
+    }
+    
+    while (*text) {
+        uint32_t code_point;
+        int byte_count = utf8_decode(text, &code_point);
+        
+        int empty = session->frame_count == 1;
+        int romaji = (empty || session->romaji) && text_is_romaji(text, byte_count);
+        int status;
+        if (romaji == session->romaji) {
+            status = push_code_point(session, text, byte_count);
+        } else {
+            size_t length = session->frames[session->frame_count - 1].text_length;
+            char* combined = malloc(length + byte_count + 1);
+            if (!combined) {
+                return -1;
+            }
+            memcpy(combined, session->text, length);
+            memcpy(combined + length, text, byte_count);
+            combined[length + byte_count] = '\0';
+            status = rebuild_frames(session, combined);
+            free(combined);
+        }
+        
+        if (status != 0) {
+            return -1;
+        }
+        text += byte_count;
+    }
+    return 0;
+}
+
+// Remove count code points from the end of the text
+int search_session_delete(SearchSession* session, int count) {
+    if (!session || count < 0) {
+        return -1;
+    }
+    
+    int keep = session->frame_count - count;
+    if (keep < 1) {
+        keep = 1;
+    }
+    
+    const SearchSessionFrame* frame = &session->frames[keep - 1];
+    session->frame_count = keep;
+    session->frontier_count = frame->frontier_start + frame->frontier_count;
+    session->text[frame->text_length] = '\0';
+    session->query[frame->text_length] = '\0';
+    
+    if (text_is_romaji(session->text, frame->text_length) != session->romaji) {
+        return rebuild_frames(session, session->text);
+    }
+    return 0;
+}
+
+const char* search_session_text(const SearchSession* session) {
+    return session ? session->text : NULL;
+}
+
+static int visit_session_entry(int entry_id, void* user_data) {
+    SessionScorer* scorer = user_data;
+    const SearchSession* session = scorer->session;
+    int reading_length = scorer->reading_length;
+    int distance = scorer->distance;
+    
+    // A completion is the query plus its suffix, which is all the distance
+    if (reading_length < 0) {
+        const char* reading = dictionary_field(session->dict, entry_id, session_field(session));
+        size_t text_length = session->frames[session->frame_count - 1].text_length;
+        distance = utf8_length(reading + text_length);
+        reading_length = scorer->query_length + distance;
+    }
+    
+    int longest = scorer->query_length > reading_length ? scorer->query_length : reading_length;
+    float phonetic_score = longest > 0 ? 1.0f - (float)distance / (float)longest : 1.0f;
+    float combined_score = calculate_combined_score(0.0f, phonetic_score,
+                                                    session->dict->frequencies[entry_id],
+                                                    session->config);
+    if (combined_score > SEARCH_MIN_COMBINED_SCORE) {
+        topk_push(scorer->selector, entry_id, combined_score);
+    }
+    return 0;
+}
+
+// Score what search_candidates() would for the current text and keep the
+// best max_candidates: completions and shorter readings of the text, whose
+// distance is the difference in length, or the keys on the frontier
+CandidateList* search_session_candidates(const SearchSession* session) {
+    if (!session || session->config->max_candidates <= 0) {
+        return NULL;
+    }
+    
+    const SearchConfig* config = session->config;
+    const Dictionary* dict = session->dict;
+    const DoubleArrayTrie* index = session_index(session);
+    const SearchSessionFrame* frame = &session->frames[session->frame_count - 1];
+    int query_length = session->frame_count - 1;
+    
+    CandidateList* candidates = malloc(sizeof(CandidateList));
+    if (!candidates) return NULL;
+    
+    candidates->capacity = config->max_candidates;
+    candidates->candidate_count = 0;
+    candidates->candidates = malloc(sizeof(NovaKeyCandidate) * candidates->capacity);
+    TopKSelector* selector = topk_create(config->max_candidates);
+    if (!candidates->candidates || !selector) {
+        topk_destroy(selector);
+        free(candidates->candidates);
+        free(candidates);
+        return NULL;
+    }
+    
+    SessionScorer scorer = {
+        .session = session,
+        .selector = selector,
+        .query_length = query_length
+    };
+    if (frame_is_fuzzy(frame, query_length)) {
+        for (int i = 0; i < frame->frontier_count; i++) {
+            const SearchSessionNode* node = &session->frontier[frame->frontier_start + i];
+            scorer.reading_length = node->depth;
+            scorer.distance = node->distance;
+            trie_node_entries(index, node->node, visit_session_entry, &scorer);
+        }
+    } else {
+        scorer.reading_length = -1;
+        trie_enumerate_subtree(index, frame->node, visit_session_entry, &scorer);
+        for (int i = 0; i < query_length; i++) {
+            scorer.reading_length = i;
+            scorer.distance = query_length - i;
+            trie_node_entries(index, session->frames[i].node, visit_session_entry, &scorer);
+        }
+    }
+    
+    // Winners are reported with the scores search_candidates() gives them
+    int selected = topk_finish(selector);
+    for (int i = 0; i < selected; i++) {
+        int entry_id = selector->items[i].id;
+        NovaKeyCandidate* candidate = &candidates->candidates[i];
+        
+        candidate->embedding_score = 0.0f;
+        candidate->phonetic_score = calculate_phonetic_similarity(
+            session->query, dictionary_field(dict, entry_id, session_field(session)));
+        candidate->combined_score = calculate_combined_score(0.0f, candidate->phonetic_score,
+                                                             dict->frequencies[entry_id], config);
+        candidate->text = strdup(dictionary_field(dict, entry_id, DictionaryFieldKanji));
+        candidate->reading = strdup(dictionary_field(dict, entry_id, DictionaryFieldHiragana));
+    }
+    candidates->candidate_count = selected;
+    
+    topk_destroy(selector);
+    return candidates;
+}
@@ -0,0 +1,122 @@
+#include <stdlib.h>
+#include <math.h>
+#include "../../include/topk.h"
+
+// Heap order: lower score is weaker, ties go to the higher id so results
+// are deterministic regardless of feed order
+static int weaker(const TopKItem* a, const TopKItem* b) {
+    if (a->score != b->score) return a->score < b->score;
+    return a->id > b->id;
+}
+
+static void sift_down(TopKItem* items, int count, int index) {
+    for (;;) {
+        int smallest = index;
+        int left = 2 * index + 1;
+        int right = left + 1;
+        
+        if (left < count && weaker(&items[left], &items[smallest])) smallest = left;
+        if (right < count && weaker(&items[right], &items[smallest])) smallest = right;
+        if (smallest == index) return;
+        
+        TopKItem temp = items[index];
+        items[index] = items[smallest];
+        items[smallest] = temp;
+        index = smallest;
+    }
+}
+
+static void sift_up(TopKItem* items, int index) {
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (!weaker(&items[index], &items[parent])) return;
+        
+        TopKItem temp = items[index];
+        items[index] = items[parent];
+        items[parent] = temp;
+        index = parent;
+    }
+}
+
+TopKSelector* topk_create(int k) {
+    if (k <= 0) {
+        return NULL;
+    }
+    
+    TopKSelector* selector = malloc(sizeof(TopKSelector));
+    if (!selector) {
+        return NULL;
+    }
+    
+    selector->items = malloc(sizeof(TopKItem) * k);
+    if (!selector->items) {
+        free(selector);
+        return NULL;
+    }
+    
+    selector->k = k;
+    selector->count = 0;
+    return selector;
+}
+
+void topk_destroy(TopKSelector* selector) {
+    if (selector) {
+        free(selector->items);
+        free(selector);
+    }
+}
+
+void topk_reset(TopKSelector* selector) {
+    if (selector) {
+        selector->count = 0;
+    }
+}
+
+int topk_push(TopKSelector* selector, int id, float score) {
+    TopKItem item = { id, score };
+    
+    if (selector->count < selector->k) {
+        selector->items[selector->count] = item;
+        sift_up(selector->items, selector->count);
+        selector->count++;
+        return 1;
+    }
+    
+    if (!weaker(&selector->items[0], &item)) {
+        return 0;
+    }
+    
+    selector->items[0] = item;
+    sift_down(selector->items, selector->count, 0);
+    return 1;
+}
+
+void topk_push_scores(TopKSelector* selector, const float* scores, int count, float min_score) {
+    for (int i = 0; i < count; i++) {
+        // Cheap rejection against the current threshold before touching the heap
+        if (scores[i] > min_score && scores[i] >= topk_threshold(selector)) {
+            topk_push(selector, i, scores[i]);
+        }
+    }
+}
+
+float topk_threshold(const TopKSelector* selector) {
+    if (!selector || selector->count < selector->k) {
+        return -INFINITY;
+    }
+    return selector->items[0].score;
+}
+
+int topk_finish(TopKSelector* selector) {
+    // Heap sort in place: repeatedly move the weakest item to the end,
+    // leaving the items ordered best to worst. Reset the selector before
+    // feeding it again.
+    for (int end = selector->count - 1; end > 0; end--) {
+        TopKItem temp = selector->items[0];
+        selector->items[0] = selector->items[end];
+        selector->items[end] = temp;
+        sift_down(selector->items, end, 0);
+    }
+    
+    return selector->count;
+}
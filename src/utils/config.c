@@ -2,20 +2,30 @@
 #include <stdlib.h>
 #include <string.h>
 #include <cjson/cJSON.h>
+#include "../../include/config.h"
 
 typedef struct NovaKeyConfig {
+    char* embedding_backend;
     char* ollama_url;
     char* embedding_model;
     char* dictionary_path;
+    char* embedding_store_path;
+    char* semantic_index_path;
+    int quantized_embeddings;
+    char* embedding_precision;
+    int binary_prefilter;
+    int embedding_batch_size;
+    char* embedding_cache_dir;
+    int embedding_cache_max_mb;
+    int embedding_memory_cache_mb;
+    int embedding_timeout_ms;
+    int embedding_breaker_cooldown_ms;
     float embedding_weight;
     float phonetic_weight;
     int max_candidates;
     int debug_logging;
 } NovaKeyConfig;
 
-// Forward declarations
-NovaKeyConfig* create_default_config(void);
-
 static NovaKeyConfig* global_config = NULL;
 
 NovaKeyConfig* load_config(const char* config_path) {
@@ -56,6 +66,10 @@ NovaKeyConfig* load_config(const char* config_path) {
     }
     
     // Extract configuration values
+    cJSON* embedding_backend = cJSON_GetObjectItem(json, "embedding_backend");
+    config->embedding_backend = strdup(cJSON_IsString(embedding_backend) ? 
+                                       cJSON_GetStringValue(embedding_backend) : "ollama");
+    
     cJSON* ollama_url = cJSON_GetObjectItem(json, "ollama_url");
     config->ollama_url = strdup(cJSON_IsString(ollama_url) ? 
                                 cJSON_GetStringValue(ollama_url) : "http://localhost:11434");
@@ -68,6 +82,50 @@ NovaKeyConfig* load_config(const char* config_path) {
     config->dictionary_path = strdup(cJSON_IsString(dictionary_path) ? 
                                      cJSON_GetStringValue(dictionary_path) : "resources/dictionary.txt");
     
+    cJSON* embedding_store_path = cJSON_GetObjectItem(json, "embedding_store_path");
+    config->embedding_store_path = strdup(cJSON_IsString(embedding_store_path) ? 
+                                          cJSON_GetStringValue(embedding_store_path) : "resources/dictionary.emb");
+    
+    cJSON* semantic_index_path = cJSON_GetObjectItem(json, "semantic_index_path");
+    config->semantic_index_path = strdup(cJSON_IsString(semantic_index_path) ? 
+                                         cJSON_GetStringValue(semantic_index_path) : "resources/dictionary.hnsw");
+    
+    cJSON* quantized_embeddings = cJSON_GetObjectItem(json, "quantized_embeddings");
+    config->quantized_embeddings = cJSON_IsBool(quantized_embeddings) ? 
+                                   cJSON_IsTrue(quantized_embeddings) : 1;
+    
+    cJSON* embedding_precision = cJSON_GetObjectItem(json, "embedding_precision");
+    config->embedding_precision = strdup(cJSON_IsString(embedding_precision) ? 
+                                         cJSON_GetStringValue(embedding_precision) : "f16");
+    
+    cJSON* binary_prefilter = cJSON_GetObjectItem(json, "binary_prefilter");
+    config->binary_prefilter = cJSON_IsBool(binary_prefilter) ? 
+                               cJSON_IsTrue(binary_prefilter) : 0;
+    
+    cJSON* embedding_batch_size = cJSON_GetObjectItem(json, "embedding_batch_size");
+    config->embedding_batch_size = cJSON_IsNumber(embedding_batch_size) ? 
+                                   cJSON_GetNumberValue(embedding_batch_size) : 64;
+    
+    cJSON* embedding_cache_dir = cJSON_GetObjectItem(json, "embedding_cache_dir");
+    config->embedding_cache_dir = strdup(cJSON_IsString(embedding_cache_dir) ? 
+                                         cJSON_GetStringValue(embedding_cache_dir) : "resources/cache");
+    
+    cJSON* embedding_cache_max_mb = cJSON_GetObjectItem(json, "embedding_cache_max_mb");
+    config->embedding_cache_max_mb = cJSON_IsNumber(embedding_cache_max_mb) ? 
+                                     cJSON_GetNumberValue(embedding_cache_max_mb) : 64;
+    
+    cJSON* embedding_memory_cache_mb = cJSON_GetObjectItem(json, "embedding_memory_cache_mb");
+    config->embedding_memory_cache_mb = cJSON_IsNumber(embedding_memory_cache_mb) ? 
+                                        cJSON_GetNumberValue(embedding_memory_cache_mb) : 8;
+    
+    cJSON* embedding_timeout_ms = cJSON_GetObjectItem(json, "embedding_timeout_ms");
+    config->embedding_timeout_ms = cJSON_IsNumber(embedding_timeout_ms) ? 
+                                   cJSON_GetNumberValue(embedding_timeout_ms) : 200;
+    
+    cJSON* embedding_breaker_cooldown_ms = cJSON_GetObjectItem(json, "embedding_breaker_cooldown_ms");
+    config->embedding_breaker_cooldown_ms = cJSON_IsNumber(embedding_breaker_cooldown_ms) ? 
+                                            cJSON_GetNumberValue(embedding_breaker_cooldown_ms) : 10000;
+    
     cJSON* embedding_weight = cJSON_GetObjectItem(json, "embedding_weight");
     config->embedding_weight = cJSON_IsNumber(embedding_weight) ? 
                                (float)cJSON_GetNumberValue(embedding_weight) : 0.6f;
@@ -93,9 +151,21 @@ NovaKeyConfig* create_default_config(void) {
     NovaKeyConfig* config = malloc(sizeof(NovaKeyConfig));
     if (!config) return NULL;
     
+    config->embedding_backend = strdup("ollama");
     config->ollama_url = strdup("http://localhost:11434");
     config->embedding_model = strdup("nomic-embed-text");
     config->dictionary_path = strdup("resources/dictionary.txt");
+    config->embedding_store_path = strdup("resources/dictionary.emb");
+    config->semantic_index_path = strdup("resources/dictionary.hnsw");
+    config->quantized_embeddings = 1;
+    config->embedding_precision = strdup("f16");
+    config->binary_prefilter = 0;
+    config->embedding_batch_size = 64;
+    config->embedding_cache_dir = strdup("resources/cache");
+    config->embedding_cache_max_mb = 64;
+    config->embedding_memory_cache_mb = 8;
+    config->embedding_timeout_ms = 200;
+    config->embedding_breaker_cooldown_ms = 10000;
     config->embedding_weight = 0.6f;
     config->phonetic_weight = 0.4f;
     config->max_candidates = 10;
@@ -108,9 +178,14 @@ NovaKeyConfig* create_default_config(void) {
 void free_config(NovaKeyConfig* config) {
     if (!config) return;
     
+    free(config->embedding_backend);
     free(config->ollama_url);
     free(config->embedding_model);
     free(config->dictionary_path);
+    free(config->embedding_store_path);
+    free(config->semantic_index_path);
+    free(config->embedding_precision);
+    free(config->embedding_cache_dir);
     free(config);
 }
 
@@ -126,4 +201,60 @@ void cleanup_global_config(void) {
         free_config(global_config);
         global_config = NULL;
     }
-}
\ No newline at end of file
+}
+
+// Keep the default path if the copy fails
+static void replace_path(char** field, const char* path) {
+    char* copy = path ? strdup(path) : NULL;
+    if (copy) {
+        free(*field);
+        *field = copy;
+    }
+}
+
+// Search settings from the configuration; the weights and paths are copied,
+// so the result outlives config
+SearchConfig* create_configured_search_config(const NovaKeyConfig* config) {
+    SearchConfig* search_config = create_search_config();
+    if (!search_config || !config) {
+        return search_config;
+    }
+    
+    search_config->embedding_weight = config->embedding_weight;
+    search_config->phonetic_weight = config->phonetic_weight;
+    search_config->max_candidates = config->max_candidates;
+    search_config->quantized_embeddings = config->quantized_embeddings;
+    search_config->binary_prefilter = config->binary_prefilter;
+    search_config->embedding_timeout_ms = config->embedding_timeout_ms;
+    if (embedding_precision_from_name(config->embedding_precision,
+                                      &search_config->embedding_precision) != 0) {
+        printf("Warning: Unknown embedding precision '%s', using %s\n", config->embedding_precision,
+               embedding_precision_name(search_config->embedding_precision));
+    }
+    
+    replace_path(&search_config->dictionary_path, config->dictionary_path);
+    replace_path(&search_config->embedding_store_path, config->embedding_store_path);
+    replace_path(&search_config->semantic_index_path, config->semantic_index_path);
+    return search_config;
+}
+
+// Embedding backend named by the configuration, with its caches, batch size
+// and circuit breaker cool-down; an empty embedding_cache_dir means no disk cache
+EmbeddingBackend* create_configured_embedding_backend(const NovaKeyConfig* config) {
+    if (!config) {
+        return NULL;
+    }
+    
+    EmbeddingBackendSettings settings = {
+        .cache_dir = config->embedding_cache_dir && config->embedding_cache_dir[0] ?
+            config->embedding_cache_dir : NULL,
+        .cache_max_bytes = config->embedding_cache_max_mb > 0 ?
+            (size_t)config->embedding_cache_max_mb << 20 : 0,
+        .memory_cache_bytes = config->embedding_memory_cache_mb > 0 ?
+            (size_t)config->embedding_memory_cache_mb << 20 : 0,
+        .batch_size = config->embedding_batch_size,
+        .breaker_cooldown_ms = config->embedding_breaker_cooldown_ms
+    };
+    return embedding_backend_create(config->embedding_backend, config->ollama_url,
+                                    config->embedding_model, &settings);
+}
@@ -0,0 +1,253 @@
+#include <stdint.h>
+#include <string.h>
+#include "../../include/json_scan.h"
+
+// Mantissa digits kept exactly; later ones only scale the exponent
+#define JSON_MANTISSA_LIMIT 100000000000000000ULL
+
+static const double powers_of_ten[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static int is_whitespace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static const char* skip_whitespace(const char* p, const char* end) {
+    while (p < end && is_whitespace(*p)) {
+        p++;
+    }
+    return p;
+}
+
+// Past the closing quote of the string opening at p
+static const char* skip_string(const char* p, const char* end) {
+    for (p++; p < end; p++) {
+        if (*p == '\\') {
+            p++;
+        } else if (*p == '"') {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+static const char* skip_value(const char* p, const char* end) {
+    if (p >= end) {
+        return NULL;
+    }
+    if (*p == '"') {
+        return skip_string(p, end);
+    }
+    
+    if (*p == '[' || *p == '{') {
+        int depth = 0;
+        while (p < end) {
+            if (*p == '"') {
+                p = skip_string(p, end);
+                if (!p) return NULL;
+                continue;
+            }
+            if (*p == '[' || *p == '{') {
+                depth++;
+            } else if ((*p == ']' || *p == '}') && --depth == 0) {
+                return p + 1;
+            }
+            p++;
+        }
+        return NULL;
+    }
+    
+    // Number, true, false or null
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && !is_whitespace(*p)) {
+        p++;
+    }
+    return p;
+}
+
+// Value of the member key of the object at json; members before it are
+// skipped without being parsed
+const char* json_find_member(const char* json, const char* end, const char* key) {
+    size_t key_length = strlen(key);
+    const char* p = skip_whitespace(json, end);
+    if (p >= end || *p != '{') {
+        return NULL;
+    }
+    
+    for (p++; ; p++) {
+        p = skip_whitespace(p, end);
+        if (p >= end || *p != '"') {
+            return NULL;
+        }
+        
+        const char* name = p + 1;
+        p = skip_string(p, end);
+        if (!p) {
+            return NULL;
+        }
+        int match = (size_t)(p - 1 - name) == key_length && memcmp(name, key, key_length) == 0;
+        
+        p = skip_whitespace(p, end);
+        if (p >= end || *p != ':') {
+            return NULL;
+        }
+        p = skip_whitespace(p + 1, end);
+        if (match) {
+            return p;
+        }
+        
+        p = skip_value(p, end);
+        if (!p) {
+            return NULL;
+        }
+        p = skip_whitespace(p, end);
+        if (p >= end || *p != ',') {
+            return NULL;
+        }
+    }
+}
+
+// First element of the array at array, NULL if it is empty
+const char* json_array_first(const char* array, const char* end) {
+    if (!array || array >= end || *array != '[') {
+        return NULL;
+    }
+    
+    const char* p = skip_whitespace(array + 1, end);
+    return p < end && *p != ']' ? p : NULL;
+}
+
+// Element after the one ending at element_end, NULL after the last
+const char* json_array_next(const char* element_end, const char* end) {
+    const char* p = skip_whitespace(element_end, end);
+    if (p >= end || *p != ',') {
+        return NULL;
+    }
+    return skip_whitespace(p + 1, end);
+}
+
+// Number of elements of the array of numbers at array, -1 if it is not one.
+// Only separators are looked at, so this costs a fraction of the parse.
+int json_count_floats(const char* array, const char* end) {
+    if (!array || array >= end || *array != '[') {
+        return -1;
+    }
+    
+    int separators = 0;
+    int empty = 1;
+    for (const char* p = array + 1; p < end; p++) {
+        if (*p == ']') {
+            return empty ? 0 : separators + 1;
+        } else if (*p == ',') {
+            separators++;
+        } else if (*p == '[' || *p == '{' || *p == '"') {
+            return -1;
+        } else if (!is_whitespace(*p)) {
+            empty = 0;
+        }
+    }
+    return -1;
+}
+
+// JSON number to the nearest float. Up to 17 significant digits are kept
+// exactly and scaled by powers of ten in double precision, far finer than a
+// float needs; unlike strtof() this does not depend on the locale.
+static const char* parse_number(const char* p, const char* end, float* value) {
+    int negative = p < end && *p == '-';
+    if (negative) {
+        p++;
+    }
+    
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    const char* digits = p;
+    for (; p < end && is_digit(*p); p++) {
+        if (mantissa < JSON_MANTISSA_LIMIT) {
+            mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+        } else {
+            exponent++;
+        }
+    }
+    if (p == digits) {
+        return NULL;
+    }
+    
+    if (p < end && *p == '.') {
+        const char* fraction = ++p;
+        for (; p < end && is_digit(*p); p++) {
+            if (mantissa < JSON_MANTISSA_LIMIT) {
+                mantissa = mantissa * 10 + (uint64_t)(*p - '0');
+                exponent--;
+            }
+        }
+        if (p == fraction) {
+            return NULL;
+        }
+    }
+    
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        int sign = 1;
+        if (p < end && (*p == '+' || *p == '-')) {
+            sign = *p == '-' ? -1 : 1;
+            p++;
+        }
+        
+        const char* exponent_digits = p;
+        int written = 0;
+        for (; p < end && is_digit(*p); p++) {
+            if (written < 10000) {
+                written = written * 10 + (*p - '0');
+            }
+        }
+        if (p == exponent_digits) {
+            return NULL;
+        }
+        exponent += sign * written;
+    }
+    
+    double result = (double)mantissa;
+    for (; exponent > 22; exponent -= 22) {
+        result *= 1e22;
+    }
+    for (; exponent < -22; exponent += 22) {
+        result /= 1e22;
+    }
+    result = exponent >= 0 ? result * powers_of_ten[exponent] : result / powers_of_ten[-exponent];
+    
+    *value = (float)(negative ? -result : result);
+    return p;
+}
+
+// Convert the count numbers of the array at array straight into values.
+// Returns the position past its ']', or NULL unless it holds exactly count
+// numbers.
+const char* json_read_floats(const char* array, const char* end, float* values, int count) {
+    if (!array || array >= end || *array != '[') {
+        return NULL;
+    }
+    
+    const char* p = skip_whitespace(array + 1, end);
+    if (count == 0) {
+        return p < end && *p == ']' ? p + 1 : NULL;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        p = parse_number(p, end, &values[i]);
+        if (!p) {
+            return NULL;
+        }
+        
+        p = skip_whitespace(p, end);
+        if (p >= end || *p != (i + 1 < count ? ',' : ']')) {
+            return NULL;
+        }
+        p = skip_whitespace(p + 1, end);
+    }
+    return p;
+}
@@ -0,0 +1,39 @@
+#include "../../include/utf8.h"
+
+// Decode one UTF-8 code point; returns bytes consumed. Malformed bytes
+// decode as themselves, one byte at a time.
+int utf8_decode(const char* text, uint32_t* code_point) {
+    const unsigned char* s = (const unsigned char*)text;
+    
+    if (s[0] < 0x80) {
+        *code_point = s[0];
+        return 1;
+    }
+    if ((s[0] & 0xE0) == 0xC0 && s[1]) {
+        *code_point = ((s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+        return 2;
+    }
+    if ((s[0] & 0xF0) == 0xE0 && s[1] && s[2]) {
+        *code_point = ((s[0] & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+        return 3;
+    }
+    if ((s[0] & 0xF8) == 0xF0 && s[1] && s[2] && s[3]) {
+        *code_point = ((uint32_t)(s[0] & 0x07) << 18) | ((s[1] & 0x3F) << 12) |
+                      ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+        return 4;
+    }
+    *code_point = s[0];
+    return 1;
+}
+
+// Number of code points in a NUL-terminated string
+int utf8_length(const char* text) {
+    int length = 0;
+    uint32_t code_point;
+    
+    while (*text) {
+        text += utf8_decode(text, &code_point);
+        length++;
+    }
+    return length;
+}
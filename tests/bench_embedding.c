@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include "../include/embedding.h"
+#include "../include/embedding_async.h"
+
+// Embedding client benchmark: throughput and latency percentiles of
+// sequential, batched and concurrent requests. Meant to be run against
+// mock_ollama, whose latency, jitter and error rate make the numbers
+// reproducible without a model:
+//
+//   mock_ollama --port 11534 --latency-ms 5 --jitter-ms 20 &
+//   bench_embedding [base_url] [requests] [in_flight]
+
+typedef struct {
+    uint64_t started_ms;
+    uint64_t finished_ms;
+    int succeeded;
+} BenchRequest;
+
+// The clients log every request; measured sections run with stdout muted
+static int muted_stdout = -1;
+
+static void mute_stdout(int mute) {
+    fflush(stdout);
+    if (mute) {
+        int null_fd = open("/dev/null", O_WRONLY);
+        muted_stdout = dup(STDOUT_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        close(null_fd);
+    } else if (muted_stdout >= 0) {
+        dup2(muted_stdout, STDOUT_FILENO);
+        close(muted_stdout);
+        muted_stdout = -1;
+    }
+}
+
+static int compare_latency(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void report(const char* label, const BenchRequest* requests, int count, uint64_t elapsed_ms) {
+    uint64_t* latencies = malloc(sizeof(uint64_t) * count);
+    int succeeded = 0;
+    for (int i = 0; i < count; i++) {
+        latencies[i] = requests[i].finished_ms - requests[i].started_ms;
+        succeeded += requests[i].succeeded;
+    }
+    qsort(latencies, count, sizeof(uint64_t), compare_latency);
+    
+    printf("%-22s %8.1f req/s  p50 %4llu  p90 %4llu  p99 %4llu  max %4llu ms  %d failed\n",
+           label, elapsed_ms > 0 ? count * 1000.0 / elapsed_ms : 0.0,
+           (unsigned long long)latencies[count / 2],
+           (unsigned long long)latencies[count * 9 / 10],
+           (unsigned long long)latencies[count * 99 / 100],
+           (unsigned long long)latencies[count - 1], count - succeeded);
+    free(latencies);
+}
+
+static void finish_request(const char* text, EmbeddingVector* vector, void* user_data) {
+    (void)text;
+    BenchRequest* request = user_data;
+    request->finished_ms = embedding_clock_ms();
+    request->succeeded = vector != NULL;
+    free_embedding_vector(vector);
+}
+
+int main(int argc, char* argv[]) {
+    const char* base_url = argc > 1 ? argv[1] : "http://127.0.0.1:11534";
+    int count = argc > 2 ? atoi(argv[2]) : 500;
+    int in_flight = argc > 3 ? atoi(argv[3]) : 8;
+    if (count <= 0 || in_flight <= 0) {
+        fprintf(stderr, "usage: %s [base_url] [requests] [in_flight]\n", argv[0]);
+        return 1;
+    }
+    
+    printf("=== NovaKey Embedding Client Benchmark ===\n");
+    printf("%s, %d requests, %d in flight\n\n", base_url, count, in_flight);
+    
+    // Distinct texts, so no request is answered from a cache
+    char** texts = malloc(sizeof(char*) * count);
+    BenchRequest* requests = calloc(count, sizeof(BenchRequest));
+    for (int i = 0; i < count; i++) {
+        texts[i] = malloc(32);
+        snprintf(texts[i], 32, "ベンチマーク %d", i);
+    }
+    
+    mute_stdout(1);
+    OllamaClient* client = ollama_client_create(base_url, "nomic-embed-text");
+    mute_stdout(0);
+    if (!client) {
+        fprintf(stderr, "could not create client\n");
+        return 1;
+    }
+    
+    // One request at a time on the kept-alive connection
+    mute_stdout(1);
+    uint64_t start = embedding_clock_ms();
+    for (int i = 0; i < count; i++) {
+        requests[i].started_ms = embedding_clock_ms();
+        EmbeddingVector* vector = generate_embedding(client, texts[i]);
+        requests[i].finished_ms = embedding_clock_ms();
+        requests[i].succeeded = vector != NULL;
+        free_embedding_vector(vector);
+    }
+    uint64_t elapsed = embedding_clock_ms() - start;
+    mute_stdout(0);
+    report("sequential", requests, count, elapsed);
+    
+    // The same texts in /api/embed batches; latency is per batch
+    int batches = (count + client->batch_size - 1) / client->batch_size;
+    mute_stdout(1);
+    start = embedding_clock_ms();
+    for (int b = 0; b < batches; b++) {
+        int first = b * client->batch_size;
+        int size = count - first < client->batch_size ? count - first : client->batch_size;
+        requests[b].started_ms = embedding_clock_ms();
+        EmbeddingMatrix* matrix = generate_embeddings_batch(client, (const char* const*)texts + first, size);
+        requests[b].finished_ms = embedding_clock_ms();
+        requests[b].succeeded = matrix != NULL;
+        free_embedding_matrix(matrix);
+    }
+    elapsed = embedding_clock_ms() - start;
+    mute_stdout(0);
+    char label[32];
+    snprintf(label, sizeof(label), "batched (%d per req)", client->batch_size);
+    report(label, requests, batches, elapsed);
+    printf("%-22s %8.1f texts/s\n", "", elapsed > 0 ? count * 1000.0 / elapsed : 0.0);
+    
+    mute_stdout(1);
+    ollama_client_destroy(client);
+    
+    // Concurrent requests over the multi handle; latency includes queueing
+    AsyncEmbeddingClient* async_client = async_embedding_client_create(base_url, "nomic-embed-text",
+                                                                       in_flight);
+    if (!async_client) {
+        mute_stdout(0);
+        fprintf(stderr, "could not create asynchronous client\n");
+        return 1;
+    }
+    memset(requests, 0, sizeof(BenchRequest) * count);
+    start = embedding_clock_ms();
+    for (int i = 0; i < count; i++) {
+        requests[i].started_ms = start;
+        async_embedding_submit(async_client, texts[i], finish_request, &requests[i]);
+    }
+    while (async_embedding_pending(async_client) > 0) {
+        async_embedding_wait(async_client, 100);
+    }
+    elapsed = embedding_clock_ms() - start;
+    async_embedding_client_destroy(async_client);
+    mute_stdout(0);
+    snprintf(label, sizeof(label), "async (%d in flight)", in_flight);
+    report(label, requests, count, elapsed);
+    
+    for (int i = 0; i < count; i++) {
+        free(texts[i]);
+    }
+    free(texts);
+    free(requests);
+    return 0;
+}
@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "../include/embedding_store.h"
+#include "../include/vector_ops.h"
+#include "../include/hnsw.h"
+#include "../include/topk.h"
+
+// Semantic retrieval benchmark: recall@K against an exact GEMV scan versus
+// query latency, over synthetic clustered embeddings: int8, fp16 and bf16
+// scans, sign-bit signature shortlists and HNSW.
+//
+//   bench_retrieval [entries] [dimensions] [queries]
+
+#define BENCH_K 10
+
+// Shortlist size, in multiples of BENCH_K, re-ranked with the float rows
+#define BENCH_RERANK_FACTOR 4
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static float random_unit(void) {
+    return (float)rand() / RAND_MAX - 0.5f;
+}
+
+// Unit vectors scattered around centres, like embeddings of related words
+static void fill_clustered_rows(EmbeddingStore* store, int clusters) {
+    int dims = store->dimensions;
+    float* centres = malloc(sizeof(float) * clusters * dims);
+    
+    for (int i = 0; i < clusters * dims; i++) {
+        centres[i] = random_unit();
+    }
+    for (int r = 0; r < store->entry_count; r++) {
+        float* row = embedding_store_mutable_row(store, r);
+        const float* centre = centres + (rand() % clusters) * dims;
+        for (int i = 0; i < dims; i++) {
+            row[i] = centre[i] + 0.3f * random_unit();
+        }
+        vector_normalize(row, dims);
+    }
+    
+    free(centres);
+}
+
+// Copy of the float rows of store at another precision
+static EmbeddingStore* convert_store(const EmbeddingStore* store, EmbeddingPrecision precision) {
+    EmbeddingStore* copy = embedding_store_create(store->model_name, store->dictionary_hash,
+                                                  store->entry_count, store->dimensions);
+    if (!copy) {
+        return NULL;
+    }
+    for (int r = 0; r < store->entry_count; r++) {
+        memcpy(embedding_store_mutable_row(copy, r), embedding_store_row(store, r),
+               sizeof(float) * store->dimensions);
+    }
+    if (embedding_store_set_precision(copy, precision) != 0) {
+        embedding_store_destroy(copy);
+        return NULL;
+    }
+    return copy;
+}
+
+static int count_hits(const TopKSelector* exact, const TopKSelector* approximate) {
+    int hits = 0;
+    for (int i = 0; i < exact->count; i++) {
+        for (int j = 0; j < approximate->count; j++) {
+            hits += exact->items[i].id == approximate->items[j].id;
+        }
+    }
+    return hits;
+}
+
+int main(int argc, char* argv[]) {
+    int entries = argc > 1 ? atoi(argv[1]) : 50000;
+    int dims = argc > 2 ? atoi(argv[2]) : 128;
+    int queries = argc > 3 ? atoi(argv[3]) : 200;
+    if (entries <= BENCH_K || dims <= 0 || queries <= 0) {
+        fprintf(stderr, "usage: %s [entries] [dimensions] [queries]\n", argv[0]);
+        return 1;
+    }
+    
+    printf("=== NovaKey Retrieval Benchmark ===\n");
+    printf("%d entries, %d dimensions, %d queries, kernel %s\n\n",
+           entries, dims, queries, vector_kernel_name());
+    
+    srand(42);
+    EmbeddingStore* store = embedding_store_create("bench", 0, entries, dims);
+    float* query_set = malloc(sizeof(float) * queries * dims);
+    float* scores = malloc(sizeof(float) * entries);
+    TopKSelector** truth = malloc(sizeof(TopKSelector*) * queries);
+    if (!store || !query_set || !scores || !truth) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    fill_clustered_rows(store, entries / 100 + 1);
+    
+    // Queries near stored rows, as typed input near the vocabulary would be
+    for (int q = 0; q < queries; q++) {
+        float* query = query_set + (size_t)q * dims;
+        const float* row = embedding_store_row(store, rand() % entries);
+        for (int i = 0; i < dims; i++) {
+            query[i] = row[i] + 0.1f * random_unit();
+        }
+        vector_normalize(query, dims);
+    }
+    
+    // Exact baseline, which is also the ground truth
+    double start = now_seconds();
+    for (int q = 0; q < queries; q++) {
+        truth[q] = topk_create(BENCH_K);
+        embedding_store_score(store, query_set + (size_t)q * dims, scores);
+        topk_push_scores(truth[q], scores, entries, -INFINITY);
+        topk_finish(truth[q]);
+    }
+    double exact_us = (now_seconds() - start) / queries * 1e6;
+    printf("%-20s recall@%d 1.000  %10.1f us/query\n", "exact gemv", BENCH_K, exact_us);
+    
+    // int8 scan, alone and with the float re-rank of a shortlist
+    if (embedding_store_quantize(store) != 0) {
+        fprintf(stderr, "quantization failed\n");
+        return 1;
+    }
+    TopKSelector* results = topk_create(BENCH_K);
+    TopKSelector* shortlist = topk_create(BENCH_K * BENCH_RERANK_FACTOR);
+    for (int pass = 0; pass < 2; pass++) {
+        int hits = 0;
+        start = now_seconds();
+        for (int q = 0; q < queries; q++) {
+            const float* query = query_set + (size_t)q * dims;
+            topk_reset(results);
+            embedding_store_score_quantized(store, query, scores);
+            if (pass == 0) {
+                topk_push_scores(results, scores, entries, -INFINITY);
+            } else {
+                topk_reset(shortlist);
+                topk_push_scores(shortlist, scores, entries, -INFINITY);
+                for (int i = 0; i < shortlist->count; i++) {
+                    int id = shortlist->items[i].id;
+                    topk_push(results, id, vector_dot(query, embedding_store_row(store, id), dims));
+                }
+            }
+            topk_finish(results);
+            hits += count_hits(truth[q], results);
+        }
+        double latency_us = (now_seconds() - start) / queries * 1e6;
+        printf("%-20s recall@%d %.3f  %10.1f us/query\n",
+               pass == 0 ? "int8 gemv" : "int8 gemv + rerank", BENCH_K,
+               (double)hits / (queries * BENCH_K), latency_us);
+    }
+    topk_destroy(shortlist);
+    
+    // Full scans over fp16 and bf16 rows, widened on the fly
+    size_t half_row_bytes = 0;
+    const EmbeddingPrecision half_precisions[] = { EmbeddingPrecisionF16, EmbeddingPrecisionBF16 };
+    for (int p = 0; p < 2; p++) {
+        EmbeddingStore* half = convert_store(store, half_precisions[p]);
+        if (!half) {
+            fprintf(stderr, "conversion failed\n");
+            return 1;
+        }
+        half_row_bytes = embedding_store_row_bytes(half);
+        
+        int hits = 0;
+        start = now_seconds();
+        for (int q = 0; q < queries; q++) {
+            topk_reset(results);
+            embedding_store_score(half, query_set + (size_t)q * dims, scores);
+            topk_push_scores(results, scores, entries, -INFINITY);
+            topk_finish(results);
+            hits += count_hits(truth[q], results);
+        }
+        double latency_us = (now_seconds() - start) / queries * 1e6;
+        
+        char label[32];
+        snprintf(label, sizeof(label), "%s gemv", embedding_precision_name(half_precisions[p]));
+        printf("%-20s recall@%d %.3f  %10.1f us/query\n", label, BENCH_K,
+               (double)hits / (queries * BENCH_K), latency_us);
+        embedding_store_destroy(half);
+    }
+    
+    // Hamming shortlists over sign bits, each re-ranked with exact dot products
+    if (embedding_store_build_signatures(store) != 0) {
+        fprintf(stderr, "signatures failed\n");
+        return 1;
+    }
+    const int shortlist_factors[] = { 1, 4, 16, 64 };
+    int* shortlist_ids = malloc(sizeof(int) * BENCH_K * 64);
+    for (size_t f = 0; f < sizeof(shortlist_factors) / sizeof(shortlist_factors[0]); f++) {
+        int limit = BENCH_K * shortlist_factors[f];
+        int hits = 0;
+        start = now_seconds();
+        for (int q = 0; q < queries; q++) {
+            const float* query = query_set + (size_t)q * dims;
+            topk_reset(results);
+            int count = embedding_store_signature_shortlist(store, query, limit, shortlist_ids);
+            for (int i = 0; i < count; i++) {
+                topk_push(results, shortlist_ids[i], embedding_store_dot(store, shortlist_ids[i], query));
+            }
+            topk_finish(results);
+            hits += count_hits(truth[q], results);
+        }
+        double latency_us = (now_seconds() - start) / queries * 1e6;
+        
+        char label[32];
+        snprintf(label, sizeof(label), "signs + rerank %d", limit);
+        printf("%-20s recall@%d %.3f  %10.1f us/query\n", label, BENCH_K,
+               (double)hits / (queries * BENCH_K), latency_us);
+    }
+    free(shortlist_ids);
+    printf("row bytes: float %zu, f16/bf16 %zu, int8 %zu, signature %zu\n\n",
+           embedding_store_row_bytes(store), half_row_bytes, store->quantized_stride,
+           sizeof(uint64_t) * store->signature_words);
+    
+    start = now_seconds();
+    HnswIndex* index = hnsw_build(store, HNSW_DEFAULT_M, HNSW_DEFAULT_EF_CONSTRUCTION);
+    if (!index) {
+        fprintf(stderr, "HNSW build failed\n");
+        return 1;
+    }
+    printf("hnsw build: %.2f s (M=%d, ef_construction=%d, %d levels)\n",
+           now_seconds() - start, HNSW_DEFAULT_M, HNSW_DEFAULT_EF_CONSTRUCTION, index->max_level + 1);
+    
+    const int ef_values[] = { 16, 32, 64, 128, 256, 512 };
+    for (size_t e = 0; e < sizeof(ef_values) / sizeof(ef_values[0]); e++) {
+        int hits = 0;
+        start = now_seconds();
+        for (int q = 0; q < queries; q++) {
+            topk_reset(results);
+            hnsw_search(index, query_set + (size_t)q * dims, ef_values[e], results);
+            topk_finish(results);
+            hits += count_hits(truth[q], results);
+        }
+        double latency_us = (now_seconds() - start) / queries * 1e6;
+        
+        char label[32];
+        snprintf(label, sizeof(label), "hnsw ef=%d", ef_values[e]);
+        printf("%-20s recall@%d %.3f  %10.1f us/query\n", label, BENCH_K,
+               (double)hits / (queries * BENCH_K), latency_us);
+    }
+    
+    topk_destroy(results);
+    for (int q = 0; q < queries; q++) {
+        topk_destroy(truth[q]);
+    }
+    free(truth);
+    free(scores);
+    free(query_set);
+    hnsw_destroy(index);
+    embedding_store_destroy(store);
+    return 0;
+}
@@ -0,0 +1,474 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <strings.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "../include/json_scan.h"
+
+// Stand-in for an Ollama server, for tests and client benchmarks without a
+// model. /api/embeddings and /api/embed answer with vectors seeded by each
+// text, so a text always gets the same vector, after a configurable delay;
+// a configurable share of requests fails with a 500. GET /api/requests
+// reports how many embedding requests have arrived so far.
+//
+//   mock_ollama [--port N] [--dimensions N] [--latency-ms N] [--jitter-ms N]
+//               [--error-rate R] [--seed N] [--daemon --pid-file PATH]
+//   mock_ollama --stop --pid-file PATH
+//
+// With --daemon the server is listening by the time the command returns,
+// which is what a CTest fixture setup needs.
+
+#define MOCK_DEFAULT_PORT 11434
+#define MOCK_DEFAULT_DIMENSIONS 768
+#define MOCK_MAX_HEADER 16384
+
+typedef struct {
+    int port;
+    int dimensions;
+    int latency_ms;
+    int jitter_ms;
+    double error_rate;
+    uint64_t seed;
+    int daemon;
+    int stop;
+    const char* pid_file;
+} MockOptions;
+
+static MockOptions options = {
+    MOCK_DEFAULT_PORT, MOCK_DEFAULT_DIMENSIONS, 0, 0, 0.0, 0, 0, 0, NULL
+};
+
+// Requests answered so far; numbers each request's latency and failure draw
+static uint64_t request_counter = 0;
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} Buffer;
+
+static uint64_t splitmix64(uint64_t* state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1)
+static double random_unit(uint64_t* state) {
+    return (double)(splitmix64(state) >> 11) / 9007199254740992.0;
+}
+
+static int append(Buffer* buffer, const char* text, size_t length) {
+    if (buffer->size + length + 1 > buffer->capacity) {
+        size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+        while (buffer->size + length + 1 > capacity) {
+            capacity *= 2;
+        }
+        char* data = realloc(buffer->data, capacity);
+        if (!data) {
+            return -1;
+        }
+        buffer->data = data;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->size, text, length);
+    buffer->size += length;
+    buffer->data[buffer->size] = '\0';
+    return 0;
+}
+
+static int append_text(Buffer* buffer, const char* text) {
+    return append(buffer, text, strlen(text));
+}
+
+// Past the closing quote of the JSON string at p, NULL if there is none
+static const char* string_end(const char* p, const char* end) {
+    if (p >= end || *p != '"') {
+        return NULL;
+    }
+    for (p++; p < end; p++) {
+        if (*p == '\\') {
+            p++;
+        } else if (*p == '"') {
+            return p + 1;
+        }
+    }
+    return NULL;
+}
+
+// The vector of the JSON string [text, text_end), quotes and escapes
+// included: the client escapes a text the same way on both endpoints
+static int append_vector(Buffer* buffer, const char* text, const char* text_end) {
+    uint64_t state = 0xcbf29ce484222325ULL ^ options.seed;
+    for (const char* p = text; p < text_end; p++) {
+        state ^= (unsigned char)*p;
+        state *= 0x100000001b3ULL;
+    }
+    
+    char number[32];
+    if (append_text(buffer, "[") != 0) {
+        return -1;
+    }
+    for (int i = 0; i < options.dimensions; i++) {
+        int length = snprintf(number, sizeof(number), i == 0 ? "%.6f" : ",%.6f",
+                              random_unit(&state) * 2.0 - 1.0);
+        if (append(buffer, number, (size_t)length) != 0) {
+            return -1;
+        }
+    }
+    return append_text(buffer, "]");
+}
+
+// {"embedding":[...]} for {"model":...,"prompt":"..."}
+static int embeddings_response(const char* body, const char* end, Buffer* out) {
+    const char* prompt = json_find_member(body, end, "prompt");
+    const char* prompt_end = string_end(prompt, end);
+    if (!prompt_end) {
+        return -1;
+    }
+    
+    if (append_text(out, "{\"embedding\":") != 0 ||
+        append_vector(out, prompt, prompt_end) != 0) {
+        return -1;
+    }
+    return append_text(out, "}");
+}
+
+// {"model":...,"embeddings":[[...],...]} for {"model":...,"input":[...]},
+// where input may also be a single string
+static int embed_response(const char* body, const char* end, Buffer* out) {
+    const char* input = json_find_member(body, end, "input");
+    if (!input) {
+        return -1;
+    }
+    
+    if (append_text(out, "{\"model\":\"mock\",\"embeddings\":[") != 0) {
+        return -1;
+    }
+    if (*input == '"') {
+        const char* input_end = string_end(input, end);
+        if (!input_end || append_vector(out, input, input_end) != 0) {
+            return -1;
+        }
+    } else if (*input == '[') {
+        int first = 1;
+        for (const char* element = json_array_first(input, end); element; ) {
+            const char* element_end = string_end(element, end);
+            if (!element_end || (!first && append_text(out, ",") != 0) ||
+                append_vector(out, element, element_end) != 0) {
+                return -1;
+            }
+            first = 0;
+            element = json_array_next(element_end, end);
+        }
+    } else {
+        return -1;
+    }
+    return append_text(out, "]}");
+}
+
+static int write_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t written = write(fd, data, size);
+        if (written <= 0) {
+            return -1;
+        }
+        data += written;
+        size -= (size_t)written;
+    }
+    return 0;
+}
+
+static int send_response(int fd, int status, const char* reason, const char* body, size_t length) {
+    char header[256];
+    int header_length = snprintf(header, sizeof(header),
+                                 "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\n"
+                                 "Content-Length: %zu\r\n\r\n", status, reason, length);
+    if (write_all(fd, header, (size_t)header_length) != 0) {
+        return -1;
+    }
+    return write_all(fd, body, length);
+}
+
+static int handle_request(int fd, const char* method, const char* path,
+                          const char* body, size_t body_length) {
+    if (strcmp(method, "GET") == 0 && strcmp(path, "/api/requests") == 0) {
+        char count[64];
+        int length = snprintf(count, sizeof(count), "{\"requests\":%llu}",
+                              (unsigned long long)__atomic_load_n(&request_counter, __ATOMIC_RELAXED));
+        return send_response(fd, 200, "OK", count, (size_t)length);
+    }
+    if (strcmp(method, "GET") == 0) {
+        const char* running = "\"Ollama is running\"";
+        return send_response(fd, 200, "OK", running, strlen(running));
+    }
+    
+    int embeddings = strcmp(path, "/api/embeddings") == 0;
+    int embed = strcmp(path, "/api/embed") == 0;
+    if (strcmp(method, "POST") != 0 || (!embeddings && !embed)) {
+        const char* missing = "{\"error\":\"not found\"}";
+        return send_response(fd, 404, "Not Found", missing, strlen(missing));
+    }
+    
+    // Delay and failure draws depend only on the seed and request number
+    uint64_t state = options.seed ^ __atomic_fetch_add(&request_counter, 1, __ATOMIC_RELAXED);
+    splitmix64(&state);
+    int delay_ms = options.latency_ms;
+    if (options.jitter_ms > 0) {
+        delay_ms += (int)(random_unit(&state) * (options.jitter_ms + 1));
+    }
+    if (delay_ms > 0) {
+        usleep((useconds_t)delay_ms * 1000);
+    }
+    if (random_unit(&state) < options.error_rate) {
+        const char* failure = "{\"error\":\"injected failure\"}";
+        return send_response(fd, 500, "Internal Server Error", failure, strlen(failure));
+    }
+    
+    Buffer out = {0};
+    const char* end = body + body_length;
+    int status = embeddings ? embeddings_response(body, end, &out) : embed_response(body, end, &out);
+    int result;
+    if (status == 0) {
+        result = send_response(fd, 200, "OK", out.data, out.size);
+    } else {
+        const char* invalid = "{\"error\":\"invalid request\"}";
+        result = send_response(fd, 400, "Bad Request", invalid, strlen(invalid));
+    }
+    free(out.data);
+    return result;
+}
+
+// Value of the header named name in the header block, or NULL
+static const char* find_header(const char* headers, const char* name) {
+    size_t length = strlen(name);
+    for (const char* line = strstr(headers, "\r\n"); line; line = strstr(line + 2, "\r\n")) {
+        if (strncasecmp(line + 2, name, length) == 0 && line[2 + length] == ':') {
+            const char* value = line + 3 + length;
+            while (*value == ' ') {
+                value++;
+            }
+            return value;
+        }
+    }
+    return NULL;
+}
+
+// Requests on one kept-alive connection, until the client closes it
+static void* serve_connection(void* argument) {
+    int fd = (int)(intptr_t)argument;
+    Buffer input = {0};
+    
+    for (;;) {
+        // Read up to the end of the headers
+        char* header_end;
+        while (!input.data || !(header_end = strstr(input.data, "\r\n\r\n"))) {
+            char chunk[4096];
+            ssize_t received = read(fd, chunk, sizeof(chunk));
+            if (received <= 0 || input.size > MOCK_MAX_HEADER ||
+                append(&input, chunk, (size_t)received) != 0) {
+                goto done;
+            }
+        }
+        *header_end = '\0';
+        
+        char method[8] = "";
+        char path[256] = "";
+        if (sscanf(input.data, "%7s %255s", method, path) != 2) {
+            goto done;
+        }
+        const char* content_length = find_header(input.data, "Content-Length");
+        const char* connection = find_header(input.data, "Connection");
+        int keep_alive = !connection || strncasecmp(connection, "close", 5) != 0;
+        size_t body_length = content_length ? strtoul(content_length, NULL, 10) : 0;
+        
+        // Then the body
+        size_t body_start = (size_t)(header_end + 4 - input.data);
+        while (input.size < body_start + body_length) {
+            char chunk[65536];
+            ssize_t received = read(fd, chunk, sizeof(chunk));
+            if (received <= 0 || append(&input, chunk, (size_t)received) != 0) {
+                goto done;
+            }
+        }
+        
+        if (handle_request(fd, method, path, input.data + body_start, body_length) != 0 || !keep_alive) {
+            goto done;
+        }
+        
+        // Keep whatever of the next request has arrived already
+        size_t consumed = body_start + body_length;
+        memmove(input.data, input.data + consumed, input.size - consumed);
+        input.size -= consumed;
+        input.data[input.size] = '\0';
+    }
+
+done:
+    free(input.data);
+    close(fd);
+    return NULL;
+}
+
+static int parse_options(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--daemon") == 0) {
+            options.daemon = 1;
+        } else if (strcmp(argv[i], "--stop") == 0) {
+            options.stop = 1;
+        } else if (!value) {
+            return -1;
+        } else if (strcmp(argv[i], "--port") == 0) {
+            options.port = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--dimensions") == 0) {
+            options.dimensions = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--latency-ms") == 0) {
+            options.latency_ms = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--jitter-ms") == 0) {
+            options.jitter_ms = atoi(value);
+            i++;
+        } else if (strcmp(argv[i], "--error-rate") == 0) {
+            options.error_rate = atof(value);
+            i++;
+        } else if (strcmp(argv[i], "--seed") == 0) {
+            options.seed = strtoull(value, NULL, 10);
+            i++;
+        } else if (strcmp(argv[i], "--pid-file") == 0) {
+            options.pid_file = value;
+            i++;
+        } else {
+            return -1;
+        }
+    }
+    
+    if (options.port <= 0 || options.port > 65535 || options.dimensions <= 0 ||
+        options.latency_ms < 0 || options.jitter_ms < 0 ||
+        ((options.daemon || options.stop) && !options.pid_file)) {
+        return -1;
+    }
+    return 0;
+}
+
+static int stop_server(const char* pid_file) {
+    FILE* file = fopen(pid_file, "r");
+    if (!file) {
+        fprintf(stderr, "No mock server recorded in %s\n", pid_file);
+        return 1;
+    }
+    
+    long pid = 0;
+    int read_pid = fscanf(file, "%ld", &pid);
+    fclose(file);
+    remove(pid_file);
+    if (read_pid != 1 || pid <= 0 || kill((pid_t)pid, SIGTERM) != 0) {
+        fprintf(stderr, "Could not stop mock server %ld\n", pid);
+        return 1;
+    }
+    return 0;
+}
+
+static int open_listener(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons((uint16_t)port);
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 || listen(fd, 128) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Fork into the background once listening; the parent records the child
+// and returns, closing nothing the child still needs
+static int daemonize(const char* pid_file) {
+    pid_t pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid > 0) {
+        FILE* file = fopen(pid_file, "w");
+        if (!file) {
+            kill(pid, SIGTERM);
+            return -1;
+        }
+        fprintf(file, "%ld\n", (long)pid);
+        fclose(file);
+        _exit(0);
+    }
+    
+    // Whoever ran us may wait for our output pipes to close
+    setsid();
+    int null_fd = open("/dev/null", O_RDWR);
+    if (null_fd >= 0) {
+        dup2(null_fd, STDIN_FILENO);
+        dup2(null_fd, STDOUT_FILENO);
+        dup2(null_fd, STDERR_FILENO);
+        if (null_fd > STDERR_FILENO) {
+            close(null_fd);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    if (parse_options(argc, argv) != 0) {
+        fprintf(stderr, "Usage: %s [--port N] [--dimensions N] [--latency-ms N] [--jitter-ms N]\n"
+                        "       [--error-rate R] [--seed N] [--daemon --pid-file PATH]\n"
+                        "       %s --stop --pid-file PATH\n", argv[0], argv[0]);
+        return 2;
+    }
+    if (options.stop) {
+        return stop_server(options.pid_file);
+    }
+    
+    signal(SIGPIPE, SIG_IGN);
+    int listener = open_listener(options.port);
+    if (listener < 0) {
+        fprintf(stderr, "Could not listen on port %d\n", options.port);
+        return 1;
+    }
+    printf("Mock Ollama on http://127.0.0.1:%d (%d dimensions, %d+%d ms, %.0f%% errors)\n",
+           options.port, options.dimensions, options.latency_ms, options.jitter_ms,
+           options.error_rate * 100.0);
+    fflush(stdout);
+    if (options.daemon && daemonize(options.pid_file) != 0) {
+        fprintf(stderr, "Could not start in the background\n");
+        return 1;
+    }
+    
+    for (;;) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        
+        int no_delay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, serve_connection, (void*)(intptr_t)fd) != 0) {
+            close(fd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
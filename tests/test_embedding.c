@@ -2,7 +2,28 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <pthread.h>
 #include "../include/embedding.h"
+#include "../include/embedding_async.h"
+#include "../include/embedding_backend.h"
+#include "../include/embedding_cache.h"
+#include "../include/embedding_lru.h"
+#include "../include/embedding_flight.h"
+#include "../include/json_scan.h"
+#include "../include/embedding_store.h"
+#include "../include/vector_ops.h"
+#include "../include/hnsw.h"
+
+// Ollama to test against: the mock server when run by ctest, else a local one
+static const char* ollama_url(void) {
+    const char* url = getenv("NOVAKEY_OLLAMA_URL");
+    return url ? url : "http://localhost:11434";
+}
 
 void test_ollama_client_create() {
     printf("Testing Ollama client creation...\n");
@@ -13,6 +34,8 @@ void test_ollama_client_create() {
     assert(client->model_name != NULL);
     assert(strcmp(client->base_url, "http://localhost:11434") == 0);
     assert(strcmp(client->model_name, "nomic-embed-text") == 0);
+    assert(strcmp(client->embeddings_url, "http://localhost:11434/api/embeddings") == 0);
+    assert(client->curl != NULL && client->headers != NULL);
     
     printf("✓ Ollama client created successfully\n");
     
@@ -23,7 +46,7 @@ void test_ollama_client_create() {
 void test_embedding_generation() {
     printf("Testing embedding generation...\n");
     
-    OllamaClient* client = ollama_client_create("http://localhost:11434", "nomic-embed-text");
+    OllamaClient* client = ollama_client_create(ollama_url(), "nomic-embed-text");
     assert(client != NULL);
     
     // Test with Japanese text
@@ -50,6 +73,110 @@ void test_embedding_generation() {
     ollama_client_destroy(client);
 }
 
+void test_batch_embedding() {
+    printf("Testing batched embedding generation...\n");
+    
+    OllamaClient* client = ollama_client_create(ollama_url(), "nomic-embed-text");
+    assert(client != NULL);
+    assert(client->batch_size == OLLAMA_DEFAULT_BATCH_SIZE);
+    assert(strstr(client->embed_url, "/api/embed") != NULL);
+    
+    // Five texts over batches of two: the last request carries one text
+    const char* texts[] = { "こんにちは", "東京", "京都", "日本語", "漢字" };
+    client->batch_size = 2;
+    EmbeddingMatrix* matrix = generate_embeddings_batch(client, texts, 5);
+    
+    if (matrix != NULL) {
+        assert(matrix->count == 5);
+        assert(matrix->dimensions > 0);
+        
+        // Each row matches the single-text embedding of the same input
+        for (int i = 0; i < matrix->count; i++) {
+            EmbeddingVector* vector = generate_embedding(client, texts[i]);
+            assert(vector != NULL);
+            assert(vector->dimensions == matrix->dimensions);
+            
+            EmbeddingVector row = { matrix->values + (size_t)i * matrix->dimensions, matrix->dimensions };
+            assert(calculate_cosine_similarity(&row, vector) > 0.999f);
+            free_embedding_vector(vector);
+        }
+        printf("✓ Batched embeddings match single requests: %d x %d\n",
+               matrix->count, matrix->dimensions);
+        free_embedding_matrix(matrix);
+    } else {
+        printf("⚠ Batched embedding failed (possibly Ollama not running)\n");
+    }
+    
+    assert(generate_embeddings_batch(client, texts, 0) == NULL);
+    assert(generate_embeddings_batch(NULL, texts, 5) == NULL);
+    
+    ollama_client_destroy(client);
+}
+
+typedef struct {
+    AsyncEmbeddingClient* client;
+    int completed;
+    int succeeded;
+    int max_in_flight_seen;
+    int dimensions;
+} AsyncResults;
+
+static void count_embedding(const char* text, EmbeddingVector* vector, void* user_data) {
+    AsyncResults* results = user_data;
+    assert(text != NULL);
+    
+    results->completed++;
+    if (results->client->in_flight > results->max_in_flight_seen) {
+        results->max_in_flight_seen = results->client->in_flight;
+    }
+    if (vector) {
+        results->succeeded++;
+        results->dimensions = vector->dimensions;
+        free_embedding_vector(vector);
+    }
+}
+
+void test_async_embedding() {
+    printf("Testing asynchronous embedding requests...\n");
+    
+    AsyncEmbeddingClient* client = async_embedding_client_create(ollama_url(),
+                                                                 "nomic-embed-text", 2);
+    assert(client != NULL);
+    assert(client->max_in_flight == 2);
+    
+    // Five submissions over two slots: three wait in the queue
+    const char* texts[] = { "こんにちは", "東京", "京都", "日本語", "漢字" };
+    AsyncResults results = { client, 0, 0, 0, 0 };
+    for (int i = 0; i < 5; i++) {
+        assert(async_embedding_submit(client, texts[i], count_embedding, &results) == 0);
+    }
+    assert(client->in_flight == 2);
+    assert(async_embedding_pending(client) == 5);
+    assert(async_embedding_submit(client, NULL, count_embedding, &results) == -1);
+    
+    while (async_embedding_pending(client) > 0) {
+        assert(async_embedding_wait(client, 100) >= 0);
+    }
+    assert(results.completed == 5);
+    assert(results.max_in_flight_seen <= 2);
+    
+    if (results.succeeded == 5) {
+        printf("✓ Five embeddings over two slots: %d dimensions\n", results.dimensions);
+    } else {
+        printf("⚠ Asynchronous embedding failed (possibly Ollama not running)\n");
+    }
+    
+    // Destroying the client cancels what is still outstanding
+    AsyncResults cancelled = { client, 0, 0, 0, 0 };
+    assert(async_embedding_submit(client, texts[0], count_embedding, &cancelled) == 0);
+    assert(async_embedding_submit(client, texts[1], count_embedding, &cancelled) == 0);
+    assert(async_embedding_submit(client, texts[2], count_embedding, &cancelled) == 0);
+    async_embedding_client_destroy(client);
+    assert(cancelled.completed == 3);
+    assert(cancelled.succeeded == 0);
+    printf("✓ Outstanding requests cancelled on destroy\n");
+}
+
 void test_cosine_similarity() {
     printf("Testing cosine similarity calculation...\n");
     
@@ -90,7 +217,7 @@ void test_cosine_similarity() {
 void test_embedding_comparison() {
     printf("Testing embedding comparison with real data...\n");
     
-    OllamaClient* client = ollama_client_create("http://localhost:11434", "nomic-embed-text");
+    OllamaClient* client = ollama_client_create(ollama_url(), "nomic-embed-text");
     if (!client) {
         printf("⚠ Cannot create Ollama client\n");
         return;
@@ -125,12 +252,1330 @@ void test_embedding_comparison() {
     ollama_client_destroy(client);
 }
 
+void test_vector_kernels() {
+    printf("Testing vector kernels (default: %s)...\n", vector_kernel_name());
+    
+    const int lengths[] = { 1, 3, 15, 16, 17, 33, 100, 768 };
+    const int length_count = sizeof(lengths) / sizeof(lengths[0]);
+    float* a = malloc(sizeof(float) * 768);
+    float* b = malloc(sizeof(float) * 768);
+    assert(a && b);
+    
+    srand(7);
+    for (int i = 0; i < 768; i++) {
+        a[i] = (float)rand() / RAND_MAX - 0.5f;
+        b[i] = (float)rand() / RAND_MAX - 0.5f;
+    }
+    
+    const char* default_kernel = vector_kernel_name();
+    for (int k = 0; k < vector_kernel_count(); k++) {
+        const char* name = vector_kernel_name_at(k);
+        assert(vector_use_kernel(name) == 0);
+        
+        for (int l = 0; l < length_count; l++) {
+            double expected = 0.0;
+            for (int i = 0; i < lengths[l]; i++) {
+                expected += (double)a[i] * b[i];
+            }
+            float actual = vector_dot(a, b, lengths[l]);
+            assert(actual - expected < 1e-4 && expected - actual < 1e-4);
+        }
+        printf("✓ %s kernel matches the reference dot product\n", name);
+    }
+    assert(vector_use_kernel(default_kernel) == 0);
+    
+    // Normalized vectors: cosine similarity reduces to the dot product
+    EmbeddingVector va = { a, 768 };
+    EmbeddingVector vb = { b, 768 };
+    float cosine = calculate_cosine_similarity(&va, &vb);
+    normalize_embedding_vector(&va);
+    normalize_embedding_vector(&vb);
+    float normalized = calculate_normalized_similarity(&va, &vb);
+    assert(cosine - normalized < 1e-5f && normalized - cosine < 1e-5f);
+    printf("✓ Pre-normalized similarity matches cosine similarity\n");
+    
+    free(a);
+    free(b);
+}
+
+void test_request_bodies() {
+    printf("Testing request body serialization...\n");
+    
+    RequestBuffer buffer = {0};
+    assert(write_embedding_request(&buffer, "nomic-embed-text", "東京\"駅\"\\\n\t\x01") == 0);
+    assert(strcmp(buffer.data,
+                  "{\"model\":\"nomic-embed-text\",\"prompt\":\"東京\\\"駅\\\"\\\\\\n\\t\\u0001\"}") == 0);
+    assert(buffer.size == strlen(buffer.data));
+    printf("✓ Prompt escaped: %s\n", buffer.data);
+    
+    // The buffer is rewritten in place, not reallocated
+    char* data = buffer.data;
+    assert(write_embedding_request(&buffer, "m", "a") == 0);
+    assert(buffer.data == data && strcmp(buffer.data, "{\"model\":\"m\",\"prompt\":\"a\"}") == 0);
+    
+    const char* texts[] = { "東京", NULL, "x\"y" };
+    assert(write_batch_request(&buffer, "m", texts, 3) == 0);
+    assert(strcmp(buffer.data, "{\"model\":\"m\",\"input\":[\"東京\",\"\",\"x\\\"y\"]}") == 0);
+    assert(write_batch_request(&buffer, "m", texts, 0) == 0);
+    assert(strcmp(buffer.data, "{\"model\":\"m\",\"input\":[]}") == 0);
+    printf("✓ Batch bodies written compactly into the same buffer\n");
+    
+    free_request_buffer(&buffer);
+    assert(buffer.data == NULL && buffer.capacity == 0);
+}
+
+static EmbeddingVector* parse_body(const char* body) {
+    HttpResponse response = { (char*)body, strlen(body), 0 };
+    return parse_embedding_response(&response);
+}
+
+void test_response_parsing() {
+    printf("Testing streaming response parsing...\n");
+    
+    // Members before the embedding are skipped, brackets in strings included
+    EmbeddingVector* vector = parse_body(
+        "{\"model\":\"a \\\"[]{}\\\" b\",\"nested\":{\"x\":[1,{\"y\":\"]\"}],\"z\":null},"
+        " \"embedding\" : [0.5, -1.25e-3,3E2 ,0,-0.0,\n1.5e+1, 12345678901234567890]}");
+    assert(vector != NULL && vector->dimensions == 7);
+    assert(vector->values[0] == 0.5f && vector->values[1] == -1.25e-3f);
+    assert(vector->values[2] == 300.0f && vector->values[3] == 0.0f);
+    assert(vector->values[5] == 15.0f && vector->values[6] == 12345678901234567890.0f);
+    free_embedding_vector(vector);
+    
+    assert(parse_body("{\"embedding\":[]}") == NULL);
+    assert(parse_body("{\"embedding\":[1,2,") == NULL);
+    assert(parse_body("{\"embedding\":[1,,2]}") == NULL);
+    assert(parse_body("{\"embedding\":[1,\"2\"]}") == NULL);
+    assert(parse_body("{\"embeddings\":[[1,2]]}") == NULL);
+    assert(parse_body("404 page not found") == NULL);
+    printf("✓ Embedding found past other members, malformed arrays rejected\n");
+    
+    // Printed with enough digits, every float comes back within one ulp
+    srand(5);
+    int count = 1000;
+    float* expected = malloc(sizeof(float) * count);
+    char* body = malloc((size_t)count * 24 + 32);
+    char* cursor = body + sprintf(body, "{\"embedding\":[");
+    for (int i = 0; i < count; i++) {
+        expected[i] = ((float)rand() / RAND_MAX - 0.5f) * powf(10.0f, (float)(rand() % 9 - 6));
+        cursor += sprintf(cursor, i ? ",%.9g" : "%.9g", expected[i]);
+    }
+    strcpy(cursor, "]}");
+    
+    vector = parse_body(body);
+    assert(vector != NULL && vector->dimensions == count);
+    for (int i = 0; i < count; i++) {
+        float ulp = nextafterf(fabsf(expected[i]), INFINITY) - fabsf(expected[i]);
+        assert(fabsf(vector->values[i] - expected[i]) <= ulp);
+    }
+    free_embedding_vector(vector);
+    free(body);
+    free(expected);
+    printf("✓ %d random floats parsed to within one ulp\n", count);
+    
+    // Batch responses hold one array per text
+    const char* batch = "{\"model\":\"m\",\"embeddings\":[[1,2],[3,4] ,[5,6]],\"total_duration\":5}";
+    const char* end = batch + strlen(batch);
+    const char* row = json_array_first(json_find_member(batch, end, "embeddings"), end);
+    float values[2];
+    int rows = 0;
+    while (row) {
+        assert(json_count_floats(row, end) == 2);
+        row = json_read_floats(row, end, values, 2);
+        assert(row != NULL && values[1] == 2.0f * (rows + 1));
+        rows++;
+        row = json_array_next(row, end);
+    }
+    assert(rows == 3);
+    printf("✓ Batch response rows read in place\n");
+}
+
+void test_ngram_backend() {
+    printf("Testing n-gram embedding backend...\n");
+    
+    EmbeddingBackend* backend = embedding_backend_create("ngram", NULL, NULL, NULL);
+    assert(backend != NULL);
+    assert(strcmp(backend->ops->name, "ngram") == 0);
+    assert(embedding_backend_dimensions(backend) == NGRAM_DEFAULT_DIMENSIONS);
+    assert(embedding_backend_ollama_client(backend) == NULL);
+    assert(embedding_backend_create("word2vec", NULL, NULL, NULL) == NULL);
+    
+    EmbeddingVector* hiragana = embedding_backend_embed(backend, "きょうと", EMBEDDING_NO_DEADLINE);
+    EmbeddingVector* katakana = embedding_backend_embed(backend, "キョウト", EMBEDDING_NO_DEADLINE);
+    EmbeddingVector* near = embedding_backend_embed(backend, "きょう", EMBEDDING_NO_DEADLINE);
+    EmbeddingVector* far = embedding_backend_embed(backend, "ありがとう", EMBEDDING_NO_DEADLINE);
+    assert(hiragana && katakana && near && far);
+    assert(hiragana->dimensions == NGRAM_DEFAULT_DIMENSIONS);
+    assert(fabsf(vector_norm(hiragana->values, hiragana->dimensions) - 1.0f) < 1e-5f);
+    
+    // Katakana folds to hiragana; shared n-grams raise the similarity
+    assert(memcmp(hiragana->values, katakana->values, sizeof(float) * hiragana->dimensions) == 0);
+    float near_score = vector_dot(hiragana->values, near->values, hiragana->dimensions);
+    float far_score = vector_dot(hiragana->values, far->values, hiragana->dimensions);
+    assert(near_score > 0.5f && near_score > far_score + 0.3f);
+    printf("✓ Similarity to きょう %.3f, to ありがとう %.3f\n", near_score, far_score);
+    
+    // Batch rows match single embeddings
+    const char* texts[] = { "きょうと", "ありがとう", "" };
+    EmbeddingMatrix* matrix = embedding_backend_embed_batch(backend, texts, 3, EMBEDDING_NO_DEADLINE);
+    assert(matrix && matrix->count == 3 && matrix->dimensions == hiragana->dimensions);
+    assert(memcmp(matrix->values, hiragana->values, sizeof(float) * matrix->dimensions) == 0);
+    assert(memcmp(matrix->values + matrix->dimensions, far->values,
+                  sizeof(float) * matrix->dimensions) == 0);
+    printf("✓ Batch rows match single embeddings\n");
+    
+    free_embedding_matrix(matrix);
+    free_embedding_vector(hiragana);
+    free_embedding_vector(katakana);
+    free_embedding_vector(near);
+    free_embedding_vector(far);
+    embedding_backend_destroy(backend);
+    
+    // An Ollama backend takes over its client and learns its dimensions late
+    OllamaClient* client = ollama_client_create("http://127.0.0.1:9", "nomic-embed-text");
+    backend = embedding_backend_create_ollama(client);
+    assert(backend != NULL && embedding_backend_ollama_client(backend) == client);
+    assert(strcmp(backend->model_name, "nomic-embed-text") == 0);
+    assert(embedding_backend_dimensions(backend) == 0);
+    embedding_backend_destroy(backend);
+    printf("✓ Ollama backend wraps its client\n");
+    
+    // A backend created by kind applies its settings to the client, and
+    // opens the client's caches and closes them
+    EmbeddingBackendSettings settings = {
+        .cache_dir = "test_backend_cache",
+        .cache_max_bytes = 4096,
+        .memory_cache_bytes = 1u << 20,
+        .batch_size = 16,
+        .breaker_cooldown_ms = 2500
+    };
+    backend = embedding_backend_create("ollama", "http://127.0.0.1:9", "nomic-embed-text", &settings);
+    assert(backend != NULL && backend->cache != NULL && backend->memory_cache != NULL);
+    client = embedding_backend_ollama_client(backend);
+    assert(client->cache == backend->cache && client->memory_cache == backend->memory_cache);
+    assert(backend->cache->max_bytes == 4096 && backend->memory_cache->budget == 1u << 20);
+    assert(client->batch_size == 16 && backend->batch_size == 16);
+    assert(client->breaker.cooldown_ms == 2500);
+    embedding_backend_destroy(backend);
+    remove("test_backend_cache/embeddings.cache");
+    rmdir("test_backend_cache");
+    printf("✓ Ollama backend takes its settings and opens its caches\n");
+    
+    // Without settings it keeps the client's defaults and has no caches
+    backend = embedding_backend_create("ollama", "http://127.0.0.1:9", "nomic-embed-text", NULL);
+    assert(backend != NULL && backend->cache == NULL && backend->memory_cache == NULL);
+    client = embedding_backend_ollama_client(backend);
+    assert(client->batch_size == OLLAMA_DEFAULT_BATCH_SIZE);
+    assert(client->breaker.cooldown_ms == CIRCUIT_BREAKER_DEFAULT_COOLDOWN_MS);
+    embedding_backend_destroy(backend);
+}
+
+void test_embedding_store_roundtrip() {
+    printf("Testing embedding store save/load...\n");
+    
+    const char* path = "test_embedding_store.emb";
+    EmbeddingStore* store = embedding_store_create("nomic-embed-text", 0x1234ULL, 3, 4);
+    assert(store != NULL);
+    
+    for (int i = 0; i < 3 * 4; i++) {
+        embedding_store_mutable_row(store, i / 4)[i % 4] = (float)i * 0.5f;
+    }
+    assert(embedding_store_save(store, path) == 0);
+    
+    EmbeddingStore* loaded = embedding_store_load(path, "nomic-embed-text", 0x1234ULL, 3);
+    assert(loaded != NULL);
+    assert(loaded->dimensions == 4);
+    assert(embedding_store_row(loaded, 2)[3] == 5.5f);
+    assert(embedding_store_row(loaded, 3) == NULL);
+    printf("✓ Embedding store round trip preserved %d rows\n", loaded->entry_count);
+    
+    // Stores from another model or dictionary revision must be rejected
+    assert(embedding_store_load(path, "other-model", 0x1234ULL, 3) == NULL);
+    assert(embedding_store_load(path, "nomic-embed-text", 0x9999ULL, 3) == NULL);
+    printf("✓ Stale embedding stores rejected\n");
+    
+    embedding_store_destroy(loaded);
+    embedding_store_destroy(store);
+    remove(path);
+}
+
+void test_embedding_cache() {
+    printf("Testing persistent embedding cache...\n");
+    
+    const char* directory = "test_embedding_cache";
+    const char* path = "test_embedding_cache/embeddings.cache";
+    remove(path);
+    
+    float values[8];
+    for (int i = 0; i < 8; i++) {
+        values[i] = (float)i * 0.25f;
+    }
+    
+    EmbeddingCache* cache = embedding_cache_open(directory, 0);
+    assert(cache != NULL);
+    assert(embedding_cache_put(cache, "nomic-embed-text", "東京", values, 8) == 0);
+    assert(embedding_cache_put(cache, "nomic-embed-text", "京都", values + 4, 4) == 0);
+    
+    int dimensions = 0;
+    const float* cached = embedding_cache_get(cache, "nomic-embed-text", "東京", &dimensions);
+    assert(cached != NULL && dimensions == 8 && cached[7] == 1.75f);
+    assert(embedding_cache_get(cache, "other-model", "東京", NULL) == NULL);
+    assert(embedding_cache_get(cache, "nomic-embed-text", "大阪", NULL) == NULL);
+    embedding_cache_close(cache);
+    
+    // A record torn by a crash is cut off, the ones before it survive
+    struct stat st;
+    assert(stat(path, &st) == 0);
+    FILE* file = fopen(path, "ab");
+    assert(file != NULL);
+    fwrite(values, 1, 20, file);
+    fclose(file);
+    
+    cache = embedding_cache_open(directory, 0);
+    assert(cache != NULL);
+    assert(embedding_cache_open(directory, 0) == NULL);
+    assert(cache->entry_count == 2);
+    assert(cache->size == (size_t)st.st_size);
+    cached = embedding_cache_get(cache, "nomic-embed-text", "京都", &dimensions);
+    assert(cached != NULL && dimensions == 4 && cached[0] == 1.0f);
+    printf("✓ Cache entries survive a reopen and a torn record, a second open fails\n");
+    
+    // A generating client never reaches the network for cached text
+    OllamaClient* client = ollama_client_create("http://127.0.0.1:9", "nomic-embed-text");
+    assert(client != NULL);
+    client->cache = cache;
+    EmbeddingVector* vector = generate_embedding(client, "東京");
+    assert(vector != NULL && vector->dimensions == 8 && vector->values[1] == 0.25f);
+    free_embedding_vector(vector);
+    
+    const char* texts[] = { "東京", "東京" };
+    EmbeddingMatrix* matrix = generate_embeddings_batch(client, texts, 2);
+    assert(matrix != NULL && matrix->dimensions == 8 && matrix->values[15] == 1.75f);
+    free_embedding_matrix(matrix);
+    ollama_client_destroy(client);
+    embedding_cache_close(cache);
+    printf("✓ Cached embeddings served without a request\n");
+    
+    // Past the cap the oldest records are compacted away
+    cache = embedding_cache_open(directory, 4096);
+    assert(cache != NULL);
+    char text[32];
+    for (int i = 0; i < 100; i++) {
+        snprintf(text, sizeof(text), "text %d", i);
+        assert(embedding_cache_put(cache, "nomic-embed-text", text, values, 8) == 0);
+        assert(cache->size <= 4096);
+    }
+    assert(embedding_cache_get(cache, "nomic-embed-text", "text 99", NULL) != NULL);
+    assert(embedding_cache_get(cache, "nomic-embed-text", "text 0", NULL) == NULL);
+    assert(embedding_cache_get(cache, "nomic-embed-text", "東京", NULL) == NULL);
+    size_t entries = cache->entry_count;
+    embedding_cache_close(cache);
+    
+    cache = embedding_cache_open(directory, 4096);
+    assert(cache != NULL && cache->entry_count == entries);
+    embedding_cache_close(cache);
+    printf("✓ Cache compacted to %zu newest entries under its cap\n", entries);
+    
+    remove(path);
+    rmdir(directory);
+}
+
+typedef struct {
+    EmbeddingLru* lru;
+    int seed;
+} LruWorker;
+
+// Each key's vector holds its own number, so any mix-up shows
+static void* hammer_lru(void* argument) {
+    LruWorker* worker = argument;
+    char text[32];
+    float values[16];
+    
+    for (int i = 0; i < 20000; i++) {
+        int key = (i * 7 + worker->seed) % 300;
+        snprintf(text, sizeof(text), "reading %d", key);
+        const EmbeddingVector* vector = embedding_lru_get(worker->lru, text);
+        if (!vector) {
+            for (int d = 0; d < 16; d++) {
+                values[d] = (float)key;
+            }
+            vector = embedding_lru_put(worker->lru, text, values, 16);
+        }
+        assert(vector != NULL && vector->values[15] == (float)key);
+        embedding_lru_release(vector);
+    }
+    return NULL;
+}
+
+void test_embedding_lru() {
+    printf("Testing in-memory embedding LRU...\n");
+    
+    float values[4] = { 1.0f, 2.0f, 3.0f, 4.0f };
+    EmbeddingLru* lru = embedding_lru_create(0);
+    assert(lru != NULL);
+    assert(embedding_lru_get(lru, "東京") == NULL);
+    
+    const EmbeddingVector* stored = embedding_lru_put(lru, "東京", values, 4);
+    const EmbeddingVector* hit = embedding_lru_get(lru, "東京");
+    assert(stored != NULL && hit == stored);
+    assert(hit->dimensions == 4 && hit->values[3] == 4.0f);
+    embedding_lru_release(stored);
+    embedding_lru_release(hit);
+    
+    EmbeddingLruStats stats;
+    embedding_lru_stats(lru, &stats);
+    assert(stats.hits == 1 && stats.misses == 1 && stats.entries == 1 && stats.evictions == 0);
+    embedding_lru_destroy(lru);
+    printf("✓ Hits return the stored vector itself\n");
+    
+    // A small budget evicts, while a borrowed vector outlives its eviction
+    lru = embedding_lru_create(EMBEDDING_LRU_SHARDS * 1024);
+    assert(lru != NULL);
+    const EmbeddingVector* borrowed = embedding_lru_put(lru, "reading 0", values, 4);
+    char text[32];
+    for (int i = 1; i < 2000; i++) {
+        snprintf(text, sizeof(text), "reading %d", i);
+        embedding_lru_release(embedding_lru_put(lru, text, values, 4));
+    }
+    embedding_lru_stats(lru, &stats);
+    assert(stats.bytes <= EMBEDDING_LRU_SHARDS * 1024);
+    assert(stats.evictions > 0 && stats.entries + stats.evictions == 2000);
+    assert(embedding_lru_get(lru, "reading 0") == NULL);
+    const EmbeddingVector* newest = embedding_lru_get(lru, "reading 1999");
+    assert(newest != NULL);
+    assert(borrowed->values[0] == 1.0f);
+    embedding_lru_release(borrowed);
+    embedding_lru_release(newest);
+    embedding_lru_destroy(lru);
+    printf("✓ Budget of %d bytes held over 2000 puts (%llu evictions)\n",
+           EMBEDDING_LRU_SHARDS * 1024, (unsigned long long)stats.evictions);
+    
+    // Concurrent lookups, puts and evictions over overlapping keys
+    lru = embedding_lru_create(EMBEDDING_LRU_SHARDS * 2048);
+    assert(lru != NULL);
+    pthread_t threads[4];
+    LruWorker workers[4];
+    for (int t = 0; t < 4; t++) {
+        workers[t].lru = lru;
+        workers[t].seed = t * 13;
+        pthread_create(&threads[t], NULL, hammer_lru, &workers[t]);
+    }
+    for (int t = 0; t < 4; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    embedding_lru_stats(lru, &stats);
+    assert(stats.hits + stats.misses == 4 * 20000);
+    printf("✓ 4 threads: %llu hits, %llu misses, %llu evictions\n",
+           (unsigned long long)stats.hits, (unsigned long long)stats.misses,
+           (unsigned long long)stats.evictions);
+    
+    // The client serves recently used text from memory, without a request
+    OllamaClient* client = ollama_client_create("http://127.0.0.1:9", "nomic-embed-text");
+    assert(client != NULL);
+    client->memory_cache = lru;
+    embedding_lru_release(embedding_lru_put(lru, "京都", values, 4));
+    const EmbeddingVector* shared = acquire_embedding(client, "京都");
+    assert(shared != NULL && shared == acquire_embedding(client, "京都"));
+    release_embedding(client, shared);
+    release_embedding(client, shared);
+    EmbeddingVector* owned = generate_embedding(client, "京都");
+    assert(owned != NULL && owned->values != shared->values && owned->values[2] == 3.0f);
+    free_embedding_vector(owned);
+    ollama_client_destroy(client);
+    embedding_lru_destroy(lru);
+    printf("✓ Client lookups served from the memory cache\n");
+}
+
+// Listening socket on a free loopback port that never answers, so requests
+// connect and then stall
+static int open_silent_server(int* port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in address = {0};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (fd < 0 || bind(fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+        listen(fd, 16) != 0 || getsockname(fd, (struct sockaddr*)&address, &length) != 0) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    *port = ntohs(address.sin_port);
+    return fd;
+}
+
+void test_deadlines_and_circuit_breaker() {
+    printf("Testing request deadlines and circuit breaker...\n");
+    
+    // Opens after the threshold of failures, slow successes included
+    CircuitBreaker breaker;
+    circuit_breaker_init(&breaker, 3, 100, 1000);
+    assert(circuit_breaker_allow(&breaker, 0));
+    circuit_breaker_record(&breaker, 0, 5, 10);
+    circuit_breaker_record(&breaker, 1, 5, 20);
+    circuit_breaker_record(&breaker, 0, 5, 30);
+    circuit_breaker_record(&breaker, 1, 500, 40);
+    assert(breaker.state == CircuitClosed && breaker.consecutive_failures == 2);
+    circuit_breaker_record(&breaker, 0, 5, 50);
+    assert(breaker.state == CircuitOpen && breaker.trips == 1);
+    assert(!circuit_breaker_allow(&breaker, 1049));
+    
+    // After the cool-down one trial goes through; a failure reopens
+    assert(circuit_breaker_allow(&breaker, 1050));
+    assert(breaker.state == CircuitHalfOpen && !circuit_breaker_allow(&breaker, 1051));
+    circuit_breaker_record(&breaker, 0, 5, 1060);
+    assert(breaker.state == CircuitOpen && breaker.trips == 2);
+    assert(!circuit_breaker_allow(&breaker, 2000) && circuit_breaker_allow(&breaker, 2060));
+    
+    // A trial given up without a verdict goes to the next caller
+    circuit_breaker_release(&breaker);
+    assert(breaker.state == CircuitOpen && breaker.trips == 2);
+    assert(circuit_breaker_allow(&breaker, 2061) && breaker.state == CircuitHalfOpen);
+    circuit_breaker_record(&breaker, 1, 5, 2070);
+    assert(breaker.state == CircuitClosed && breaker.consecutive_failures == 0);
+    printf("✓ Breaker opens, cools down, probes and closes\n");
+    
+    int port;
+    int server = open_silent_server(&port);
+    if (server < 0) {
+        printf("⚠ Could not open a loopback socket, skipping client checks\n");
+        return;
+    }
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d", port);
+    OllamaClient* client = ollama_client_create(url, "nomic-embed-text");
+    assert(client != NULL);
+    
+    // A stalled server costs the deadline, not the 30 s default timeout
+    uint64_t start = embedding_clock_ms();
+    assert(generate_embedding_until(client, "東京", embedding_deadline_in(100)) == NULL);
+    uint64_t elapsed = embedding_clock_ms() - start;
+    assert(elapsed >= 90 && elapsed < 2000);
+    printf("✓ Stalled request abandoned after %llu ms\n", (unsigned long long)elapsed);
+    
+    // Neither that nor a deadline already passed is held against Ollama
+    assert(generate_embedding_until(client, "東京", embedding_clock_ms()) == NULL);
+    assert(client->breaker.consecutive_failures == 0);
+    
+    // Deadlines that run out past the slow threshold count as slow calls;
+    // once open, calls fail at once without touching the network
+    client->breaker.slow_threshold_ms = 50;
+    while (client->breaker.state == CircuitClosed) {
+        assert(generate_embedding_until(client, "東京", embedding_deadline_in(100)) == NULL);
+    }
+    start = embedding_clock_ms();
+    for (int i = 0; i < 100; i++) {
+        assert(generate_embedding_until(client, "京都", embedding_deadline_in(100)) == NULL);
+    }
+    elapsed = embedding_clock_ms() - start;
+    assert(elapsed < 50);
+    printf("✓ 100 calls with the circuit open took %llu ms\n", (unsigned long long)elapsed);
+    
+    ollama_client_destroy(client);
+    close(server);
+}
+
+void test_deadline_shorter_than_latency() {
+    printf("Testing deadlines shorter than Ollama's latency...\n");
+    
+    // A mock answering in 400 ms: slower than a keystroke's budget, yet
+    // under the breaker's slow threshold
+    const char* url = getenv("NOVAKEY_SLOW_OLLAMA_URL");
+    if (!url) {
+        printf("⚠ NOVAKEY_SLOW_OLLAMA_URL not set, skipping test\n");
+        return;
+    }
+    OllamaClient* client = ollama_client_create(url, "nomic-embed-text");
+    assert(client != NULL);
+    
+    // Each call gives up at its deadline without counting as a failure
+    for (int i = 0; i < 2 * CIRCUIT_BREAKER_DEFAULT_FAILURES; i++) {
+        char text[32];
+        snprintf(text, sizeof(text), "text %d", i);
+        uint64_t start = embedding_clock_ms();
+        assert(generate_embedding_until(client, text, embedding_deadline_in(200)) == NULL);
+        assert(embedding_clock_ms() - start < 400);
+    }
+    assert(client->breaker.state == CircuitClosed);
+    assert(client->breaker.consecutive_failures == 0 && client->breaker.trips == 0);
+    printf("✓ %d calls cut off by a 200 ms deadline leave the circuit closed\n",
+           2 * CIRCUIT_BREAKER_DEFAULT_FAILURES);
+    
+    // So a caller with time to wait still reaches Ollama
+    EmbeddingVector* vector = generate_embedding_until(client, "東京", embedding_deadline_in(2000));
+    assert(vector != NULL && vector->dimensions > 0);
+    free_embedding_vector(vector);
+    printf("✓ A call with a longer deadline gets its embedding\n");
+    
+    ollama_client_destroy(client);
+}
+
+typedef struct {
+    EmbeddingFlightGroup* group;
+    uint64_t wait_for_followers;    // Hold the fetch until this many have joined
+    int fail;
+    int fetches;
+} FlightServer;
+
+static EmbeddingVector* slow_fetch(void* context, const char* text) {
+    FlightServer* server = context;
+    __atomic_add_fetch(&server->fetches, 1, __ATOMIC_RELAXED);
+    
+    uint64_t give_up = embedding_deadline_in(2000);
+    for (;;) {
+        pthread_mutex_lock(&server->group->lock);
+        uint64_t coalesced = server->group->coalesced;
+        pthread_mutex_unlock(&server->group->lock);
+        if (coalesced >= server->wait_for_followers || embedding_clock_ms() > give_up) {
+            break;
+        }
+        usleep(1000);
+    }
+    if (server->fail) {
+        return NULL;
+    }
+    
+    EmbeddingVector* vector = malloc(sizeof(EmbeddingVector));
+    vector->dimensions = 4;
+    vector->values = malloc(sizeof(float) * 4);
+    for (int d = 0; d < 4; d++) {
+        vector->values[d] = (float)strlen(text) + d;
+    }
+    return vector;
+}
+
+typedef struct {
+    FlightServer* server;
+    const char* text;
+    uint64_t deadline_ms;
+    EmbeddingVector* vector;
+} FlightCaller;
+
+static void* call_flight(void* argument) {
+    FlightCaller* caller = argument;
+    caller->vector = embedding_flight_do(caller->server->group, "nomic-embed-text", caller->text,
+                                         caller->deadline_ms, slow_fetch, caller->server);
+    return NULL;
+}
+
+void test_single_flight() {
+    printf("Testing single-flight request coalescing...\n");
+    
+    EmbeddingFlightGroup* group = embedding_flight_group_create();
+    assert(group != NULL);
+    
+    // Eight callers for one text share a single fetch
+    FlightServer server = { group, 7, 0, 0 };
+    pthread_t threads[8];
+    FlightCaller callers[8];
+    for (int t = 0; t < 8; t++) {
+        callers[t] = (FlightCaller){ &server, "東京", EMBEDDING_NO_DEADLINE, NULL };
+        pthread_create(&threads[t], NULL, call_flight, &callers[t]);
+    }
+    for (int t = 0; t < 8; t++) {
+        pthread_join(threads[t], NULL);
+    }
+    assert(server.fetches == 1 && group->fetches == 1 && group->coalesced == 7);
+    for (int t = 0; t < 8; t++) {
+        assert(callers[t].vector != NULL && callers[t].vector->values[3] == 9.0f);
+        for (int u = 0; u < t; u++) {
+            assert(callers[t].vector->values != callers[u].vector->values);
+        }
+    }
+    for (int t = 0; t < 8; t++) {
+        free_embedding_vector(callers[t].vector);
+    }
+    assert(group->flights == NULL);
+    printf("✓ 8 concurrent callers, 1 fetch\n");
+    
+    // Once landed, the next caller fetches again; so do other texts
+    server = (FlightServer){ group, 0, 0, 0 };
+    EmbeddingVector* vector = embedding_flight_do(group, "nomic-embed-text", "東京",
+                                                  EMBEDDING_NO_DEADLINE, slow_fetch, &server);
+    free_embedding_vector(vector);
+    vector = embedding_flight_do(group, "nomic-embed-text", "京都",
+                                 EMBEDDING_NO_DEADLINE, slow_fetch, &server);
+    free_embedding_vector(vector);
+    assert(server.fetches == 2 && group->coalesced == 7);
+    
+    // A follower gives up at its deadline while the fetch goes on, and a
+    // failed fetch fails its followers too
+    server = (FlightServer){ group, 9, 1, 0 };
+    FlightCaller leader = { &server, "大阪", EMBEDDING_NO_DEADLINE, NULL };
+    pthread_create(&threads[0], NULL, call_flight, &leader);
+    while (__atomic_load_n(&server.fetches, __ATOMIC_RELAXED) == 0) {
+        usleep(1000);
+    }
+    FlightCaller impatient = { &server, "大阪", embedding_deadline_in(50), NULL };
+    uint64_t start = embedding_clock_ms();
+    call_flight(&impatient);
+    uint64_t waited = embedding_clock_ms() - start;
+    assert(impatient.vector == NULL && waited >= 40 && waited < 1000);
+    
+    FlightCaller patient = { &server, "大阪", EMBEDDING_NO_DEADLINE, NULL };
+    pthread_create(&threads[1], NULL, call_flight, &patient);
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+    assert(leader.vector == NULL && patient.vector == NULL && server.fetches == 1);
+    printf("✓ Follower left after %llu ms; failure shared\n", (unsigned long long)waited);
+    
+    embedding_flight_group_destroy(group);
+}
+
+// Embedding requests the mock at url has received so far, or -1
+static long mock_request_count(const char* url) {
+    char* requests_url = build_url(url, "/api/requests");
+    CURL* curl = curl_easy_init();
+    HttpResponse response = {0};
+    long count = -1;
+    curl_easy_setopt(curl, CURLOPT_URL, requests_url);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    if (curl_easy_perform(curl) == CURLE_OK && response.data) {
+        const char* field = strstr(response.data, "\"requests\":");
+        if (field) {
+            count = strtol(field + strlen("\"requests\":"), NULL, 10);
+        }
+    }
+    curl_easy_cleanup(curl);
+    free(response.data);
+    free(requests_url);
+    return count;
+}
+
+typedef struct {
+    EmbeddingBackend* backend;
+    const char* text;
+    EmbeddingVector* vector;
+} BackendCaller;
+
+static void* call_backend(void* argument) {
+    BackendCaller* caller = argument;
+    caller->vector = embedding_backend_embed(caller->backend, caller->text, EMBEDDING_NO_DEADLINE);
+    return NULL;
+}
+
+void test_shared_flight_group() {
+    printf("Testing backends sharing a flight group...\n");
+    
+    // The 400 ms mock keeps the first request out while the second joins it
+    const char* url = getenv("NOVAKEY_SLOW_OLLAMA_URL");
+    if (!url) {
+        printf("⚠ NOVAKEY_SLOW_OLLAMA_URL not set, skipping test\n");
+        return;
+    }
+    EmbeddingFlightGroup* group = embedding_flight_group_create();
+    assert(group != NULL);
+    EmbeddingBackendSettings settings = { .memory_cache_bytes = 1u << 20, .flights = group };
+    EmbeddingBackend* first = embedding_backend_create("ollama", url, "nomic-embed-text", &settings);
+    EmbeddingBackend* second = embedding_backend_create("ollama", url, "nomic-embed-text", &settings);
+    assert(first != NULL && second != NULL);
+    assert(embedding_backend_ollama_client(first)->flights == group);
+    assert(embedding_backend_ollama_client(second)->flights == group);
+    
+    long before = mock_request_count(url);
+    assert(before >= 0);
+    BackendCaller callers[2] = { { first, "名古屋", NULL }, { second, "名古屋", NULL } };
+    pthread_t threads[2];
+    pthread_create(&threads[0], NULL, call_backend, &callers[0]);
+    for (;;) {
+        pthread_mutex_lock(&group->lock);
+        uint64_t fetches = group->fetches;
+        pthread_mutex_unlock(&group->lock);
+        if (fetches > 0) {
+            break;
+        }
+        usleep(1000);
+    }
+    pthread_create(&threads[1], NULL, call_backend, &callers[1]);
+    pthread_join(threads[0], NULL);
+    pthread_join(threads[1], NULL);
+    
+    assert(mock_request_count(url) - before == 1);
+    assert(group->fetches == 1 && group->coalesced == 1);
+    assert(callers[0].vector != NULL && callers[1].vector != NULL);
+    assert(callers[0].vector->dimensions == callers[1].vector->dimensions);
+    assert(memcmp(callers[0].vector->values, callers[1].vector->values,
+                  sizeof(float) * callers[0].vector->dimensions) == 0);
+    printf("✓ 2 backends, 1 request to Ollama\n");
+    
+    // Both memory caches hold the text, so neither asks again
+    const EmbeddingVector* cached = embedding_lru_get(first->memory_cache, "名古屋");
+    assert(cached != NULL);
+    embedding_lru_release(cached);
+    cached = embedding_lru_get(second->memory_cache, "名古屋");
+    assert(cached != NULL);
+    embedding_lru_release(cached);
+    EmbeddingVector* again = embedding_backend_embed(first, "名古屋", EMBEDDING_NO_DEADLINE);
+    assert(again != NULL && mock_request_count(url) - before == 1);
+    printf("✓ Shared result cached by both backends\n");
+    
+    free_embedding_vector(again);
+    free_embedding_vector(callers[0].vector);
+    free_embedding_vector(callers[1].vector);
+    embedding_backend_destroy(first);
+    embedding_backend_destroy(second);
+    embedding_flight_group_destroy(group);
+}
+
+void test_embedding_store_scoring() {
+    printf("Testing batched embedding scoring...\n");
+    
+    // Odd sizes exercise the row-block and column tails of every kernel
+    const int rows = 37;
+    const int dims = 13;
+    EmbeddingStore* store = embedding_store_create("nomic-embed-text", 0x1234ULL, rows, dims);
+    assert(store != NULL);
+    assert(store->stride % VECTOR_ROW_PAD == 0 && store->stride >= (size_t)dims);
+    
+    float query[13];
+    srand(11);
+    for (int i = 0; i < dims; i++) {
+        query[i] = (float)rand() / RAND_MAX - 0.5f;
+    }
+    for (int r = 0; r < rows; r++) {
+        float* row = embedding_store_mutable_row(store, r);
+        assert(((uintptr_t)row % VECTOR_ALIGNMENT) == 0);
+        for (int i = 0; i < dims; i++) {
+            row[i] = (float)rand() / RAND_MAX - 0.5f;
+        }
+    }
+    
+    float scores[37];
+    const char* default_kernel = vector_kernel_name();
+    for (int k = 0; k < vector_kernel_count(); k++) {
+        const char* name = vector_kernel_name_at(k);
+        assert(vector_use_kernel(name) == 0);
+        
+        assert(embedding_store_score(store, query, scores) == 0);
+        for (int r = 0; r < rows; r++) {
+            double expected = 0.0;
+            for (int i = 0; i < dims; i++) {
+                expected += (double)embedding_store_row(store, r)[i] * query[i];
+            }
+            assert(scores[r] - expected < 1e-4 && expected - scores[r] < 1e-4);
+        }
+        printf("✓ %s GEMV matches per-row dot products\n", name);
+    }
+    assert(vector_use_kernel(default_kernel) == 0);
+    
+    embedding_store_destroy(store);
+}
+
+// Unit vectors scattered around a few centres, like embeddings of related words
+static void fill_clustered_rows(EmbeddingStore* store, int clusters) {
+    int dims = store->dimensions;
+    float* centres = malloc(sizeof(float) * clusters * dims);
+    assert(centres != NULL);
+    
+    for (int i = 0; i < clusters * dims; i++) {
+        centres[i] = (float)rand() / RAND_MAX - 0.5f;
+    }
+    for (int r = 0; r < store->entry_count; r++) {
+        float* row = embedding_store_mutable_row(store, r);
+        const float* centre = centres + (rand() % clusters) * dims;
+        for (int i = 0; i < dims; i++) {
+            row[i] = centre[i] + 0.3f * ((float)rand() / RAND_MAX - 0.5f);
+        }
+        vector_normalize(row, dims);
+    }
+    
+    free(centres);
+}
+
+// Unit query next to a random row of store, as a query near the vocabulary
+// would be (store->dimensions floats)
+static void random_query_near(const EmbeddingStore* store, float* query) {
+    int dims = store->dimensions;
+    const float* row = embedding_store_read_row(store, rand() % store->entry_count, query);
+    for (int i = 0; i < dims; i++) {
+        query[i] = row[i] + 0.1f * ((float)rand() / RAND_MAX - 0.5f);
+    }
+    vector_normalize(query, dims);
+}
+
+// Exact top K of query over every row of store, scored into scores
+static void exact_top_k(const EmbeddingStore* store, const float* query, float* scores,
+                        TopKSelector* exact) {
+    topk_reset(exact);
+    embedding_store_score(store, query, scores);
+    topk_push_scores(exact, scores, store->entry_count, -INFINITY);
+    topk_finish(exact);
+}
+
+// Share of the exact top K found in the approximate one, both finished
+static float recall_at_k(const TopKSelector* exact, const TopKSelector* approximate) {
+    int hits = 0;
+    for (int i = 0; i < exact->count; i++) {
+        for (int j = 0; j < approximate->count; j++) {
+            hits += exact->items[i].id == approximate->items[j].id;
+        }
+    }
+    return exact->count > 0 ? (float)hits / exact->count : 1.0f;
+}
+
+void test_quantized_scoring() {
+    printf("Testing int8 embedding scoring...\n");
+    
+    const int rows = 2000;
+    const int dims = 96;
+    const int k = 10;
+    const int rerank = 4 * k;
+    const int queries = 50;
+    const char* path = "test_quantized_store.emb";
+    
+    // Integer kernels must agree exactly with the scalar reference
+    int8_t a[100], b[100];
+    srand(5);
+    for (int i = 0; i < 100; i++) {
+        a[i] = (int8_t)(rand() % 255 - 127);
+        b[i] = (int8_t)(rand() % 255 - 127);
+    }
+    const char* default_kernel = vector_kernel_name();
+    for (int kernel = 0; kernel < vector_kernel_count(); kernel++) {
+        assert(vector_use_kernel(vector_kernel_name_at(kernel)) == 0);
+        for (int n = 1; n <= 100; n += 33) {
+            int32_t expected = 0;
+            for (int i = 0; i < n; i++) {
+                expected += (int32_t)a[i] * b[i];
+            }
+            assert(vector_dot_i8(a, b, n) == expected);
+        }
+    }
+    assert(vector_use_kernel(default_kernel) == 0);
+    printf("✓ int8 dot product kernels match the reference\n");
+    
+    EmbeddingStore* store = embedding_store_create("nomic-embed-text", 0x1234ULL, rows, dims);
+    assert(store != NULL);
+    fill_clustered_rows(store, 40);
+    assert(embedding_store_quantize(store) == 0);
+    assert(embedding_store_save(store, path) == 0);
+    EmbeddingStore* mapped = embedding_store_load(path, "nomic-embed-text", 0x1234ULL, rows);
+    assert(mapped != NULL && mapped->quantized != NULL);
+    
+    float* exact_scores = malloc(sizeof(float) * rows);
+    float* approximate_scores = malloc(sizeof(float) * rows);
+    float* mapped_scores = malloc(sizeof(float) * rows);
+    TopKSelector* exact = topk_create(k);
+    TopKSelector* approximate = topk_create(k);
+    TopKSelector* shortlist = topk_create(rerank);
+    TopKSelector* reranked = topk_create(k);
+    assert(exact_scores && approximate_scores && mapped_scores);
+    assert(exact && approximate && shortlist && reranked);
+    
+    float max_error = 0.0f;
+    float approximate_recall = 0.0f;
+    float reranked_recall = 0.0f;
+    for (int q = 0; q < queries; q++) {
+        float query[96];
+        random_query_near(store, query);
+        
+        exact_top_k(store, query, exact_scores, exact);
+        assert(embedding_store_score_quantized(store, query, approximate_scores) == 0);
+        assert(embedding_store_score_quantized(mapped, query, mapped_scores) == 0);
+        for (int r = 0; r < rows; r++) {
+            float error = fabsf(approximate_scores[r] - exact_scores[r]);
+            if (error > max_error) max_error = error;
+            assert(mapped_scores[r] == approximate_scores[r]);
+        }
+        
+        topk_reset(approximate);
+        topk_reset(shortlist);
+        topk_reset(reranked);
+        topk_push_scores(approximate, approximate_scores, rows, -INFINITY);
+        topk_push_scores(shortlist, approximate_scores, rows, -INFINITY);
+        for (int i = 0; i < shortlist->count; i++) {
+            int id = shortlist->items[i].id;
+            topk_push(reranked, id, vector_dot(query, embedding_store_row(mapped, id), dims));
+        }
+        topk_finish(approximate);
+        topk_finish(reranked);
+        
+        approximate_recall += recall_at_k(exact, approximate) / queries;
+        reranked_recall += recall_at_k(exact, reranked) / queries;
+    }
+    
+    printf("✓ int8 score error: max %.4f\n", max_error);
+    printf("✓ Recall@%d: int8 %.3f, int8 + float re-rank of %d %.3f\n",
+           k, approximate_recall, rerank, reranked_recall);
+    assert(max_error < 0.02f);
+    assert(approximate_recall >= 0.8f);
+    assert(reranked_recall >= 0.99f);
+    printf("✓ int8 rows take %zu bytes vs %zu for floats\n",
+           store->quantized_stride, store->stride * sizeof(float));
+    
+    topk_destroy(exact);
+    topk_destroy(approximate);
+    topk_destroy(shortlist);
+    topk_destroy(reranked);
+    free(exact_scores);
+    free(approximate_scores);
+    free(mapped_scores);
+    embedding_store_destroy(mapped);
+    embedding_store_destroy(store);
+    remove(path);
+}
+
+void test_half_precision_scoring() {
+    printf("Testing fp16 and bf16 embedding storage...\n");
+    
+    const int rows = 2000;
+    const int dims = 96;
+    const int k = 10;
+    const int queries = 50;
+    const char* path = "test_half_store.emb";
+    
+    // Halves round to nearest: at most 2^-11 (fp16) or 2^-8 (bf16) relative
+    float values[100], widened[100], b[100];
+    uint16_t f16[100], bf16[100];
+    srand(9);
+    for (int i = 0; i < 100; i++) {
+        values[i] = ((float)rand() / RAND_MAX - 0.5f) * 4.0f;
+        b[i] = (float)rand() / RAND_MAX - 0.5f;
+    }
+    vector_to_f16(values, 100, f16);
+    vector_from_f16(f16, 100, widened);
+    for (int i = 0; i < 100; i++) {
+        assert(fabsf(widened[i] - values[i]) <= fabsf(values[i]) / 2048.0f + 1e-7f);
+    }
+    vector_to_bf16(values, 100, bf16);
+    vector_from_bf16(bf16, 100, widened);
+    for (int i = 0; i < 100; i++) {
+        assert(fabsf(widened[i] - values[i]) <= fabsf(values[i]) / 256.0f);
+    }
+    printf("✓ fp16 and bf16 conversions round within half an ulp\n");
+    
+    // Every kernel widens to the same floats, so only summation order differs
+    const char* default_kernel = vector_kernel_name();
+    for (int kernel = 0; kernel < vector_kernel_count(); kernel++) {
+        assert(vector_use_kernel(vector_kernel_name_at(kernel)) == 0);
+        for (int n = 1; n <= 100; n += 11) {
+            double expected_f16 = 0.0, expected_bf16 = 0.0;
+            vector_from_f16(f16, n, widened);
+            for (int i = 0; i < n; i++) expected_f16 += (double)widened[i] * b[i];
+            vector_from_bf16(bf16, n, widened);
+            for (int i = 0; i < n; i++) expected_bf16 += (double)widened[i] * b[i];
+            assert(fabs(vector_dot_f16(f16, b, n) - expected_f16) < 1e-4);
+            assert(fabs(vector_dot_bf16(bf16, b, n) - expected_bf16) < 1e-4);
+        }
+    }
+    assert(vector_use_kernel(default_kernel) == 0);
+    printf("✓ fp16 and bf16 dot product kernels match the reference\n");
+    
+    EmbeddingStore* store = embedding_store_create("nomic-embed-text", 0x1234ULL, rows, dims);
+    assert(store != NULL);
+    fill_clustered_rows(store, 40);
+    float* exact_scores = malloc(sizeof(float) * rows);
+    float* half_scores = malloc(sizeof(float) * rows);
+    float* mapped_scores = malloc(sizeof(float) * rows);
+    float query_set[50][96];
+    TopKSelector* exact = topk_create(k);
+    TopKSelector* half = topk_create(k);
+    assert(exact_scores && half_scores && mapped_scores && exact && half);
+    
+    for (int q = 0; q < queries; q++) {
+        random_query_near(store, query_set[q]);
+    }
+    
+    EmbeddingPrecision precisions[] = { EmbeddingPrecisionF16, EmbeddingPrecisionBF16 };
+    for (int p = 0; p < 2; p++) {
+        EmbeddingStore* converted = embedding_store_create("nomic-embed-text", 0x1234ULL, rows, dims);
+        assert(converted != NULL);
+        for (int r = 0; r < rows; r++) {
+            memcpy(embedding_store_mutable_row(converted, r), embedding_store_row(store, r),
+                   sizeof(float) * dims);
+        }
+        assert(embedding_store_set_precision(converted, precisions[p]) == 0);
+        assert(converted->values == NULL && embedding_store_row(converted, 0) == NULL);
+        assert(embedding_store_mutable_row(converted, 0) == NULL);
+        assert(embedding_store_row_bytes(converted) * 2 == embedding_store_row_bytes(store));
+        assert(((uintptr_t)converted->half_values % VECTOR_ALIGNMENT) == 0);
+        assert(embedding_store_row_bytes(converted) % VECTOR_ALIGNMENT == 0);
+        assert(embedding_store_set_precision(converted, EmbeddingPrecisionF32) != 0);
+        
+        assert(embedding_store_save(converted, path) == 0);
+        EmbeddingStore* mapped = embedding_store_load(path, "nomic-embed-text", 0x1234ULL, rows);
+        assert(mapped != NULL && mapped->precision == precisions[p]);
+        assert(embedding_store_set_precision(mapped, EmbeddingPrecisionF32) != 0);
+        
+        // The graph is linked on rows widened from the half-precision store
+        HnswIndex* index = hnsw_build(mapped, 12, 100);
+        assert(index != NULL);
+        
+        float max_error = 0.0f;
+        float recall = 0.0f;
+        float graph_recall = 0.0f;
+        for (int q = 0; q < queries; q++) {
+            const float* query = query_set[q];
+            exact_top_k(store, query, exact_scores, exact);
+            assert(embedding_store_score(converted, query, half_scores) == 0);
+            assert(embedding_store_score(mapped, query, mapped_scores) == 0);
+            for (int r = 0; r < rows; r++) {
+                float error = fabsf(half_scores[r] - exact_scores[r]);
+                if (error > max_error) max_error = error;
+                assert(mapped_scores[r] == half_scores[r]);
+            }
+            
+            // Single rows score like the GEMV, and widen to the same values
+            int id = rand() % rows;
+            float buffer[96];
+            const float* row = embedding_store_read_row(mapped, id, buffer);
+            assert(row == buffer);
+            assert(fabsf(embedding_store_dot(mapped, id, query) - half_scores[id]) < 1e-5f);
+            assert(fabsf(vector_dot(row, query, dims) - half_scores[id]) < 1e-5f);
+            
+            topk_reset(half);
+            topk_push_scores(half, half_scores, rows, -INFINITY);
+            topk_finish(half);
+            recall += recall_at_k(exact, half) / queries;
+            
+            topk_reset(half);
+            assert(hnsw_search(index, query, 64, half) >= k);
+            topk_finish(half);
+            graph_recall += recall_at_k(exact, half) / queries;
+        }
+        
+        printf("✓ %s score error: max %.5f, recall@%d %.3f (HNSW %.3f), %zu bytes per row\n",
+               embedding_precision_name(precisions[p]), max_error, k, recall, graph_recall,
+               embedding_store_row_bytes(converted));
+        assert(max_error < (precisions[p] == EmbeddingPrecisionF16 ? 2e-3f : 1e-2f));
+        assert(recall >= 0.95f);
+        assert(graph_recall >= 0.9f);
+        
+        hnsw_destroy(index);
+        embedding_store_destroy(mapped);
+        embedding_store_destroy(converted);
+    }
+    
+    EmbeddingPrecision parsed;
+    assert(embedding_precision_from_name("bf16", &parsed) == 0 && parsed == EmbeddingPrecisionBF16);
+    assert(embedding_precision_from_name("f64", &parsed) != 0);
+    
+    topk_destroy(exact);
+    topk_destroy(half);
+    free(exact_scores);
+    free(half_scores);
+    free(mapped_scores);
+    embedding_store_destroy(store);
+    remove(path);
+}
+
+void test_signature_prefilter() {
+    printf("Testing sign-bit signature prefilter...\n");
+    
+    const int rows = 2000;
+    const int dims = 96;
+    const int k = 10;
+    const int shortlist_size = 16 * k;
+    const int queries = 50;
+    const char* path = "test_signature_store.emb";
+    
+    // Sign bits, and Hamming distances on every kernel
+    float values[100];
+    uint64_t a[2], b[2];
+    srand(13);
+    for (int i = 0; i < 100; i++) {
+        values[i] = (float)rand() / RAND_MAX - 0.5f;
+    }
+    vector_sign_bits(values, 100, a);
+    for (int i = 0; i < 100; i++) {
+        assert(((a[i / 64] >> (i % 64)) & 1) == (values[i] > 0.0f));
+    }
+    assert((a[1] >> 36) == 0);
+    for (int i = 0; i < 100; i += 3) {
+        values[i] = -values[i];
+    }
+    vector_sign_bits(values, 100, b);
+    const char* default_kernel = vector_kernel_name();
+    for (int kernel = 0; kernel < vector_kernel_count(); kernel++) {
+        assert(vector_use_kernel(vector_kernel_name_at(kernel)) == 0);
+        assert(vector_hamming(a, b, 2) == 34);
+        assert(vector_hamming(a, a, 2) == 0);
+    }
+    assert(vector_use_kernel(default_kernel) == 0);
+    printf("✓ Hamming distance kernels agree\n");
+    
+    EmbeddingStore* store = embedding_store_create("nomic-embed-text", 0x1234ULL, rows, dims);
+    assert(store != NULL);
+    fill_clustered_rows(store, 40);
+    assert(embedding_store_build_signatures(store) == 0);
+    assert(embedding_store_set_precision(store, EmbeddingPrecisionF16) == 0);
+    assert(embedding_store_save(store, path) == 0);
+    EmbeddingStore* mapped = embedding_store_load(path, "nomic-embed-text", 0x1234ULL, rows);
+    assert(mapped != NULL && mapped->signatures != NULL);
+    assert(memcmp(mapped->signatures, store->signatures,
+                  sizeof(uint64_t) * rows * store->signature_words) == 0);
+    
+    float* scores = malloc(sizeof(float) * rows);
+    int* shortlist = malloc(sizeof(int) * rows);
+    TopKSelector* exact = topk_create(k);
+    TopKSelector* reranked = topk_create(k);
+    assert(scores && shortlist && exact && reranked);
+    
+    // A row is always nearest its own signature, and asking for more
+    // entries than the store holds returns all of them
+    float buffer[96];
+    const float* row = embedding_store_read_row(mapped, 7, buffer);
+    int words = mapped->signature_words;
+    assert(embedding_store_signature_shortlist(mapped, row, 1, shortlist) == 1);
+    assert(shortlist[0] <= 7 && vector_hamming(mapped->signatures + (size_t)shortlist[0] * words,
+                                               mapped->signatures + 7 * words, words) == 0);
+    assert(embedding_store_signature_shortlist(mapped, row, rows + 5, shortlist) == rows);
+    for (int i = 1; i < rows; i++) {
+        assert(shortlist[i] == shortlist[i - 1] + 1);
+    }
+    
+    float recall = 0.0f;
+    for (int q = 0; q < queries; q++) {
+        float query[96];
+        random_query_near(mapped, query);
+        exact_top_k(mapped, query, scores, exact);
+        
+        // Re-ranking a shortlist finds every neighbour the shortlist holds
+        int count = embedding_store_signature_shortlist(mapped, query, shortlist_size, shortlist);
+        assert(count == shortlist_size);
+        int held = 0;
+        topk_reset(reranked);
+        for (int i = 0; i < count; i++) {
+            assert(i == 0 || shortlist[i] > shortlist[i - 1]);
+            topk_push(reranked, shortlist[i], embedding_store_dot(mapped, shortlist[i], query));
+            for (int j = 0; j < k; j++) {
+                held += shortlist[i] == exact->items[j].id;
+            }
+        }
+        topk_finish(reranked);
+        
+        float shortlist_recall = recall_at_k(exact, reranked);
+        assert(held == (int)(shortlist_recall * k + 0.5f));
+        recall += shortlist_recall / queries;
+    }
+    
+    printf("✓ Recall@%d with a %d-entry signature shortlist: %.3f\n", k, shortlist_size, recall);
+    printf("✓ Signatures take %zu bytes per row\n", sizeof(uint64_t) * store->signature_words);
+    assert(recall >= 0.9f);
+    
+    topk_destroy(exact);
+    topk_destroy(reranked);
+    free(scores);
+    free(shortlist);
+    embedding_store_destroy(mapped);
+    embedding_store_destroy(store);
+    remove(path);
+}
+
+void test_hnsw_index() {
+    printf("Testing HNSW index...\n");
+    
+    const int rows = 2000;
+    const int dims = 32;
+    const int k = 10;
+    const int queries = 50;
+    const char* path = "test_hnsw_index.hnsw";
+    
+    EmbeddingStore* store = embedding_store_create("nomic-embed-text", 0x1234ULL, rows, dims);
+    assert(store != NULL);
+    srand(3);
+    fill_clustered_rows(store, 40);
+    
+    HnswIndex* index = hnsw_build(store, 12, 100);
+    assert(index != NULL);
+    assert(index->node_count == rows);
+    assert(hnsw_save(index, path) == 0);
+    HnswIndex* loaded = hnsw_load(path, store);
+    assert(loaded != NULL && loaded->image_mapped);
+    
+    float* scores = malloc(sizeof(float) * rows);
+    TopKSelector* exact = topk_create(k);
+    TopKSelector* approximate = topk_create(k);
+    TopKSelector* mapped = topk_create(k);
+    assert(scores && exact && approximate && mapped);
+    
+    float recall = 0.0f;
+    for (int q = 0; q < queries; q++) {
+        float query[32];
+        random_query_near(store, query);
+        
+        exact_top_k(store, query, scores, exact);
+        topk_reset(approximate);
+        topk_reset(mapped);
+        assert(hnsw_search(index, query, 64, approximate) >= k);
+        assert(hnsw_search(loaded, query, 64, mapped) >= k);
+        topk_finish(approximate);
+        topk_finish(mapped);
+        
+        for (int i = 0; i < k; i++) {
+            assert(approximate->items[i].id == mapped->items[i].id);
+        }
+        recall += recall_at_k(exact, approximate) / queries;
+    }
+    
+    printf("✓ HNSW recall@%d at ef=64: %.3f\n", k, recall);
+    assert(recall >= 0.9f);
+    printf("✓ Mapped HNSW index returns the same neighbours\n");
+    
+    // Searches reuse the index's memory; a new beam width is picked up
+    topk_reset(approximate);
+    assert(hnsw_search(index, embedding_store_row(store, 0), 16, approximate) >= k);
+    topk_finish(approximate);
+    assert(approximate->items[0].id == 0);
+    printf("✓ Search memory reused across queries and beam widths\n");
+    
+    // An entry point below the top layer would be searched from links it
+    // does not have. entry_point is the ninth header field, after two
+    // 64-bit hashes.
+    int low_node = 0;
+    while ((int)(loaded->upper_offsets[low_node + 1] - loaded->upper_offsets[low_node]) >=
+           loaded->max_level) {
+        low_node++;
+    }
+    uint32_t entry_point = (uint32_t)low_node;
+    FILE* file = fopen(path, "r+b");
+    assert(file != NULL);
+    assert(fseek(file, 40, SEEK_SET) == 0);
+    assert(fwrite(&entry_point, sizeof(entry_point), 1, file) == 1);
+    fclose(file);
+    assert(loaded->max_level > 0);
+    assert(hnsw_load(path, store) == NULL);
+    printf("✓ Entry point below the top layer rejected\n");
+    
+    // An index built for another dictionary revision must be rejected
+    store->dictionary_hash = 0x9999ULL;
+    assert(hnsw_load(path, store) == NULL);
+    printf("✓ Stale HNSW index rejected\n");
+    
+    topk_destroy(exact);
+    topk_destroy(approximate);
+    topk_destroy(mapped);
+    free(scores);
+    hnsw_destroy(loaded);
+    hnsw_destroy(index);
+    embedding_store_destroy(store);
+    remove(path);
+}
+
 int main() {
     printf("=== NovaKey Embedding Tests ===\n\n");
     
     test_ollama_client_create();
     test_cosine_similarity();
+    test_vector_kernels();
+    test_request_bodies();
+    test_response_parsing();
+    test_ngram_backend();
+    test_embedding_store_roundtrip();
+    test_embedding_cache();
+    test_embedding_lru();
+    test_deadlines_and_circuit_breaker();
+    test_deadline_shorter_than_latency();
+    test_single_flight();
+    test_shared_flight_group();
+    test_embedding_store_scoring();
+    test_quantized_scoring();
+    test_half_precision_scoring();
+    test_signature_prefilter();
+    test_hnsw_index();
     test_embedding_generation();
+    test_batch_embedding();
+    test_async_embedding();
     test_embedding_comparison();
     
     printf("\n✓ All embedding tests completed!\n");
@@ -2,9 +2,25 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <unistd.h>
 #include "../include/morphology.h"
 #include "../include/embedding.h"
+#include "../include/embedding_lru.h"
 #include "../include/search.h"
+#include "../include/config.h"
+
+// Ollama to test against: the mock server when run by ctest, else a local one
+static const char* ollama_url(void) {
+    const char* url = getenv("NOVAKEY_OLLAMA_URL");
+    return url ? url : "http://localhost:11434";
+}
+
+// Caches as the default configuration sets them up
+static const EmbeddingBackendSettings default_settings = {
+    .cache_dir = EMBEDDING_CACHE_DEFAULT_DIRECTORY,
+    .cache_max_bytes = EMBEDDING_CACHE_DEFAULT_MAX_BYTES,
+    .memory_cache_bytes = EMBEDDING_LRU_DEFAULT_BUDGET
+};
 
 void test_end_to_end_search() {
     printf("Testing end-to-end candidate search...\n");
@@ -16,9 +32,10 @@ void test_end_to_end_search() {
         return;
     }
     
-    // Create Ollama client
-    OllamaClient* ollama_client = ollama_client_create("http://localhost:11434", "nomic-embed-text");
-    if (!ollama_client) {
+    // Create Ollama embedding backend
+    EmbeddingBackend* backend = embedding_backend_create("ollama", ollama_url(), "nomic-embed-text",
+                                                         &default_settings);
+    if (!backend) {
         printf("⚠ Could not create Ollama client, skipping test\n");
         mecab_cleanup();
         return;
@@ -34,6 +51,13 @@ void test_end_to_end_search() {
     assert(dict != NULL);
     printf("✓ Dictionary loaded with %d entries\n", dict->entry_count);
     
+    // Load or build the precomputed entry embeddings
+    if (attach_dictionary_embeddings(dict, backend, config) == 0) {
+        printf("✓ Dictionary embeddings attached (%d dimensions)\n", dict->embeddings->dimensions);
+    } else {
+        printf("⚠ Dictionary embeddings unavailable (possibly Ollama not running)\n");
+    }
+    
     // Test input
     const char* input_text = "こんにちは";
     
@@ -44,7 +68,7 @@ void test_end_to_end_search() {
     }
     
     // Search for candidates
-    CandidateList* candidates = search_candidates(input_text, morph_result, dict, config, ollama_client);
+    CandidateList* candidates = search_candidates(input_text, morph_result, dict, config, backend);
     
     if (candidates && candidates->candidate_count > 0) {
         printf("✓ Found %d candidates for '%s':\n", candidates->candidate_count, input_text);
@@ -68,7 +92,7 @@ void test_end_to_end_search() {
     }
     free_dictionary(dict);
     free_search_config(config);
-    ollama_client_destroy(ollama_client);
+    embedding_backend_destroy(backend);
     mecab_cleanup();
     
     printf("✓ End-to-end test completed\n");
@@ -84,8 +108,9 @@ void test_multiple_inputs() {
         return;
     }
     
-    OllamaClient* ollama_client = ollama_client_create("http://localhost:11434", "nomic-embed-text");
-    if (!ollama_client) {
+    EmbeddingBackend* backend = embedding_backend_create("ollama", ollama_url(), "nomic-embed-text",
+                                                         &default_settings);
+    if (!backend) {
         printf("⚠ Could not create Ollama client, skipping test\n");
         mecab_cleanup();
         return;
@@ -93,6 +118,7 @@ void test_multiple_inputs() {
     
     SearchConfig* config = create_search_config();
     Dictionary* dict = load_dictionary(config->dictionary_path);
+    attach_dictionary_embeddings(dict, backend, config);
     
     // Test different inputs
     const char* test_inputs[] = {
@@ -109,7 +135,7 @@ void test_multiple_inputs() {
         
         MorphResult* morph_result = analyze_text(test_inputs[i]);
         CandidateList* candidates = search_candidates(test_inputs[i], morph_result, 
-                                                    dict, config, ollama_client);
+                                                    dict, config, backend);
         
         if (candidates && candidates->candidate_count > 0) {
             printf("Found %d candidates:\n", candidates->candidate_count);
@@ -134,7 +160,7 @@ void test_multiple_inputs() {
     // Cleanup
     free_dictionary(dict);
     free_search_config(config);
-    ollama_client_destroy(ollama_client);
+    embedding_backend_destroy(backend);
     mecab_cleanup();
     
     printf("\n✓ Multiple input test completed\n");
@@ -163,10 +189,61 @@ void test_config_weights() {
     printf("✓ Weight configuration test completed\n");
 }
 
+void test_config_file() {
+    printf("Testing settings from a configuration file...\n");
+    
+    const char* path = "test_config.json";
+    FILE* file = fopen(path, "w");
+    assert(file != NULL);
+    fprintf(file, "{\n"
+                  "  \"embedding_backend\": \"ollama\",\n"
+                  "  \"ollama_url\": \"http://127.0.0.1:9\",\n"
+                  "  \"dictionary_path\": \"test_dictionary.txt\",\n"
+                  "  \"embedding_precision\": \"bf16\",\n"
+                  "  \"binary_prefilter\": true,\n"
+                  "  \"embedding_batch_size\": 16,\n"
+                  "  \"embedding_cache_dir\": \"test_config_cache\",\n"
+                  "  \"embedding_cache_max_mb\": 2,\n"
+                  "  \"embedding_memory_cache_mb\": 1,\n"
+                  "  \"embedding_timeout_ms\": 150,\n"
+                  "  \"embedding_breaker_cooldown_ms\": 2500,\n"
+                  "  \"max_candidates\": 5\n"
+                  "}\n");
+    fclose(file);
+    
+    NovaKeyConfig* config = load_config(path);
+    assert(config != NULL);
+    
+    SearchConfig* search_config = create_configured_search_config(config);
+    assert(search_config != NULL);
+    assert(strcmp(search_config->dictionary_path, "test_dictionary.txt") == 0);
+    assert(search_config->embedding_precision == EmbeddingPrecisionBF16);
+    assert(search_config->binary_prefilter == 1 && search_config->max_candidates == 5);
+    assert(search_config->embedding_timeout_ms == 150);
+    printf("✓ Search settings read from the file\n");
+    
+    EmbeddingBackend* backend = create_configured_embedding_backend(config);
+    assert(backend != NULL);
+    OllamaClient* client = embedding_backend_ollama_client(backend);
+    assert(client != NULL && strcmp(client->base_url, "http://127.0.0.1:9") == 0);
+    assert(client->batch_size == 16 && client->breaker.cooldown_ms == 2500);
+    assert(backend->cache != NULL && backend->cache->max_bytes == 2u << 20);
+    assert(backend->memory_cache != NULL && backend->memory_cache->budget == 1u << 20);
+    printf("✓ Embedding backend settings read from the file\n");
+    
+    embedding_backend_destroy(backend);
+    free_search_config(search_config);
+    free_config(config);
+    remove("test_config_cache/embeddings.cache");
+    rmdir("test_config_cache");
+    remove(path);
+}
+
 int main() {
     printf("=== NovaKey Integration Tests ===\n\n");
     
     test_config_weights();
+    test_config_file();
     test_end_to_end_search();
     test_multiple_inputs();
     
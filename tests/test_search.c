@@ -0,0 +1,582 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "../include/search.h"
+#include "../include/search_session.h"
+#include "../include/trie.h"
+#include "../include/topk.h"
+#include "../include/edit_distance.h"
+#include "../include/utf8.h"
+
+void test_compiled_dictionary() {
+    printf("Testing compiled dictionary round trip...\n");
+    
+    const char* text_path = "test_dictionary.txt";
+    const char* compiled_path = "test_dictionary.nkd";
+    
+    FILE* file = fopen(text_path, "w");
+    assert(file != NULL);
+    fprintf(file, "私,わたし,ワタシ,watashi,0.98\n");
+    fprintf(file, "malformed line\n");
+    fprintf(file, "こんにちは,こんにちは,コンニチハ,konnichiwa,1.0\n");
+    fclose(file);
+    
+    assert(compile_dictionary(text_path, compiled_path) == 0);
+    
+    Dictionary* text_dict = load_dictionary(text_path);
+    Dictionary* compiled_dict = load_dictionary(compiled_path);
+    assert(text_dict != NULL && compiled_dict != NULL);
+    assert(compiled_dict->image_mapped);
+    assert(compiled_dict->entry_count == 2);
+    assert(compiled_dict->fingerprint == text_dict->fingerprint);
+    
+    DictionaryEntry entry = dictionary_get_entry(compiled_dict, 1);
+    assert(strcmp(entry.kanji, "こんにちは") == 0);
+    assert(strcmp(entry.hiragana, "こんにちは") == 0);
+    assert(strcmp(entry.romaji, "konnichiwa") == 0);
+    assert(entry.frequency == 1.0f);
+    printf("✓ Compiled dictionary mapped with %d entries\n", compiled_dict->entry_count);
+    
+    free_dictionary(text_dict);
+    free_dictionary(compiled_dict);
+    
+    // An image whose string pool does not end in NUL is rejected: the last
+    // string in the pool is the romaji of the last entry
+    file = fopen(compiled_path, "rb");
+    assert(file != NULL);
+    fseek(file, 0, SEEK_END);
+    size_t image_size = (size_t)ftell(file);
+    rewind(file);
+    char* image = malloc(image_size);
+    assert(fread(image, 1, image_size, file) == image_size);
+    fclose(file);
+    
+    char* last_string = NULL;
+    for (size_t i = 0; i + sizeof("konnichiwa") <= image_size; i++) {
+        if (memcmp(image + i, "konnichiwa", sizeof("konnichiwa")) == 0) {
+            last_string = image + i;
+        }
+    }
+    assert(last_string != NULL);
+    last_string[strlen("konnichiwa")] = 'x';
+    file = fopen(compiled_path, "wb");
+    assert(fwrite(image, 1, image_size, file) == image_size);
+    fclose(file);
+    assert(load_compiled_dictionary(compiled_path) == NULL);
+    printf("✓ Unterminated string pool rejected\n");
+    
+    // The header is checksummed: a changed entry count is caught on open
+    last_string[strlen("konnichiwa")] = '\0';
+    image[8] ^= 1;
+    file = fopen(compiled_path, "wb");
+    assert(fwrite(image, 1, image_size, file) == image_size);
+    fclose(file);
+    assert(load_compiled_dictionary(compiled_path) == NULL);
+    image[8] ^= 1;
+    file = fopen(compiled_path, "wb");
+    assert(fwrite(image, 1, image_size, file) == image_size);
+    fclose(file);
+    Dictionary* restored = load_compiled_dictionary(compiled_path);
+    assert(restored != NULL && restored->max_frequency == 1.0f);
+    free_dictionary(restored);
+    printf("✓ Damaged header rejected\n");
+    
+    free(image);
+    remove(text_path);
+    remove(compiled_path);
+}
+
+static int collect_entry(int entry_id, void* user_data) {
+    int* seen = user_data;
+    seen[entry_id]++;
+    return 0;
+}
+
+void test_reading_trie() {
+    printf("Testing double-array trie lookups...\n");
+    
+    const char* keys[] = { "きょう", "きょうと", "き", "きょう", "あした", "きのう" };
+    int count = sizeof(keys) / sizeof(keys[0]);
+    
+    size_t image_size = 0;
+    void* image = trie_build_image(keys, count, &image_size);
+    assert(image != NULL);
+    
+    DoubleArrayTrie trie;
+    assert(trie_open(&trie, image, image_size) == 0);
+    assert(trie.key_count == 5);
+    
+    // Exact match returns every entry sharing the key
+    int seen[6] = {0};
+    assert(trie_exact_match(&trie, "きょう", collect_entry, seen) == 2);
+    assert(seen[0] == 1 && seen[3] == 1 && seen[1] == 0);
+    printf("✓ Exact match found homophones\n");
+    
+    // Common prefix: keys that the text starts with
+    memset(seen, 0, sizeof(seen));
+    const char* text = "きょうと";
+    assert(trie_common_prefix_search(&trie, text, strlen(text), collect_entry, seen) == 4);
+    assert(seen[2] && seen[0] && seen[3] && seen[1] && !seen[5]);
+    printf("✓ Common prefix search found き/きょう/きょうと\n");
+    
+    // Predictive: keys that extend the prefix
+    memset(seen, 0, sizeof(seen));
+    assert(trie_predictive_search(&trie, "き", collect_entry, seen) == 5);
+    assert(!seen[4]);
+    assert(trie_predictive_search(&trie, "さ", collect_entry, seen) == 0);
+    printf("✓ Predictive search enumerated the き subtree\n");
+    
+    // Fuzzy: keys within a number of edits of a misspelling
+    memset(seen, 0, sizeof(seen));
+    assert(trie_fuzzy_search(&trie, "きょお", 1, collect_entry, seen) == 2);
+    assert(seen[0] == 1 && seen[3] == 1);
+    assert(trie_fuzzy_search(&trie, "きょお", 2, NULL, NULL) == 5);
+    assert(trie_fuzzy_search(&trie, "きょお", 0, NULL, NULL) == 0);
+    printf("✓ Fuzzy search found きょう for きょお\n");
+    
+    // Entry ids are the last words of the image, the last one belonging to
+    // きょうと; one past the entry count would index beyond the dictionary
+    uint32_t bad_id = (uint32_t)count;
+    memcpy((char*)image + image_size - sizeof(bad_id), &bad_id, sizeof(bad_id));
+    assert(trie_open(&trie, image, image_size) == 0);
+    assert(trie_exact_match(&trie, "きょうと", NULL, NULL) == 0);
+    assert(trie_predictive_search(&trie, "", NULL, NULL) == count - 1);
+    printf("✓ Out of range entry id skipped\n");
+    
+    // A node made its own child (base + 0 == n, check[n] == n) would send
+    // the walk to a key terminal round in circles
+    int32_t* base = (int32_t*)((char*)image + 4 * sizeof(uint32_t));
+    int32_t* check = base + trie.node_count;
+    int node = trie_walk(&trie, TRIE_ROOT, "き", strlen("き"));
+    assert(node > 0 && base[node] > 0);
+    base[node] = node;
+    check[node] = node;
+    assert(trie_open(&trie, image, image_size) == 0);
+    assert(trie_enumerate_subtree(&trie, node, NULL, NULL) == 0);
+    assert(trie_predictive_search(&trie, "き", NULL, NULL) == 0);
+    printf("✓ Cycle in a damaged trie ends the walk\n");
+    
+    free(image);
+}
+
+void test_dictionary_index() {
+    printf("Testing dictionary reading index...\n");
+    
+    Dictionary* dict = create_fallback_dictionary();
+    assert(dict != NULL);
+    
+    int seen[5] = {0};
+    assert(trie_predictive_search(&dict->hiragana_index, "こん", collect_entry, seen) == 2);
+    assert(seen[0] == 1 && seen[4] == 1);
+    printf("✓ Dictionary index resolved こん to こんにちは/こんばんは\n");
+    
+    // A typo shares no prefix with any reading; the fuzzy walk still finds it
+    SearchConfig* config = create_search_config();
+    assert(config != NULL);
+    CandidateList* candidates = search_candidates("こんにちわ", NULL, dict, config, NULL);
+    assert(candidates && candidates->candidate_count > 0);
+    assert(strcmp(candidates->candidates[0].reading, "こんにちは") == 0);
+    printf("✓ Typo こんにちわ resolved to こんにちは\n");
+    free_candidate_list(candidates);
+    
+    free_search_config(config);
+    free_dictionary(dict);
+}
+
+void test_romanize_hiragana() {
+    printf("Testing hiragana romanization...\n");
+    
+    const char* cases[][2] = {
+        { "きょう", "kyou" },
+        { "しゃしん", "shashin" },
+        { "がっこう", "gakkou" },
+        { "まっちゃ", "matcha" },
+        { "じゃあね", "jaane" },
+        { "こんにちは", "konnichiha" }
+    };
+    int count = sizeof(cases) / sizeof(cases[0]);
+    
+    for (int i = 0; i < count; i++) {
+        char* romaji = romanize_hiragana(cases[i][0]);
+        assert(romaji != NULL);
+        assert(strcmp(romaji, cases[i][1]) == 0);
+        free(romaji);
+    }
+    printf("✓ %d readings romanized\n", count);
+}
+
+void test_romaji_index() {
+    printf("Testing romaji index...\n");
+    
+    const char* text_path = "test_romaji_dictionary.txt";
+    FILE* file = fopen(text_path, "w");
+    assert(file != NULL);
+    fprintf(file, "学校,がっこう,ガッコウ,,0.9\n");
+    fprintf(file, "こんにちは,こんにちは,コンニチハ,konnichiwa,1.0\n");
+    fclose(file);
+    
+    Dictionary* dict = load_dictionary(text_path);
+    assert(dict != NULL && dict->entry_count == 2);
+    
+    // Missing romaji is derived from the hiragana reading
+    assert(strcmp(dictionary_get_entry(dict, 0).romaji, "gakkou") == 0);
+    
+    int seen[2] = {0};
+    assert(trie_predictive_search(&dict->romaji_index, "gak", collect_entry, seen) == 1);
+    assert(seen[0] == 1);
+    assert(trie_exact_match(&dict->romaji_index, "konnichiwa", collect_entry, seen) == 1);
+    assert(seen[1] == 1);
+    printf("✓ Romaji keystrokes resolved through the romaji index\n");
+    
+    // Misspelt romaji goes through the same fuzzy walk, on the romaji index
+    memset(seen, 0, sizeof(seen));
+    assert(trie_fuzzy_search(&dict->romaji_index, "konichiwa", SEARCH_MAX_TYPO_DISTANCE,
+                             collect_entry, seen) == 1);
+    assert(seen[1] == 1 && seen[0] == 0);
+    
+    SearchConfig* config = create_search_config();
+    assert(config != NULL);
+    const char* const typos[][2] = { { "konichiwa", "こんにちは" }, { "Gakou", "がっこう" } };
+    for (int i = 0; i < 2; i++) {
+        CandidateList* candidates = search_candidates(typos[i][0], NULL, dict, config, NULL);
+        assert(candidates && candidates->candidate_count > 0);
+        assert(strcmp(candidates->candidates[0].reading, typos[i][1]) == 0);
+        free_candidate_list(candidates);
+    }
+    printf("✓ Romaji typos resolved without a linear scan\n");
+    
+    free_search_config(config);
+    free_dictionary(dict);
+    remove(text_path);
+}
+
+static int compare_scores_descending(const void* a, const void* b) {
+    float fa = *(const float*)a;
+    float fb = *(const float*)b;
+    return (fa < fb) - (fa > fb);
+}
+
+void test_topk_selection() {
+    printf("Testing top-K selection...\n");
+    
+    const int count = 1000;
+    const int k = 10;
+    float* scores = malloc(sizeof(float) * count);
+    float* sorted = malloc(sizeof(float) * count);
+    assert(scores && sorted);
+    
+    // Increasing scores: a fill-until-full collector would keep the worst K
+    srand(42);
+    for (int i = 0; i < count; i++) {
+        scores[i] = (float)i / count + (float)(rand() % 100) / 100000.0f;
+        sorted[i] = scores[i];
+    }
+    qsort(sorted, count, sizeof(float), compare_scores_descending);
+    
+    TopKSelector* selector = topk_create(k);
+    assert(selector != NULL);
+    for (int i = 0; i < count; i++) {
+        topk_push(selector, i, scores[i]);
+    }
+    assert(topk_threshold(selector) == sorted[k - 1]);
+    
+    assert(topk_finish(selector) == k);
+    for (int i = 0; i < k; i++) {
+        assert(selector->items[i].score == sorted[i]);
+        assert(scores[selector->items[i].id] == sorted[i]);
+    }
+    printf("✓ Streaming selector kept the true best %d of %d\n", k, count);
+    
+    // Score-array stage with a minimum score
+    topk_reset(selector);
+    topk_push_scores(selector, scores, count, 0.995f);
+    int selected = topk_finish(selector);
+    for (int i = 0; i < selected; i++) {
+        assert(selector->items[i].score > 0.995f);
+    }
+    assert(selected < k);
+    printf("✓ Score array stage applied the minimum score (%d kept)\n", selected);
+    
+    topk_destroy(selector);
+    free(scores);
+    free(sorted);
+}
+
+// Textbook Levenshtein table over code points, as the reference
+static int reference_distance(const char* a, const char* b) {
+    uint32_t ca[128], cb[128];
+    int la = 0, lb = 0;
+    while (*a) a += utf8_decode(a, &ca[la++]);
+    while (*b) b += utf8_decode(b, &cb[lb++]);
+    
+    int table[129][129];
+    for (int i = 0; i <= la; i++) table[i][0] = i;
+    for (int j = 0; j <= lb; j++) table[0][j] = j;
+    for (int i = 1; i <= la; i++) {
+        for (int j = 1; j <= lb; j++) {
+            int best = table[i - 1][j - 1] + (ca[i - 1] != cb[j - 1]);
+            if (table[i - 1][j] + 1 < best) best = table[i - 1][j] + 1;
+            if (table[i][j - 1] + 1 < best) best = table[i][j - 1] + 1;
+            table[i][j] = best;
+        }
+    }
+    return table[la][lb];
+}
+
+static const char* const reading_symbols[] = { "あ", "い", "う", "き", "ょ", "ん", "a", "k" };
+
+static void build_reading(char* buffer, const int* symbols, int length) {
+    buffer[0] = '\0';
+    for (int i = 0; i < length; i++) {
+        strcat(buffer, reading_symbols[symbols[i]]);
+    }
+}
+
+static void random_reading(char* buffer, int length) {
+    int symbols[128];
+    for (int i = 0; i < length; i++) {
+        symbols[i] = rand() % 8;
+    }
+    build_reading(buffer, symbols, length);
+}
+
+void test_short_prefix_candidates() {
+    printf("Testing candidates for a short prefix of a large subtree...\n");
+    
+    // More completions of あ than any fixed cap, the most frequent one last
+    // in byte order
+    static const char* const kana[] = { "か", "き", "く", "け", "こ", "さ", "し", "す", "せ", "そ" };
+    const char* text_path = "test_prefix_dictionary.txt";
+    FILE* file = fopen(text_path, "w");
+    assert(file != NULL);
+    for (int i = 0; i < 6000; i++) {
+        fprintf(file, "亜%d,あ%s%s,ア,,0.0\n", i, kana[i % 10], kana[(i / 10) % 10]);
+    }
+    fprintf(file, "阿呆,あんん,アンン,,1.0\n");
+    fclose(file);
+    
+    Dictionary* dict = load_dictionary(text_path);
+    SearchConfig* config = create_search_config();
+    assert(dict != NULL && config != NULL);
+    
+    CandidateList* candidates = search_candidates("あ", NULL, dict, config, NULL);
+    assert(candidates && candidates->candidate_count == config->max_candidates);
+    assert(strcmp(candidates->candidates[0].text, "阿呆") == 0);
+    printf("✓ Best completion found past %d earlier entries\n", dict->entry_count - 1);
+    free_candidate_list(candidates);
+    
+    free_search_config(config);
+    free_dictionary(dict);
+    remove(text_path);
+}
+
+void test_edit_distance() {
+    printf("Testing edit distance...\n");
+    
+    assert(edit_distance("kitten", "sitting") == 3);
+    assert(edit_distance("", "きょう") == 3);
+    assert(edit_distance("きょう", "") == 3);
+    assert(edit_distance("きょう", "きのう") == 1);
+    assert(edit_distance("こんにちは", "こんいちは") == 1);
+    assert(edit_distance("ありがと", "ありがとう") == 1);
+    printf("✓ Distances are counted in code points, not bytes\n");
+    
+    // One missing kana only costs one edit instead of misaligning the rest
+    assert(edit_distance("こんちは", "こんにちは") == 1);
+    assert(edit_distance("きょうと", "とうきょう") == 3);
+    printf("✓ Insertions keep later characters aligned\n");
+    
+    // Bit-parallel (up to 64 code points) and table paths against the reference
+    char a[128 * 3 + 1], b[128 * 3 + 1];
+    srand(17);
+    for (int trial = 0; trial < 500; trial++) {
+        random_reading(a, rand() % 90);
+        random_reading(b, rand() % 90);
+        
+        EditPattern pattern;
+        assert(edit_pattern_init(&pattern, a) == 0);
+        int length;
+        assert(edit_pattern_distance(&pattern, b, &length) == reference_distance(a, b));
+        assert(length == utf8_length(b));
+        edit_pattern_free(&pattern);
+    }
+    printf("✓ 500 random pairs match the reference distance\n");
+    
+    // The bounded distance is exact up to the bound and saturates above it
+    for (int trial = 0; trial < 500; trial++) {
+        if (trial % 2) {
+            // A few edits apart, so the band is exercised, not just the length check
+            int symbols[128];
+            int length = rand() % 90;
+            for (int i = 0; i < length; i++) {
+                symbols[i] = rand() % 8;
+            }
+            build_reading(a, symbols, length);
+            for (int edit = rand() % 6; edit > 0 && length > 0; edit--) {
+                symbols[rand() % length] = rand() % 8;
+            }
+            build_reading(b, symbols, length > 0 && trial % 4 == 1 ? length - 1 : length);
+        } else {
+            random_reading(a, rand() % 90);
+            random_reading(b, rand() % 90);
+        }
+        
+        EditPattern pattern;
+        assert(edit_pattern_init(&pattern, a) == 0);
+        int expected = reference_distance(a, b);
+        for (int bound = 0; bound <= 12; bound++) {
+            int distance = edit_pattern_distance_bounded(&pattern, b, utf8_length(b), bound);
+            assert(distance == (expected <= bound ? expected : bound + 1));
+        }
+        assert(edit_pattern_distance_bounded(&pattern, b, utf8_length(b), 200) == expected);
+        edit_pattern_free(&pattern);
+    }
+    printf("✓ Bounded distance agrees with the reference below the bound\n");
+}
+
+static void assert_same_candidates(const CandidateList* expected, const CandidateList* actual) {
+    assert(expected != NULL && actual != NULL);
+    assert(expected->candidate_count == actual->candidate_count);
+    for (int i = 0; i < expected->candidate_count; i++) {
+        assert(strcmp(expected->candidates[i].text, actual->candidates[i].text) == 0);
+        assert(strcmp(expected->candidates[i].reading, actual->candidates[i].reading) == 0);
+        assert(expected->candidates[i].combined_score == actual->candidates[i].combined_score);
+        assert(expected->candidates[i].phonetic_score == actual->candidates[i].phonetic_score);
+    }
+}
+
+void test_search_session() {
+    printf("Testing incremental search session...\n");
+    
+    // Readings sharing prefixes, so keystrokes narrow the trie, plus enough
+    // unrelated ones for typos to go through the fuzzy trie walk
+    static const char* const kana[] = { "き", "ょ", "う", "か", "こ", "ん", "に", "ち", "は", "あ" };
+    const char* text_path = "test_session_dictionary.txt";
+    FILE* file = fopen(text_path, "w");
+    assert(file != NULL);
+    fprintf(file, "今日,きょう,キョウ,kyou,0.9\n");
+    fprintf(file, "京都,きょうと,キョウト,kyouto,0.8\n");
+    fprintf(file, "こんにちは,こんにちは,コンニチハ,konnichiwa,1.0\n");
+    srand(7);
+    for (int i = 0; i < 300; i++) {
+        char reading[64] = "";
+        int length = 1 + rand() % 6;
+        for (int j = 0; j < length; j++) {
+            strcat(reading, kana[rand() % 10]);
+        }
+        fprintf(file, "語%d,%s,%s,,%.2f\n", i, reading, reading, (rand() % 100) / 100.0);
+    }
+    fclose(file);
+    
+    Dictionary* dict = load_dictionary(text_path);
+    SearchConfig* config = create_search_config();
+    assert(dict != NULL && config != NULL);
+    SearchSession* session = search_session_create(dict, config);
+    assert(session != NULL);
+    
+    // Every keystroke must give what a search of the whole text gives
+    const char* const keys[] = { "k", "y", "o", "u", "き", "ょ", "う", "と", "ぬ", "ぬ", "ん", "a", "K", "-" };
+    int steps = 0;
+    for (int step = 0; step < 400; step++) {
+        if (rand() % 3 == 0) {
+            assert(search_session_delete(session, 1 + rand() % 2) == 0);
+        } else {
+            assert(search_session_append(session, keys[rand() % 14]) == 0);
+        }
+        
+        CandidateList* expected = search_candidates(search_session_text(session), NULL, dict, config, NULL);
+        CandidateList* actual = search_session_candidates(session);
+        assert_same_candidates(expected, actual);
+        free_candidate_list(expected);
+        free_candidate_list(actual);
+        steps++;
+    }
+    printf("✓ %d keystrokes and deletions matched full searches\n", steps);
+    
+    assert(search_session_reset(session) == 0);
+    assert(strcmp(search_session_text(session), "") == 0);
+    assert(search_session_append(session, "きょう") == 0);
+    CandidateList* candidates = search_session_candidates(session);
+    assert(candidates->candidate_count > 0);
+    assert(strcmp(candidates->candidates[0].text, "今日") == 0);
+    free_candidate_list(candidates);
+    printf("✓ Session reset and multi-character append\n");
+    
+    // No reading starts like the typo, so every frame is off the trie and
+    // keeps only the nodes within typo distance of it; deleting pops them
+    assert(search_session_reset(session) == 0);
+    assert(search_session_append(session, "ごんにちは") == 0);
+    const SearchSessionFrame* frame = &session->frames[session->frame_count - 1];
+    assert(frame->node < 0 && frame->max_distance >= 0);
+    assert(frame->frontier_count > 0 && frame->frontier_count < dict->hiragana_index.node_count / 10);
+    candidates = search_session_candidates(session);
+    assert(candidates->candidate_count > 0);
+    assert(strcmp(candidates->candidates[0].text, "こんにちは") == 0);
+    free_candidate_list(candidates);
+    int frontier_count = frame->frontier_count;
+    assert(search_session_delete(session, 1) == 0);
+    assert(session->frontier_count == frame[-1].frontier_start + frame[-1].frontier_count);
+    printf("✓ Typo kept %d trie nodes in reach\n", frontier_count);
+    
+    search_session_destroy(session);
+    free_search_config(config);
+    free_dictionary(dict);
+    remove(text_path);
+}
+
+void test_ngram_semantic_search() {
+    printf("Testing semantic scoring with the n-gram backend...\n");
+    
+    Dictionary* dict = create_fallback_dictionary();
+    SearchConfig* config = create_search_config();
+    EmbeddingBackend* backend = embedding_backend_create_ngram(0);
+    assert(dict != NULL && config != NULL && backend != NULL);
+    
+    // Build in memory only
+    free(config->embedding_store_path);
+    free(config->semantic_index_path);
+    config->embedding_store_path = NULL;
+    config->semantic_index_path = NULL;
+    
+    assert(attach_dictionary_embeddings(dict, backend, config) == 0);
+    assert(dict->embeddings != NULL && dict->embeddings->complete);
+    assert(dict->embeddings->dimensions == NGRAM_DEFAULT_DIMENSIONS);
+    assert(strcmp(dict->embeddings->model_name, "ngram-256") == 0);
+    printf("✓ %d entries embedded in-process\n", dict->embeddings->entry_count);
+    
+    // Entries are embedded with their readings, so kana and romaji input
+    // both find their entry semantically
+    const char* const inputs[] = { "こんにちは", "konnichiwa" };
+    for (int i = 0; i < 2; i++) {
+        CandidateList* candidates = search_candidates(inputs[i], NULL, dict, config, backend);
+        assert(candidates && candidates->candidate_count > 0);
+        assert(strcmp(candidates->candidates[0].reading, "こんにちは") == 0);
+        assert(candidates->candidates[0].embedding_score > 0.3f);
+        printf("✓ %s: %s with embedding score %.3f\n", inputs[i],
+               candidates->candidates[0].text, candidates->candidates[0].embedding_score);
+        free_candidate_list(candidates);
+    }
+    
+    embedding_backend_destroy(backend);
+    free_search_config(config);
+    free_dictionary(dict);
+}
+
+int main() {
+    printf("=== NovaKey Search Tests ===\n\n");
+    
+    test_compiled_dictionary();
+    test_reading_trie();
+    test_dictionary_index();
+    test_romanize_hiragana();
+    test_romaji_index();
+    test_topk_selection();
+    test_short_prefix_candidates();
+    test_edit_distance();
+    test_search_session();
+    test_ngram_semantic_search();
+    
+    printf("\n✓ All search tests passed!\n");
+    return 0;
+}
@@ -0,0 +1,13 @@
+#include <stdio.h>
+#include "../include/search.h"
+
+// Offline dictionary compiler: converts the CSV dictionary
+// ("kanji,hiragana,katakana,romaji,frequency") into the mmap-able binary format.
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <dictionary.txt> <dictionary.nkd>\n", argv[0]);
+        return 1;
+    }
+    
+    return compile_dictionary(argv[1], argv[2]) == 0 ? 0 : 1;
+}